@@ -250,6 +250,7 @@
 #endif
 #ifdef CONFIG_LIBPOSTPROC
     {"pphelp", &pp_help, CONF_TYPE_PRINT_INDIRECT, CONF_NOCFG, 0, 0, NULL},
+    {"ppthreads", &pp_threads, CONF_TYPE_INT, CONF_RANGE, 1, 16, NULL},
 #endif
 
     // scaling:
@@ -274,6 +275,9 @@
     // draw by slices or whole frame (useful with libmpeg2/libavcodec)
     {"slices", &vd_use_slices, CONF_TYPE_FLAG, 0, 0, 1, NULL},
     {"noslices", &vd_use_slices, CONF_TYPE_FLAG, 0, 1, 0, NULL},
+#ifdef CONFIG_LIBMPEG2
+    {"mpeg2threads", &libmpeg2_threads, CONF_TYPE_INT, CONF_RANGE, 1, 16, NULL},
+#endif
     {"field-dominance", &field_dominance, CONF_TYPE_INT, CONF_RANGE, -1, 1, NULL},
 
 #ifdef CONFIG_LIBAVCODEC
@@ -334,6 +338,7 @@
     {"spualign", &spu_alignment, CONF_TYPE_INT, CONF_RANGE, -1, 2, NULL},
     {"spuaa", &spu_aamode, CONF_TYPE_INT, CONF_RANGE, 0, 31, NULL},
     {"spugauss", &spu_gaussvar, CONF_TYPE_FLOAT, CONF_RANGE, 0.0, 3.0, NULL},
+    {"spuaathreads", &spu_aa_threads, CONF_TYPE_INT, CONF_RANGE, 1, 16, NULL},
 #ifdef CONFIG_FREETYPE
     {"subfont-encoding", &subtitle_font_encoding, CONF_TYPE_STRING, 0, 0, 0, NULL},
     {"subfont-text-scale", &text_font_scale_factor, CONF_TYPE_FLOAT, CONF_RANGE, 0, 100, NULL},
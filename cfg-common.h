@@ -199,6 +199,8 @@ extern float sws_chr_gblur;
 extern float sws_lum_gblur;
 extern float sws_chr_sharpen;
 extern float sws_lum_sharpen;
+extern int sws_threads;
+extern int sws_cache_size;
 
 const m_option_t scaler_filter_conf[]={
     {"lgb", &sws_lum_gblur, CONF_TYPE_FLOAT, 0, 0, 100.0, NULL},
@@ -207,6 +209,8 @@ const m_option_t scaler_filter_conf[]={
     {"chs", &sws_chr_hshift, CONF_TYPE_INT, 0, 0, 0, NULL},
     {"ls", &sws_lum_sharpen, CONF_TYPE_FLOAT, 0, -100.0, 100.0, NULL},
     {"cs", &sws_chr_sharpen, CONF_TYPE_FLOAT, 0, -100.0, 100.0, NULL},
+    {"threads", &sws_threads, CONF_TYPE_INT, CONF_RANGE, 1, 16, NULL},
+    {"cache", &sws_cache_size, CONF_TYPE_INT, CONF_RANGE, 0, 64, NULL},
     {NULL, NULL, 0, 0, 0, 0, NULL}
 };
 
@@ -256,6 +260,7 @@ extern af_cfg_t af_cfg; // Audio filter configuration, defined in libmpcodecs/de
 const m_option_t audio_filter_conf[]={
     {"list", &af_cfg.list, CONF_TYPE_STRING_LIST, 0, 0, 0, NULL},
     {"force", &af_cfg.force, CONF_TYPE_INT, CONF_RANGE, 0, 7, NULL},
+    {"dither", &af_format_dither, CONF_TYPE_FLAG, 0, 0, 1, NULL},
     {NULL, NULL, 0, 0, 0, 0, NULL}
 };
 
@@ -184,6 +184,11 @@ const m_option_t mencoder_opts[]={
     // and for 29.97FPS progressive MPEG2 streams
     {"ofps", &force_ofps, CONF_TYPE_DOUBLE, CONF_MIN|CONF_GLOBAL, 0, 0, NULL},
     {"o", &out_filename, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
+    {"write-cache", &write_cache_size, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 1048576, NULL},
+
+    // parallel encoding of parts of the input
+    {"segments", &encode_segments, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 1, MAX_SEGMENTS, NULL},
+    {"segment-end", &segment_end, CONF_TYPE_TIME, CONF_GLOBAL, 0, 0, NULL},
 
     // limit number of skippable frames after a non-skipped one
     {"skiplimit", &skip_limit, CONF_TYPE_INT, 0, 0, 0, NULL},
@@ -214,6 +219,10 @@ const m_option_t mencoder_opts[]={
 
     {"pass", "-pass has been removed, use -lavcopts vpass=n, -xvidencopts pass=n\n", CONF_TYPE_PRINT, CONF_NOCFG, 0, 0, NULL},
     {"passlogfile", &passtmpfile, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
+    // cache the filtered frames of the first pass for the following ones
+    {"passcache-out", &passcache_out, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
+    {"passcache-in", &passcache_in, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
+    {"passcache-level", &passcache_level, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 9, NULL},
 
     {"vobsubout", &vobsub_out, CONF_TYPE_STRING, CONF_GLOBAL, 0, 0, NULL},
     {"vobsuboutindex", &vobsub_out_index, CONF_TYPE_INT, CONF_RANGE|CONF_GLOBAL, 0, 31, NULL},
@@ -122,6 +122,8 @@ const m_option_t mplayer_opts[]={
     {"master", "Option -master has been removed, use -af volume instead.\n", CONF_TYPE_PRINT, 0, 0, 0, NULL},
     // override audio buffer size (used only by -ao oss, anyway obsolete...)
     {"abs", &ao_data.buffersize, CONF_TYPE_INT, CONF_MIN, 0, 0, NULL},
+    // size ao buffers and audio chunks for a target latency in ms
+    {"audio-latency", &ao_target_latency, CONF_TYPE_INT, CONF_RANGE, 0, 1000, NULL},
 
     // -ao pcm options:
     {"aofile", "-aofile has been removed. Use -ao pcm:file=<filename> instead.\n", CONF_TYPE_PRINT, 0, 0, 0, NULL},
@@ -332,6 +334,9 @@ const m_option_t mplayer_opts[]={
 
     {"noloop", &mpctx_s.loop_times, CONF_TYPE_FLAG, 0, 0, -1, NULL},
     {"loop", &mpctx_s.loop_times, CONF_TYPE_INT, CONF_RANGE, -1, 10000, NULL},
+    {"live-latency", &live_latency, CONF_TYPE_FLOAT, CONF_RANGE, 0.0, 3600.0, NULL},
+    {"live-speedup", &live_speedup, CONF_TYPE_FLOAT, CONF_RANGE, 0.0, 1.0, NULL},
+    {"live-skip", &live_skip, CONF_TYPE_FLOAT, CONF_RANGE, 0.1, 3600.0, NULL},
     {"playlist", NULL, CONF_TYPE_STRING, 0, 0, 0, NULL},
 
     // a-v sync stuff:
@@ -309,6 +309,32 @@ static int mp_property_stream_length(m_option_t *prop, int action,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+/// Packets lost by a network stream (RO)
+static int mp_property_stream_packets_lost(m_option_t *prop, int action,
+                                           void *arg, MPContext *mpctx)
+{
+    unsigned lost;
+
+    if (!mpctx->demuxer || !mpctx->demuxer->stream ||
+        stream_control(mpctx->demuxer->stream, STREAM_CTRL_GET_PACKETS_LOST,
+                       &lost) != STREAM_OK)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_int_ro(prop, action, arg, lost);
+}
+
+/// Packet arrival jitter of a network stream in ms (RO)
+static int mp_property_stream_jitter(m_option_t *prop, int action,
+                                     void *arg, MPContext *mpctx)
+{
+    double jitter;
+
+    if (!mpctx->demuxer || !mpctx->demuxer->stream ||
+        stream_control(mpctx->demuxer->stream, STREAM_CTRL_GET_JITTER,
+                       &jitter) != STREAM_OK)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_float_ro(prop, action, arg, jitter * 1000);
+}
+
 /// Media length in seconds (RO)
 static int mp_property_length(m_option_t *prop, int action, void *arg,
                               MPContext *mpctx)
@@ -689,6 +715,31 @@ static int mp_property_audio_delay(m_option_t *prop, int action,
     }
 }
 
+/// Decode to speaker latency (RO)
+static int mp_property_audio_latency(m_option_t *prop, int action,
+                                     void *arg, MPContext *mpctx)
+{
+    sh_audio_t *sh_audio = mpctx->sh_audio;
+    double latency;
+    if (!sh_audio || !sh_audio->afilter || !mpctx->audio_out || !ao_data.bps)
+        return M_PROPERTY_UNAVAILABLE;
+    // Decoded but not filtered, then buffered in the filters and in front
+    // of the ao, then queued in the driver and sound card
+    latency = sh_audio->a_buffer_len / (double)sh_audio->o_bps +
+              (af_calc_delay(sh_audio->afilter) + sh_audio->a_out_buffer_len) *
+              playback_speed / ao_data.bps +
+              playback_speed * mpctx->audio_out->get_delay();
+    switch (action) {
+    case M_PROPERTY_PRINT:
+        if (!arg)
+            return M_PROPERTY_ERROR;
+        *(char**)arg = malloc(16);
+        sprintf(*(char**)arg, "%d ms", ROUND(latency * 1000));
+        return M_PROPERTY_OK;
+    }
+    return m_property_double_ro(prop, action, arg, latency);
+}
+
 /// Audio codec tag (RO)
 static int mp_property_audio_format(m_option_t *prop, int action,
                                     void *arg, MPContext *mpctx)
@@ -1995,6 +2046,10 @@ static const m_option_t mp_properties[] = {
      M_OPT_MIN, 0, 0, NULL },
     { "stream_length", mp_property_stream_length, CONF_TYPE_POSITION,
      M_OPT_MIN, 0, 0, NULL },
+    { "stream_packets_lost", mp_property_stream_packets_lost, CONF_TYPE_INT,
+     M_OPT_MIN, 0, 0, NULL },
+    { "stream_jitter", mp_property_stream_jitter, CONF_TYPE_FLOAT,
+     M_OPT_MIN, 0, 0, NULL },
     { "length", mp_property_length, CONF_TYPE_TIME,
      M_OPT_MIN, 0, 0, NULL },
     { "percent_pos", mp_property_percent_pos, CONF_TYPE_INT,
@@ -2019,6 +2074,8 @@ static const m_option_t mp_properties[] = {
      M_OPT_RANGE, 0, 1, NULL },
     { "audio_delay", mp_property_audio_delay, CONF_TYPE_FLOAT,
      M_OPT_RANGE, -100, 100, NULL },
+    { "audio_latency", mp_property_audio_latency, CONF_TYPE_DOUBLE,
+     0, 0, 0, NULL },
     { "audio_format", mp_property_audio_format, CONF_TYPE_INT,
      0, 0, 0, NULL },
     { "audio_codec", mp_property_audio_codec, CONF_TYPE_STRING,
@@ -32,9 +32,10 @@
 
 static int current_sub=0;
 
-//static subtitle* subtitles=NULL;
-static int nosub_range_start=-1;
-static int nosub_range_end=-1;
+// the subtitle shown does not change for keys in [valid_from, valid_to)
+static unsigned long valid_from=1;
+static unsigned long valid_to=0;
+static subtitle *shown_sub = NULL;
 static const sub_data *last_sub_data = NULL;
 
 extern float sub_delay;
@@ -46,6 +47,8 @@ void step_sub(sub_data *subd, float pts, int movement) {
 
     if (subd == NULL) return;
     subs = subd->subtitles;
+    if (current_sub >= subd->sub_num)
+        current_sub = subd->sub_num - 1;
     key = (pts+sub_delay) * (subd->sub_uses_time ? 100 : sub_fps);
 
     /* Tell the OSD subsystem that the OSD contents will change soon */
@@ -70,25 +73,28 @@ void step_sub(sub_data *subd, float pts, int movement) {
 }
 
 void find_sub(sub_data* subd,int key){
-    subtitle *subs;
     subtitle *new_sub = NULL;
-    int i,j;
-
-    if ( !subd || subd->sub_num == 0) return;
-    subs = subd->subtitles;
+    int i, last;
+
+    if (!subd) return;
+    if (sub_update(subd)) {
+        // more of the file has been read, the old subtitles are gone
+        vo_sub_last = NULL;
+        shown_sub = NULL;
+        valid_from = 1;
+        valid_to = 0;
+    }
+    if (subd->sub_num == 0) return;
 
     if (last_sub_data != subd) {
-        // Sub data changed, reset nosub range.
+        // Sub data changed, forget the cached range.
         last_sub_data = subd;
-        nosub_range_start = -1;
-        nosub_range_end = -1;
+        valid_from = 1;
+        valid_to = 0;
     }
 
-    if(vo_sub){
-      if(key>=vo_sub->start && key<=vo_sub->end) return; // OK!
-    } else {
-      if(key>nosub_range_start && key<nosub_range_end) return; // OK!
-    }
+    if(key>0 && key>=valid_from && key<valid_to && vo_sub==shown_sub)
+      return; // OK!
     // sub changed!
 
     /* Tell the OSD subsystem that the OSD contents will change soon */
@@ -96,83 +102,20 @@ void find_sub(sub_data* subd,int key){
 
     if(key<=0){
       // no sub here
+      valid_from = 1;
+      valid_to = 0;
       goto update;
     }
 
-//    printf("\r---- sub changed ----\n");
-
-    // check next sub.
-    if(current_sub>=0 && current_sub+1 < subd->sub_num){
-      if(key>subs[current_sub].end && key<subs[current_sub+1].start){
-          // no sub
-          nosub_range_start=subs[current_sub].end;
-          nosub_range_end=subs[current_sub+1].start;
-          goto update;
-      }
-      // next sub?
-      ++current_sub;
-      new_sub=&subs[current_sub];
-      if(key>=new_sub->start && key<=new_sub->end) goto update; // OK!
-    }
-
-//    printf("\r---- sub log search... ----\n");
-
-    // use logarithmic search:
-    i=0;
-    j = subd->sub_num - 1;
-//    printf("Searching %d in %d..%d\n",key,subs[i].start,subs[j].end);
-    while(j>=i){
-        current_sub=(i+j+1)/2;
-        new_sub=&subs[current_sub];
-        if(key<new_sub->start) j=current_sub-1;
-        else if(key>new_sub->end) i=current_sub+1;
-        else goto update; // found!
-    }
-//    if(key>=new_sub->start && key<=new_sub->end) return; // OK!
-
-    // check where are we...
-    if(key<new_sub->start){
-      if(current_sub<=0){
-          // before the first sub
-          nosub_range_start=key-1; // tricky
-          nosub_range_end=new_sub->start;
-//          printf("FIRST...  key=%d  end=%d  \n",key,new_sub->start);
-          new_sub=NULL;
-          goto update;
-      }
-      --current_sub;
-      if(key>subs[current_sub].end && key<subs[current_sub+1].start){
-          // no sub
-          nosub_range_start=subs[current_sub].end;
-          nosub_range_end=subs[current_sub+1].start;
-//          printf("No sub... 1 \n");
-          new_sub=NULL;
-          goto update;
-      }
-      printf("HEH????  ");
-    } else {
-      if(key<=new_sub->end) printf("JAJJ!  "); else
-      if(current_sub+1 >= subd->sub_num){
-          // at the end?
-          nosub_range_start=new_sub->end;
-          nosub_range_end=0x7FFFFFFF; // MAXINT
-//          printf("END!?\n");
-          new_sub=NULL;
-          goto update;
-      } else
-      if(key>subs[current_sub].end && key<subs[current_sub+1].start){
-          // no sub
-          nosub_range_start=subs[current_sub].end;
-          nosub_range_end=subs[current_sub+1].start;
-//          printf("No sub... 2 \n");
-          new_sub=NULL;
-          goto update;
-      }
-    }
-
-    mp_msg(MSGT_FIXME,MSGL_FIXME,"SUB ERROR:  %d  ?  %d --- %d  [%d]  \n",key,(int)new_sub->start,(int)new_sub->end,current_sub);
+    i = sub_index_find(subd, key, &last, &valid_to);
+    valid_from = key;
+    if (i >= 0) {
+        new_sub = &subd->subtitles[i];
+        current_sub = i;
+    } else
+        current_sub = last >= 0 ? last : 0;
 
-    new_sub=NULL; // no sub here
 update:
+    shown_sub = new_sub;
     set_osd_subtitle(new_sub);
 }
@@ -277,8 +277,17 @@ static const char help_text[]=
 #define MSGTR_NoSpeedWithFrameCopy "WARNING: -speed is not guaranteed to work correctly with -oac copy!\n"\
 "Your encode might be broken!\n"
 #define MSGTR_ErrorWritingFile "%s: Error writing file.\n"
+#define MSGTR_CannotEnableWriteCache "Cannot enable the output cache, writing directly.\n"
+#define MSGTR_CannotOpenPassCache "Cannot open frame cache %s.\n"
 #define MSGTR_FlushingVideoFrames "\nFlushing video frames.\n"
 #define MSGTR_FiltersHaveNotBeenConfiguredEmptyFile "Filters have not been configured! Empty file?\n"
+#define MSGTR_SegmentsOptionConflict "\n-segments works with a single input file and cannot be combined with\n"\
+"-ss, -sb, -endpos, -frames, -edl, -delay, -frameno-file, -vobsubout or\n"\
+"-passcache-in/-passcache-out.\n"
+#define MSGTR_CannotSplitIntoSegments "Cannot split the input into segments, encoding it in one piece.\n"
+#define MSGTR_EncodingSegment "Segment %d starts at %.3fs, encoding to %s.\n"
+#define MSGTR_SegmentFailed "Encoding segment %d failed.\n"
+#define MSGTR_CannotFindExecutable "Cannot find the executable %s to run the segment encoders.\n"
 #define MSGTR_RecommendedVideoBitrate "Recommended video bitrate for %s CD: %d\n"
 #define MSGTR_VideoStreamResult "\nVideo stream: %8.3f kbit/s  (%d B/s)  size: %"PRIu64" bytes  %5.3f secs  %d frames\n"
 #define MSGTR_AudioStreamResult "\nAudio stream: %8.3f kbit/s  (%d B/s)  size: %"PRIu64" bytes  %5.3f secs\n"
@@ -837,6 +846,7 @@ static const char help_text[]=
 #define MSGTR_VO_CantCreateDirectory "Unable to create output directory."
 #define MSGTR_VO_CantCreateFile "Unable to create output file."
 #define MSGTR_VO_DirectoryCreateSuccess "Output directory successfully created."
+#define MSGTR_VO_ImageWriterStats "%s: %d images written by %d thread(s), %.1f ms average, %.1f ms max per image, %.1fs waiting for the queue.\n"
 #define MSGTR_VO_ParsingSuboptions "Parsing suboptions."
 #define MSGTR_VO_SuboptionsParsedOK "Suboptions parsed OK."
 #define MSGTR_VO_ValueOutOfRange "value out of range"
@@ -968,6 +978,7 @@ static const char help_text[]=
 #define MSGTR_LIBVO_PNG_Warning3 "[VO_PNG] Info: (0 = no compression, 1 = fastest, lowest - 9 best, slowest compression)\n"
 #define MSGTR_LIBVO_PNG_ErrorOpeningForWriting "\n[VO_PNG] Error opening '%s' for writing!\n"
 #define MSGTR_LIBVO_PNG_ErrorInCreatePng "[VO_PNG] Error in create_png.\n"
+#define MSGTR_LIBVO_PNG_ErrorWritingImages "[VO_PNG] Writing one or more images failed.\n"
 
 // vo_pnm.c
 #define MSGTR_VO_PNM_ASCIIMode "ASCII mode enabled."
@@ -1887,6 +1898,7 @@ static const char help_text[]=
 #define MSGTR_MPDEMUX_NW_AuthRequired "Authentication required.\n"
 #define MSGTR_MPDEMUX_NW_NoPasswdProvidedTryingBlank "No password provided, trying blank password.\n"
 #define MSGTR_MPDEMUX_NW_ErrServerReturned "Server returns %d: %s\n"
+#define MSGTR_MPDEMUX_NW_BadContentRange "Unexpected Content-Range in the server response: %s\n"
 #define MSGTR_MPDEMUX_NW_CacheSizeSetTo "Cache size set to %d KBytes\n"
 
 // open.c, stream.c:
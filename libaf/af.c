@@ -22,6 +22,7 @@
 #include <string.h>
 #include "osdep/strsep.h"
 
+#include "libavutil/mem.h"
 #include "af.h"
 
 // Static list of filters
@@ -358,6 +359,9 @@ void af_uninit(af_stream_t* s)
 {
   while(s->first)
     af_remove(s,s->first);
+  av_freep(&s->buf[0]);
+  av_freep(&s->buf[1]);
+  s->buf_len[0] = s->buf_len[1] = 0;
 }
 
 /**
@@ -543,14 +547,53 @@ af_instance_t* af_add(af_stream_t* s, char* name){
   return new;
 }
 
-// Filter data chunk through the filters in the list
+/* Make sure a shared buffer can hold len bytes. Buffers only grow, so
+   once the largest chunk has been seen the chain runs without allocating. */
+static int af_resize_shared_buffer(void** buf, int* buf_len, int len)
+{
+  if(*buf_len >= len)
+    return AF_OK;
+  mp_msg(MSGT_AFILTER, MSGL_V, "[libaf] Reallocating shared buffer, "
+	 "old len = %i, new len = %i\n",*buf_len,len);
+  av_free(*buf);
+  *buf = av_malloc(len);
+  if(!*buf){
+    *buf_len = 0;
+    mp_msg(MSGT_AFILTER, MSGL_FATAL, "[libaf] Could not allocate memory \n");
+    return AF_ERROR;
+  }
+  *buf_len = len;
+  return AF_OK;
+}
+
+/* Filter data chunk through the filters in the list. Filters that work
+   in place modify the data they are given, the ones flagged with
+   AF_FLAGS_SHARED_BUFFER write to whichever shared buffer does not hold
+   their input. */
 af_data_t* af_play(af_stream_t* s, af_data_t* data)
 {
   af_instance_t* af=s->first;
   // Iterate through all filters
   do{
     if (data->len <= 0) break;
-    data=af->play(af,data);
+    if(af->info->flags & AF_FLAGS_SHARED_BUFFER){
+      int i = data->audio == s->buf[0];
+      if(AF_OK != af_resize_shared_buffer(&s->buf[i],&s->buf_len[i],
+                                          af_lencalc(af->mul,data)))
+	return NULL;
+      af->shared_buf  = &s->buf[i];
+      af->shared_len  = &s->buf_len[i];
+      af->data->audio = s->buf[i];
+      af->data->len   = s->buf_len[i];
+      data=af->play(af,data);
+      // The buffer belongs to the stream, don't let the filter free it
+      af->shared_buf  = NULL;
+      af->shared_len  = NULL;
+      af->data->audio = NULL;
+      af->data->len   = 0;
+    }
+    else
+      data=af->play(af,data);
     af=af->next;
   }while(af && data);
   return data;
@@ -600,6 +643,13 @@ int af_resize_local_buffer(af_instance_t* af, af_data_t* data)
 {
   // Calculate new length
   register int len = af_lencalc(af->mul,data);
+  if(af->shared_buf){
+    if(AF_OK != af_resize_shared_buffer(af->shared_buf,af->shared_len,len))
+      return AF_ERROR;
+    af->data->audio = *af->shared_buf;
+    af->data->len   = *af->shared_len;
+    return AF_OK;
+  }
   mp_msg(MSGT_AFILTER, MSGL_V, "[libaf] Reallocating memory in module %s, "
 	 "old len = %i, new len = %i\n",af->info->name,af->data->len,len);
   // If there is a buffer free it
@@ -50,6 +50,10 @@ typedef struct af_data_s
 // Flags used for defining the behavior of an audio filter
 #define AF_FLAGS_REENTRANT 	0x00000000
 #define AF_FLAGS_NOT_REENTRANT 	0x00000001
+/* play() writes its output to af->data->audio after RESIZE_LOCAL_BUFFER and
+   keeps nothing there between calls, so the chain may point it at one of
+   the buffers shared by the whole stream */
+#define AF_FLAGS_SHARED_BUFFER	0x00000002
 
 /* Audio filter information not specific for current instance, but for
    a specific filter */
@@ -78,6 +82,10 @@ typedef struct af_instance_s
 		 * corresponding output */
   double mul; /* length multiplier: how much does this instance change
 		 the length of the buffer. */
+  /* While play() writes to one of the stream's shared buffers: that buffer
+     and its length, so RESIZE_LOCAL_BUFFER grows it instead of freeing */
+  void** shared_buf;
+  int* shared_len;
 }af_instance_t;
 
 // Initialization flags
@@ -105,6 +113,9 @@ typedef struct af_cfg_s{
 		   list during first initialization of stream */
 }af_cfg_t;
 
+// Dither float to 16 bit conversions in the format filter
+extern int af_format_dither;
+
 // Current audio stream
 typedef struct af_stream_s
 {
@@ -116,6 +127,9 @@ typedef struct af_stream_s
   af_data_t output;
   // Configuration for this stream
   af_cfg_t cfg;
+  // Output buffers the AF_FLAGS_SHARED_BUFFER filters alternate between
+  void* buf[2];
+  int buf_len[2];
 }af_stream_t;
 
 /*********************************************
@@ -301,6 +301,6 @@ af_info_t af_info_channels = {
   "channels",
   "Anders",
   "",
-  AF_FLAGS_REENTRANT,
+  AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
   af_open
 };
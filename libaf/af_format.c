@@ -31,6 +31,11 @@
 #include "af.h"
 #include "mpbswap.h"
 #include "libvo/fastmemcpy.h"
+#include "libavutil/common.h"
+#if ARCH_X86
+#include "libavutil/mem.h"
+#include "libavutil/x86_cpu.h"
+#endif
 
 /* Functions used by play to convert the input audio to the correct
    format */
@@ -50,6 +55,17 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps);
 static void float2int(float* in, void* out, int len, int bps);
 // From signed int to float
 static void int2float(void* in, float* out, int len, int bps);
+// From float to s16 with triangular dither noise
+static void float2s16_dither(float* in, int16_t* out, int len, uint32_t* seed);
+
+// Add TPDF dither when converting float to 16 bit samples
+int af_format_dither = 0;
+
+// Data for specific instances of this filter
+typedef struct af_format_s
+{
+  uint32_t seed[4]; // state of the dither noise generators
+}af_format_t;
 
 static af_data_t* play(struct af_instance_s* af, af_data_t* data);
 static af_data_t* play_swapendian(struct af_instance_s* af, af_data_t* data);
@@ -132,6 +148,9 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
 	   af_fmt2str(af->data->format,buf2,256));
 	af->play = play_float_s16;
     }
+    if (af_format_dither && af->data->bps == 2 &&
+	(data->format & AF_FORMAT_POINT_MASK) == AF_FORMAT_F)
+	mp_msg(MSGT_AFILTER, MSGL_V, "[format] Using dithered conversion to 16 bit\n");
     if ((data->format == AF_FORMAT_S16_NE) &&
 	(af->data->format == AF_FORMAT_FLOAT_NE))
     {
@@ -172,6 +191,7 @@ static void uninit(struct af_instance_s* af)
   if (af->data)
       free(af->data->audio);
   free(af->data);
+  free(af->setup);
   af->setup = 0;
 }
 
@@ -201,7 +221,10 @@ static af_data_t* play_float_s16(struct af_instance_s* af, af_data_t* data)
   if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
     return NULL;
 
-  float2int(c->audio, l->audio, len, 2);
+  if (af_format_dither)
+    float2s16_dither(c->audio, l->audio, len, ((af_format_t*)af->setup)->seed);
+  else
+    float2int(c->audio, l->audio, len, 2);
 
   c->audio = l->audio;
   c->len = len*2;
@@ -266,7 +289,10 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
       to_alaw(c->audio, l->audio, len, c->bps, c->format&AF_FORMAT_POINT_MASK);
       break;
     default:
-      float2int(c->audio, l->audio, len, l->bps);
+      if (af_format_dither && l->bps == 2)
+	float2s16_dither(c->audio, l->audio, len, ((af_format_t*)af->setup)->seed);
+      else
+	float2int(c->audio, l->audio, len, l->bps);
       if((l->format&AF_FORMAT_SIGN_MASK) == AF_FORMAT_US)
 	si2us(l->audio,len,l->bps);
       break;
@@ -318,8 +344,14 @@ static int af_open(af_instance_t* af){
   af->play=play;
   af->mul=1;
   af->data=calloc(1,sizeof(af_data_t));
-  if(af->data == NULL)
+  af->setup=calloc(1,sizeof(af_format_t));
+  if(af->data == NULL || af->setup == NULL)
     return AF_ERROR;
+  // Any nonzero seeds will do, but the lanes must differ
+  ((af_format_t*)af->setup)->seed[0] = 0x12345678;
+  ((af_format_t*)af->setup)->seed[1] = 0x9abcdef1;
+  ((af_format_t*)af->setup)->seed[2] = 0x2468ace1;
+  ((af_format_t*)af->setup)->seed[3] = 0x13579bdf;
   return AF_OK;
 }
 
@@ -329,7 +361,7 @@ af_info_t af_info_format = {
   "format",
   "Anders",
   "",
-  AF_FLAGS_REENTRANT,
+  AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
   af_open
 };
 
@@ -357,6 +389,491 @@ static inline void store24bit(void* data, int pos, uint32_t expanded_value) {
 #endif
 }
 
+#if HAVE_SSE2
+/* SSE2 conversion kernels. All of them process n samples, where n must be
+   a multiple of 8, and take pointers to the end of the buffers so that a
+   negative index can count up to zero. The float to int conversions
+   saturate instead of wrapping around. */
+
+static void float2s8_sse2(const float* in, int8_t* out, int n, float scale)
+{
+  x86_reg i = -n;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movups   (%1,%0,4), %%xmm0     \n\t"
+    "movups 16(%1,%0,4), %%xmm1     \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "cvtps2dq   %%xmm0, %%xmm0      \n\t"
+    "cvtps2dq   %%xmm1, %%xmm1      \n\t"
+    "packssdw   %%xmm1, %%xmm0      \n\t"
+    "packsswb   %%xmm0, %%xmm0      \n\t"
+    "movq       %%xmm0, (%2,%0)     \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+static void float2s16_sse2(const float* in, int16_t* out, int n, float scale)
+{
+  x86_reg i = -n;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movups   (%1,%0,4), %%xmm0     \n\t"
+    "movups 16(%1,%0,4), %%xmm1     \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "cvtps2dq   %%xmm0, %%xmm0      \n\t"
+    "cvtps2dq   %%xmm1, %%xmm1      \n\t"
+    "packssdw   %%xmm1, %%xmm0      \n\t"
+    "movdqu     %%xmm0, (%2,%0,2)   \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+static void float2s32_sse2(const float* in, int32_t* out, int n, float scale)
+{
+  x86_reg i = -n;
+  // cvtps2dq returns INT_MIN on overflow, so clip at the largest float < 2^31
+  const float clip = 2147483520.0f;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "movss          %4, %%xmm6      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "shufps $0, %%xmm6, %%xmm6      \n\t"
+    "1:                             \n\t"
+    "movups   (%1,%0,4), %%xmm0     \n\t"
+    "movups 16(%1,%0,4), %%xmm1     \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "minps      %%xmm6, %%xmm0      \n\t"
+    "minps      %%xmm6, %%xmm1      \n\t"
+    "cvtps2dq   %%xmm0, %%xmm0      \n\t"
+    "cvtps2dq   %%xmm1, %%xmm1      \n\t"
+    "movdqu     %%xmm0,   (%2,%0,4) \n\t"
+    "movdqu     %%xmm1, 16(%2,%0,4) \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale), "m"(clip)
+    : "memory", "%xmm0", "%xmm1", "%xmm6", "%xmm7");
+}
+
+// One xorshift32 step on each of the four generators in xmm6, followed by
+// triangular noise in the range (-1, 1) made from their two 16 bit halves
+#define DITHER_NOISE(reg) \
+    "movdqa     %%xmm6, %%xmm5      \n\t"\
+    "pslld         $13, %%xmm5      \n\t"\
+    "pxor       %%xmm5, %%xmm6      \n\t"\
+    "movdqa     %%xmm6, %%xmm5      \n\t"\
+    "psrld         $17, %%xmm5      \n\t"\
+    "pxor       %%xmm5, %%xmm6      \n\t"\
+    "movdqa     %%xmm6, %%xmm5      \n\t"\
+    "pslld          $5, %%xmm5      \n\t"\
+    "pxor       %%xmm5, %%xmm6      \n\t"\
+    "movdqa     %%xmm6, "reg"       \n\t"\
+    "movdqa     %%xmm6, %%xmm5      \n\t"\
+    "pslld         $16, "reg"       \n\t"\
+    "psrld         $16, "reg"       \n\t"\
+    "psrld         $16, %%xmm5      \n\t"\
+    "psubd      %%xmm5, "reg"       \n\t"\
+    "cvtdq2ps   "reg", "reg"        \n\t"\
+    "mulps      %%xmm4, "reg"       \n\t"
+
+static void float2s16_dither_sse2(const float* in, int16_t* out, int n,
+                                  uint32_t* seed)
+{
+  x86_reg i = -n;
+  const float scale = 32767.0f;
+  const float nscale = 1.0f / 65536.0f;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "movss          %4, %%xmm4      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "shufps $0, %%xmm4, %%xmm4      \n\t"
+    "movdqu       (%5), %%xmm6      \n\t"
+    "1:                             \n\t"
+    DITHER_NOISE("%%xmm2")
+    DITHER_NOISE("%%xmm3")
+    "movups   (%1,%0,4), %%xmm0     \n\t"
+    "movups 16(%1,%0,4), %%xmm1     \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "addps      %%xmm2, %%xmm0      \n\t"
+    "addps      %%xmm3, %%xmm1      \n\t"
+    "cvtps2dq   %%xmm0, %%xmm0      \n\t"
+    "cvtps2dq   %%xmm1, %%xmm1      \n\t"
+    "packssdw   %%xmm1, %%xmm0      \n\t"
+    "movdqu     %%xmm0, (%2,%0,2)   \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    "movdqu     %%xmm6, (%5)        \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale), "m"(nscale), "r"(seed)
+    : "memory",
+      "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7");
+}
+
+static void s8float_sse2(const int8_t* in, float* out, int n)
+{
+  x86_reg i = -n;
+  const float scale = 1.0f / 128.0f;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movq     (%1,%0), %%xmm0       \n\t"
+    "punpcklbw  %%xmm0, %%xmm0      \n\t"
+    "movdqa     %%xmm0, %%xmm1      \n\t"
+    "punpcklwd  %%xmm0, %%xmm0      \n\t"
+    "punpckhwd  %%xmm1, %%xmm1      \n\t"
+    "psrad         $24, %%xmm0      \n\t"
+    "psrad         $24, %%xmm1      \n\t"
+    "cvtdq2ps   %%xmm0, %%xmm0      \n\t"
+    "cvtdq2ps   %%xmm1, %%xmm1      \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "movups     %%xmm0,   (%2,%0,4) \n\t"
+    "movups     %%xmm1, 16(%2,%0,4) \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+static void s16float_sse2(const int16_t* in, float* out, int n)
+{
+  x86_reg i = -n;
+  const float scale = 1.0f / 32768.0f;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movdqu   (%1,%0,2), %%xmm0     \n\t"
+    "movdqa     %%xmm0, %%xmm1      \n\t"
+    "punpcklwd  %%xmm0, %%xmm0      \n\t"
+    "punpckhwd  %%xmm1, %%xmm1      \n\t"
+    "psrad         $16, %%xmm0      \n\t"
+    "psrad         $16, %%xmm1      \n\t"
+    "cvtdq2ps   %%xmm0, %%xmm0      \n\t"
+    "cvtdq2ps   %%xmm1, %%xmm1      \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "movups     %%xmm0,   (%2,%0,4) \n\t"
+    "movups     %%xmm1, 16(%2,%0,4) \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+static void s32float_sse2(const int32_t* in, float* out, int n)
+{
+  x86_reg i = -n;
+  const float scale = 1.0f / 2147483648.0f;
+  __asm__ volatile(
+    "movss          %3, %%xmm7      \n\t"
+    "shufps $0, %%xmm7, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movdqu   (%1,%0,4), %%xmm0     \n\t"
+    "movdqu 16(%1,%0,4), %%xmm1     \n\t"
+    "cvtdq2ps   %%xmm0, %%xmm0      \n\t"
+    "cvtdq2ps   %%xmm1, %%xmm1      \n\t"
+    "mulps      %%xmm7, %%xmm0      \n\t"
+    "mulps      %%xmm7, %%xmm1      \n\t"
+    "movups     %%xmm0,   (%2,%0,4) \n\t"
+    "movups     %%xmm1, 16(%2,%0,4) \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i)
+    : "r"(in+n), "r"(out+n), "m"(scale)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+// Widen by interleaving zero bytes below the samples
+static void bps_widen_sse2(const uint8_t* in, uint8_t* out, int n,
+                           int inbps, int outbps)
+{
+  x86_reg i = -n;
+  in  += n*inbps;
+  out += n*outbps;
+  if (inbps == 1 && outbps == 2)
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movq       (%1,%0), %%xmm0     \n\t"
+      "pxor       %%xmm1, %%xmm1      \n\t"
+      "punpcklbw  %%xmm0, %%xmm1      \n\t"
+      "movdqu     %%xmm1, (%2,%0,2)   \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory", "%xmm0", "%xmm1");
+  else if (inbps == 1 && outbps == 4)
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movq       (%1,%0), %%xmm0     \n\t"
+      "pxor       %%xmm1, %%xmm1      \n\t"
+      "pxor       %%xmm2, %%xmm2      \n\t"
+      "pxor       %%xmm3, %%xmm3      \n\t"
+      "punpcklbw  %%xmm0, %%xmm1      \n\t"
+      "punpcklwd  %%xmm1, %%xmm2      \n\t"
+      "punpckhwd  %%xmm1, %%xmm3      \n\t"
+      "movdqu     %%xmm2,   (%2,%0,4) \n\t"
+      "movdqu     %%xmm3, 16(%2,%0,4) \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory",
+        "%xmm0", "%xmm1", "%xmm2", "%xmm3");
+  else // 2 -> 4
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movdqu   (%1,%0,2), %%xmm0     \n\t"
+      "pxor       %%xmm1, %%xmm1      \n\t"
+      "pxor       %%xmm2, %%xmm2      \n\t"
+      "punpcklwd  %%xmm0, %%xmm1      \n\t"
+      "punpckhwd  %%xmm0, %%xmm2      \n\t"
+      "movdqu     %%xmm1,   (%2,%0,4) \n\t"
+      "movdqu     %%xmm2, 16(%2,%0,4) \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory", "%xmm0", "%xmm1", "%xmm2");
+}
+
+/* Narrow by keeping the most significant bytes; the arithmetic shift
+   leaves values the signed saturating packs pass through unchanged */
+static void bps_narrow_sse2(const uint8_t* in, uint8_t* out, int n,
+                            int inbps, int outbps)
+{
+  x86_reg i = -n;
+  in  += n*inbps;
+  out += n*outbps;
+  if (inbps == 2) // 2 -> 1
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movdqu   (%1,%0,2), %%xmm0     \n\t"
+      "psraw          $8, %%xmm0      \n\t"
+      "packsswb   %%xmm0, %%xmm0      \n\t"
+      "movq       %%xmm0, (%2,%0)     \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory", "%xmm0");
+  else if (outbps == 1)
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movdqu   (%1,%0,4), %%xmm0     \n\t"
+      "movdqu 16(%1,%0,4), %%xmm1     \n\t"
+      "psrad         $24, %%xmm0      \n\t"
+      "psrad         $24, %%xmm1      \n\t"
+      "packssdw   %%xmm1, %%xmm0      \n\t"
+      "packsswb   %%xmm0, %%xmm0      \n\t"
+      "movq       %%xmm0, (%2,%0)     \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory", "%xmm0", "%xmm1");
+  else // 4 -> 2
+    __asm__ volatile(
+      "1:                             \n\t"
+      "movdqu   (%1,%0,4), %%xmm0     \n\t"
+      "movdqu 16(%1,%0,4), %%xmm1     \n\t"
+      "psrad         $16, %%xmm0      \n\t"
+      "psrad         $16, %%xmm1      \n\t"
+      "packssdw   %%xmm1, %%xmm0      \n\t"
+      "movdqu     %%xmm0, (%2,%0,2)   \n\t"
+      "add            $8, %0          \n\t"
+      " jl 1b                         \n\t"
+      : "+r"(i) : "r"(in), "r"(out) : "memory", "%xmm0", "%xmm1");
+}
+#endif /* HAVE_SSE2 */
+
+#if HAVE_SSSE3
+DECLARE_ALIGNED(16, static const uint8_t, unpack24_shuf)[16] = {
+  0x80, 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11
+};
+DECLARE_ALIGNED(16, static const uint8_t, pack24_shuf)[16] = {
+  1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, 0x80, 0x80, 0x80, 0x80
+};
+
+/* Expand packed 24 bit samples to the top of 32 bit words, the same as
+   load24bit. Reads 4 bytes past the last sample, so callers must leave
+   at least 2 samples of input after the n converted here. */
+static void unpack24_ssse3(const uint8_t* in, uint32_t* out, int n)
+{
+  x86_reg i = -n;
+  __asm__ volatile(
+    "movdqa         %3, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movdqu       (%1), %%xmm0      \n\t"
+    "movdqu     12(%1), %%xmm1      \n\t"
+    "pshufb     %%xmm7, %%xmm0      \n\t"
+    "pshufb     %%xmm7, %%xmm1      \n\t"
+    "movdqu     %%xmm0,   (%2,%0,4) \n\t"
+    "movdqu     %%xmm1, 16(%2,%0,4) \n\t"
+    "add           $24, %1          \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i), "+r"(in)
+    : "r"(out+n), "m"(*unpack24_shuf)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+
+// Store the top 24 bits of 32 bit words, the same as store24bit
+static void pack24_ssse3(const uint32_t* in, uint8_t* out, int n)
+{
+  x86_reg i = -n;
+  __asm__ volatile(
+    "movdqa         %3, %%xmm7      \n\t"
+    "1:                             \n\t"
+    "movdqu   (%2,%0,4), %%xmm0     \n\t"
+    "movdqu 16(%2,%0,4), %%xmm1     \n\t"
+    "pshufb     %%xmm7, %%xmm0      \n\t"
+    "pshufb     %%xmm7, %%xmm1      \n\t"
+    "movq       %%xmm0,   (%1)      \n\t"
+    "movq       %%xmm1, 12(%1)      \n\t"
+    "psrldq         $8, %%xmm0      \n\t"
+    "psrldq         $8, %%xmm1      \n\t"
+    "movd       %%xmm0,  8(%1)      \n\t"
+    "movd       %%xmm1, 20(%1)      \n\t"
+    "add           $24, %1          \n\t"
+    "add            $8, %0          \n\t"
+    " jl 1b                         \n\t"
+    : "+r"(i), "+r"(out)
+    : "r"(in+n), "m"(*pack24_shuf)
+    : "memory", "%xmm0", "%xmm1", "%xmm7");
+}
+#endif /* HAVE_SSSE3 */
+
+#if HAVE_SSE2
+// Number of samples converted through a temporary buffer at a time
+#define TMP_SAMPLES 512
+
+/* Vectorized parts of float2int, int2float and change_bps. They return the
+   number of samples converted, the callers do the rest in C. */
+static int float2int_sse2(float* in, void* out, int len, int bps)
+{
+  int n = len & ~7;
+  if (!n)
+    return 0;
+  switch(bps){
+  case(1):
+    float2s8_sse2(in, out, n, 127.0f);
+    break;
+  case(2):
+    float2s16_sse2(in, out, n, 32767.0f);
+    break;
+  case(3):{
+#if HAVE_SSSE3
+    DECLARE_ALIGNED(16, int32_t, tmp)[TMP_SAMPLES];
+    int i, m;
+    if (!gCpuCaps.hasSSSE3)
+      return 0;
+    for(i=0;i<n;i+=m){
+      m = FFMIN(n-i, TMP_SAMPLES);
+      float2s32_sse2(in+i, tmp, m, 2147483647.0f);
+      pack24_ssse3((uint32_t*)tmp, (uint8_t*)out+3*i, m);
+    }
+    break;
+#else
+    return 0;
+#endif
+  }
+  case(4):
+    float2s32_sse2(in, out, n, 2147483647.0f);
+    break;
+  }
+  return n;
+}
+
+static int int2float_sse2(void* in, float* out, int len, int bps)
+{
+  int n = len & ~7;
+  if (!n)
+    return 0;
+  switch(bps){
+  case(1):
+    s8float_sse2(in, out, n);
+    break;
+  case(2):
+    s16float_sse2(in, out, n);
+    break;
+  case(3):{
+#if HAVE_SSSE3
+    DECLARE_ALIGNED(16, int32_t, tmp)[TMP_SAMPLES];
+    int i, m;
+    n = (len - 2) & ~7;
+    if (!gCpuCaps.hasSSSE3 || n <= 0)
+      return 0;
+    for(i=0;i<n;i+=m){
+      m = FFMIN(n-i, TMP_SAMPLES);
+      unpack24_ssse3((uint8_t*)in+3*i, (uint32_t*)tmp, m);
+      s32float_sse2(tmp, out+i, m);
+    }
+    break;
+#else
+    return 0;
+#endif
+  }
+  case(4):
+    s32float_sse2(in, out, n);
+    break;
+  }
+  return n;
+}
+
+static int change_bps_sse2(void* in, void* out, int len, int inbps, int outbps)
+{
+  int n = len & ~7;
+  if (!n)
+    return 0;
+  if (inbps == 3 || outbps == 3) {
+#if HAVE_SSSE3
+    // Go through 32 bit samples in a temporary buffer
+    DECLARE_ALIGNED(16, uint32_t, tmp)[TMP_SAMPLES];
+    int i, m;
+    if (inbps == 3)
+      n = (len - 2) & ~7;
+    if (!gCpuCaps.hasSSSE3 || n <= 0)
+      return 0;
+    for(i=0;i<n;i+=m){
+      m = FFMIN(n-i, TMP_SAMPLES);
+      if (inbps == 3) {
+        if (outbps == 4)
+          unpack24_ssse3((uint8_t*)in+3*i, (uint32_t*)out+i, m);
+        else {
+          unpack24_ssse3((uint8_t*)in+3*i, tmp, m);
+          bps_narrow_sse2((uint8_t*)tmp, (uint8_t*)out+outbps*i, m, 4, outbps);
+        }
+      } else {
+        if (inbps == 4)
+          pack24_ssse3((uint32_t*)in+i, (uint8_t*)out+3*i, m);
+        else {
+          bps_widen_sse2((uint8_t*)in+inbps*i, (uint8_t*)tmp, m, inbps, 4);
+          pack24_ssse3(tmp, (uint8_t*)out+3*i, m);
+        }
+      }
+    }
+    return n;
+#else
+    return 0;
+#endif
+  }
+  if (inbps < outbps)
+    bps_widen_sse2(in, out, n, inbps, outbps);
+  else
+    bps_narrow_sse2(in, out, n, inbps, outbps);
+  return n;
+}
+#endif /* HAVE_SSE2 */
+
 // Function implementations used by play
 static void endian(void* in, void* out, int len, int bps)
 {
@@ -403,20 +920,24 @@ static void si2us(void* data, int len, int bps)
 
 static void change_bps(void* in, void* out, int len, int inbps, int outbps)
 {
-  register int i;
+  register int i = 0;
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2)
+    i = change_bps_sse2(in, out, len, inbps, outbps);
+#endif
   switch(inbps){
   case(1):
     switch(outbps){
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=((uint16_t)((uint8_t*)in)[i])<<8;
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	store24bit(out, i, ((uint32_t)((uint8_t*)in)[i])<<24);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=((uint32_t)((uint8_t*)in)[i])<<24;
       break;
     }
@@ -424,15 +945,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(2):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)((((uint16_t*)in)[i])>>8);
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	store24bit(out, i, ((uint32_t)((uint16_t*)in)[i])<<16);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=((uint32_t)((uint16_t*)in)[i])<<16;
       break;
     }
@@ -440,15 +961,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(3):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)(load24bit(in, i)>>24);
       break;
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=(uint16_t)(load24bit(in, i)>>16);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=(uint32_t)load24bit(in, i);
       break;
     }
@@ -456,15 +977,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(4):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)((((uint32_t*)in)[i])>>24);
       break;
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=(uint16_t)((((uint32_t*)in)[i])>>16);
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
         store24bit(out, i, ((uint32_t*)in)[i]);
       break;
     }
@@ -472,48 +993,88 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   }
 }
 
+static inline int32_t clip_s32(double v)
+{
+  if (v >= 2147483647.0)
+    return INT32_MAX;
+  if (v <= -2147483648.0)
+    return INT32_MIN;
+  return lrint(v);
+}
+
 static void float2int(float* in, void* out, int len, int bps)
 {
-  register int i;
+  register int i = 0;
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2)
+    i = float2int_sse2(in, out, len, bps);
+#endif
+  // saturate like the SSE2 versions
   switch(bps){
   case(1):
-    for(i=0;i<len;i++)
-      ((int8_t*)out)[i] = lrintf(127.0 * in[i]);
+    for(;i<len;i++)
+      ((int8_t*)out)[i] = lrintf(av_clipf(127.0 * in[i], -128.0f, 127.0f));
     break;
   case(2):
-    for(i=0;i<len;i++)
-      ((int16_t*)out)[i] = lrintf(32767.0 * in[i]);
+    for(;i<len;i++)
+      ((int16_t*)out)[i] = lrintf(av_clipf(32767.0 * in[i], -32768.0f, 32767.0f));
     break;
   case(3):
-    for(i=0;i<len;i++)
-      store24bit(out, i, lrintf(2147483647.0 * in[i]));
+    for(;i<len;i++)
+      store24bit(out, i, clip_s32(2147483647.0 * in[i]));
     break;
   case(4):
-    for(i=0;i<len;i++)
-      ((int32_t*)out)[i] = lrintf(2147483647.0 * in[i]);
+    for(;i<len;i++)
+      ((int32_t*)out)[i] = clip_s32(2147483647.0 * in[i]);
     break;
   }
 }
 
 static void int2float(void* in, float* out, int len, int bps)
 {
-  register int i;
+  register int i = 0;
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2)
+    i = int2float_sse2(in, out, len, bps);
+#endif
   switch(bps){
   case(1):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/128.0)*((int8_t*)in)[i];
     break;
   case(2):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/32768.0)*((int16_t*)in)[i];
     break;
   case(3):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/2147483648.0)*((int32_t)load24bit(in, i));
     break;
   case(4):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/2147483648.0)*((int32_t*)in)[i];
     break;
   }
 }
+
+static void float2s16_dither(float* in, int16_t* out, int len, uint32_t* seed)
+{
+  register int i = 0;
+  uint32_t s;
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2) {
+    i = len & ~7;
+    if (i)
+      float2s16_dither_sse2(in, out, i, seed);
+  }
+#endif
+  s = seed[0];
+  for(;i<len;i++){
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    out[i] = av_clip_int16(lrintf(32767.0f * in[i] +
+               (1.0f / 65536.0f) * ((int)(s & 0xffff) - (int)(s >> 16))));
+  }
+  seed[0] = s;
+}
@@ -677,6 +677,6 @@ af_info_t af_info_hrtf = {
     "hrtf",
     "ylai",
     "",
-    AF_FLAGS_REENTRANT,
+    AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
     af_open
 };
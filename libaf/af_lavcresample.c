@@ -192,6 +192,6 @@ af_info_t af_info_lavcresample = {
   "lavcresample",
   "Michael Niedermayer",
   "",
-  AF_FLAGS_REENTRANT,
+  AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
   af_open
 };
@@ -206,6 +206,6 @@ af_info_t af_info_pan = {
     "pan",
     "Anders",
     "",
-    AF_FLAGS_REENTRANT,
+    AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
     af_open
 };
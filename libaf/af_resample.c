@@ -390,6 +390,6 @@ af_info_t af_info_resample = {
   "resample",
   "Anders",
   "",
-  AF_FLAGS_REENTRANT,
+  AF_FLAGS_REENTRANT | AF_FLAGS_SHARED_BUFFER,
   af_open
 };
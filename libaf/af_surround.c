@@ -270,6 +270,6 @@ af_info_t af_info_surround =
         "surround",
         "Steve Davies <steve@daviesfam.org>",
         "",
-        AF_FLAGS_NOT_REENTRANT,
+        AF_FLAGS_NOT_REENTRANT | AF_FLAGS_SHARED_BUFFER,
         af_open
 };
@@ -566,6 +566,12 @@ static int init(int rate_hz, int channels, int format, int flags)
       bytes_per_sample *= ao_data.channels;
       ao_data.bps = ao_data.samplerate * bytes_per_sample;
 
+	if (ao_target_latency) {
+	  // four periods, so that a refill is due every quarter of the buffer
+	  alsa_buffer_time = ao_target_latency * 1000;
+	  alsa_fragcount = 4;
+	}
+
 	if ((err = snd_pcm_hw_params_set_buffer_time_near(alsa_handler, alsa_hwparams,
 							  &alsa_buffer_time, NULL)) < 0)
 	  {
@@ -297,6 +297,21 @@ static int init(int rate,int channels,int format,int flags){
   fcntl(audio_fd, F_SETFD, FD_CLOEXEC);
 #endif
 
+#ifdef SNDCTL_DSP_SETFRAGMENT
+  if (ao_target_latency) {
+    // 4 fragments covering the target latency, this has to be set before
+    // the sample format and rate
+    int frag_bytes = rate * channels * (af_fmt2bits(format) / 8) *
+                     ao_target_latency / 4000;
+    int frag = 4;
+    while (frag < 16 && (2 << frag) <= frag_bytes)
+      frag++;
+    frag |= 4 << 16;
+    if (ioctl(audio_fd, SNDCTL_DSP_SETFRAGMENT, &frag) == -1)
+      mp_msg(MSGT_AO,MSGL_WARN,"audio_setup: unable to set fragment size for %d ms latency\n", ao_target_latency);
+  }
+#endif
+
   if(AF_FORMAT_IS_AC3(format)) {
     ao_data.samplerate=rate;
     ioctl (audio_fd, SNDCTL_DSP_SPEED, &ao_data.samplerate);
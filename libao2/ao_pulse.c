@@ -136,6 +136,8 @@ static const struct format_map_s {
 static int init(int rate_hz, int channels, int format, int flags) {
     struct pa_sample_spec ss;
     struct pa_channel_map map;
+    pa_buffer_attr attr, *pattr = NULL;
+    pa_stream_flags_t stream_flags = PA_STREAM_INTERPOLATE_TIMING|PA_STREAM_AUTO_TIMING_UPDATE;
     const struct format_map_s *fmt_map;
     char *devarg = NULL;
     char *host = NULL;
@@ -186,6 +188,19 @@ static int init(int rate_hz, int channels, int format, int flags) {
     pa_channel_map_init_auto(&map, ss.channels, PA_CHANNEL_MAP_ALSA);
     ao_data.bps = pa_bytes_per_second(&ss);
 
+    if (ao_target_latency) {
+        // let the server size its buffers for the requested latency
+        attr.maxlength = (uint32_t) -1;
+        attr.tlength = pa_usec_to_bytes(ao_target_latency * 1000, &ss);
+        attr.prebuf = (uint32_t) -1;
+        attr.minreq = attr.tlength / 4;
+        attr.fragsize = (uint32_t) -1;
+        pattr = &attr;
+#ifdef PA_STREAM_ADJUST_LATENCY
+        stream_flags |= PA_STREAM_ADJUST_LATENCY;
+#endif
+    }
+
     if (!(mainloop = pa_threaded_mainloop_new())) {
         mp_msg(MSGT_AO, MSGL_ERR, "AO: [pulse] Failed to allocate main loop\n");
         goto fail;
@@ -219,7 +234,7 @@ static int init(int rate_hz, int channels, int format, int flags) {
     pa_stream_set_write_callback(stream, stream_request_cb, NULL);
     pa_stream_set_latency_update_callback(stream, stream_latency_update_cb, NULL);
 
-    if (pa_stream_connect_playback(stream, sink, NULL, PA_STREAM_INTERPOLATE_TIMING|PA_STREAM_AUTO_TIMING_UPDATE, NULL, NULL) < 0)
+    if (pa_stream_connect_playback(stream, sink, pattr, stream_flags, NULL, NULL) < 0)
         goto unlock_and_fail;
 
     /* Wait until the stream is ready */
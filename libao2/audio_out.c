@@ -30,6 +30,8 @@
 // there are some globals:
 ao_data_t ao_data={0,0,0,0,OUTBURST,-1,0};
 char *ao_subdevice = NULL;
+// target output latency in ms, 0 lets the drivers pick their buffer sizes
+int ao_target_latency = 0;
 
 extern const ao_functions_t audio_out_oss;
 extern const ao_functions_t audio_out_coreaudio;
@@ -59,6 +59,7 @@ typedef struct ao_data {
 
 extern char *ao_subdevice;
 extern ao_data_t ao_data;
+extern int ao_target_latency;
 
 void list_audio_out(void);
 const ao_functions_t* init_best_audio_out(char** ao_list,int use_plugin,int rate,int channels,int format,int flags);
@@ -203,11 +203,16 @@ ass_track_t* ass_read_subdata(ass_library_t* library, sub_data* subdata, double
 	ass_track_t* track;
 	int i;
 
+	// the track is not updated later, it needs the whole file
+	sub_wait(subdata);
+
 	track = ass_default_track(library);
 	track->name = subdata->filename ? strdup(subdata->filename) : 0;
 
+	// add the events in the order of the subtitle index, by start time
 	for (i = 0; i < subdata->sub_num; ++i) {
-		int eid = ass_process_subtitle(track, subdata->subtitles + i);
+		int n = subdata->sub_order ? subdata->sub_order[i] : i;
+		int eid = ass_process_subtitle(track, subdata->subtitles + n);
 		if (eid < 0)
 			continue;
 		if (!subdata->sub_uses_time) {
@@ -49,7 +49,7 @@ int mplayer_audio_read(char *buf,int size){
 
 static int preinit(sh_audio_t *sh)
 {
-  sh->audio_out_minsize=32*36*2*2; //4608;
+  sh->audio_out_minsize=MP3_FRAME_MAXBYTES;
   return 1;
 }
 
@@ -96,5 +96,5 @@ static int control(sh_audio_t *sh,int cmd,void* arg, ...)
 
 static int decode_audio(sh_audio_t *sh_audio,unsigned char *buf,int minlen,int maxlen)
 {
-   return MP3_DecodeFrame(buf,-1);
+   return MP3_DecodeFrames(buf,minlen,maxlen);
 }
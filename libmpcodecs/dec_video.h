@@ -40,5 +40,7 @@ void resync_video_stream(sh_video_t *sh_video);
 int get_current_video_decoder_lag(sh_video_t *sh_video);
 
 extern int divx_quality;
+extern int pp_threads;
+extern int libmpeg2_threads;
 
 #endif /* MPLAYER_DEC_VIDEO_H */
@@ -46,6 +46,9 @@ LIBVD_EXTERN(libmpeg2)
 
 #include "cpudetect.h"
 
+//number of threads decoding the slices of a picture
+int libmpeg2_threads = 1;
+
 typedef struct {
     mpeg2dec_t *mpeg2dec;
     int quant_store_idx;
@@ -113,6 +116,7 @@ static int init(sh_video_t *sh){
     if(!mpeg2dec) return 0;
 
     mpeg2_custom_fbuf(mpeg2dec,1); // enable DR1
+    mpeg2_threads(mpeg2dec, libmpeg2_threads);
 
     context = calloc(1, sizeof(vd_libmpeg2_ctx_t));
     context->mpeg2dec = mpeg2dec;
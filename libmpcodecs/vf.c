@@ -119,6 +119,7 @@ extern const vf_info_t vf_info_blackframe;
 extern const vf_info_t vf_info_geq;
 extern const vf_info_t vf_info_ow;
 extern const vf_info_t vf_info_fixpts;
+extern const vf_info_t vf_info_pipeline;
 
 // list of available filters:
 static const vf_info_t* const filter_list[]={
@@ -205,6 +206,9 @@ static const vf_info_t* const filter_list[]={
     &vf_info_divtc,
     &vf_info_harddup,
     &vf_info_softskip,
+#if HAVE_PTHREADS
+    &vf_info_pipeline,
+#endif
 #ifdef CONFIG_ASS
     &vf_info_ass,
 #endif
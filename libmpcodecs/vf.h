@@ -107,6 +107,25 @@ typedef struct vf_seteq_s
 #define VFCTRL_GET_PTS         17 /* Return last pts value that reached vf_vo*/
 #define VFCTRL_SET_DEINTERLACE 18 /* Set deinterlacing status */
 #define VFCTRL_GET_DEINTERLACE 19 /* Get deinterlacing status */
+#define VFCTRL_GET_PIPELINE_STATUS 20 /* Frames queued/dropped in vf_pipeline */
+#define VFCTRL_PIPELINE_SYNC   21 /* Wait until vf_pipeline queues are empty */
+#define VFCTRL_PASSCACHE_MARK  22 /* Store/replay an encoding decision in vf_passcache */
+
+typedef struct vf_pipeline_status_s
+{
+    int queued;  // frames waiting to be filtered/encoded
+    int dropped; // frames lost since the last query
+} vf_pipeline_status_t;
+
+#define PASSCACHE_MARK_FRAME     1 /* skip/duplicate decision for the next input frame */
+#define PASSCACHE_MARK_DECODED   2 /* input frame went through the filters */
+#define PASSCACHE_MARK_DUPLICATE 3 /* duplicate frame was sent to the encoder */
+
+typedef struct vf_passcache_mark_s
+{
+    int type;
+    int value;   // stored with -passcache-out, replaced with -passcache-in
+} vf_passcache_mark_t;
 
 #include "vfcap.h"
 
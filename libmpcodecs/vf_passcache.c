@@ -0,0 +1,385 @@
+/*
+ * Frame cache for multi-pass encoding: the first pass stores every frame
+ * that reaches the encoder, together with MEncoder's skip/duplicate
+ * decisions; later passes feed the encoder from the cache instead of
+ * decoding and filtering the input again.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "mp_msg.h"
+
+#if CONFIG_ZLIB
+#include <zlib.h>
+#endif
+
+#include "img_format.h"
+#include "mp_image.h"
+#include "vf.h"
+#include "vf_passcache.h"
+#include "libvo/fastmemcpy.h"
+
+#define CACHE_MAGIC   "MPFC"
+#define CACHE_VERSION 1
+
+// The cache is a temporary file read back by the same binary, so records
+// are stored in native byte order.
+enum {
+    REC_CONFIG = 'C', // width, height, d_width, d_height, flags, outfmt
+    REC_FRAME  = 'F', // width, height, imgfmt, fields, size, compressed, pts
+    REC_MARK   = 'M', // type, value
+};
+
+struct passcache {
+    FILE *f;
+    int replay;
+    int level;              // zlib level, 0 stores frames as they are
+    int failed;             // I/O error or unexpected data, stop using the file
+    unsigned char *raw;     // frame with the rows of all planes packed
+    int raw_size;
+    unsigned char *packed;  // compressed frame
+    int packed_size;
+    mp_image_t *mpi;        // frame being replayed
+};
+
+struct vf_priv_s {
+    struct passcache *pc;
+};
+
+static int grow(unsigned char **buf, int *size, int needed)
+{
+    if (*size < needed) {
+        free(*buf);
+        *buf = malloc(needed);
+        *size = *buf ? needed : 0;
+    }
+    return *buf != NULL;
+}
+
+static int put(struct passcache *pc, const void *data, int len)
+{
+    if (!pc->failed && fwrite(data, len, 1, pc->f) != 1) {
+        mp_msg(MSGT_VFILTER, MSGL_ERR, "[passcache] Error writing the cache file.\n");
+        pc->failed = 1;
+    }
+    return !pc->failed;
+}
+
+static int get(struct passcache *pc, void *data, int len)
+{
+    if (!pc->failed && fread(data, len, 1, pc->f) != 1)
+        pc->failed = 1;
+    return !pc->failed;
+}
+
+// Frames are stored the way copy_mpi() sees them: the visible part of
+// each plane, without padding between the rows.
+static int pack_frame(unsigned char *buf, mp_image_t *mpi, int unpack)
+{
+    int planes = mpi->flags & MP_IMGFLAG_PLANAR ? 3 : 1;
+    int size = 0;
+    int i;
+
+    for (i = 0; i < planes; i++) {
+        int w = i ? mpi->chroma_width  : mpi->w;
+        int h = i ? mpi->chroma_height : mpi->h;
+        if (planes == 1)
+            w *= mpi->bpp / 8;
+        if (buf) {
+            if (unpack)
+                memcpy_pic(mpi->planes[i], buf + size, w, h, mpi->stride[i], w);
+            else
+                memcpy_pic(buf + size, mpi->planes[i], w, h, w, mpi->stride[i]);
+        }
+        size += w * h;
+    }
+    return size;
+}
+
+static void store_frame(struct passcache *pc, mp_image_t *mpi, double pts)
+{
+    int size = pack_frame(NULL, mpi, 0);
+    unsigned char *data;
+    int hdr[7] = { REC_FRAME, mpi->w, mpi->h, mpi->imgfmt, mpi->fields, size, 0 };
+
+    if (pc->failed)
+        return;
+    if (!grow(&pc->raw, &pc->raw_size, size)) {
+        pc->failed = 1;
+        return;
+    }
+    pack_frame(pc->raw, mpi, 0);
+    data = pc->raw;
+#if CONFIG_ZLIB
+    if (pc->level > 0) {
+        uLongf len = compressBound(size);
+        if (grow(&pc->packed, &pc->packed_size, len) &&
+            compress2(pc->packed, &len, pc->raw, size, pc->level) == Z_OK &&
+            len < size) {
+            data = pc->packed;
+            hdr[5] = len;
+            hdr[6] = 1;
+        }
+    }
+#endif
+    if (put(pc, hdr, sizeof(hdr)) && put(pc, &pts, sizeof(pts)))
+        put(pc, data, hdr[5]);
+}
+
+static int replay_frame(struct vf_instance *vf)
+{
+    struct passcache *pc = vf->priv->pc;
+    int hdr[6];
+    double pts;
+    mp_image_t *mpi;
+
+    if (!get(pc, hdr, sizeof(hdr)) || !get(pc, &pts, sizeof(pts)))
+        return 0;
+    if (pc->mpi && (pc->mpi->w != hdr[0] || pc->mpi->h != hdr[1] ||
+                    pc->mpi->imgfmt != hdr[2])) {
+        free_mp_image(pc->mpi);
+        pc->mpi = NULL;
+    }
+    if (!pc->mpi)
+        pc->mpi = alloc_mpi(hdr[0], hdr[1], hdr[2]);
+    mpi = pc->mpi;
+    if (!grow(&pc->raw, &pc->raw_size, pack_frame(NULL, mpi, 1)))
+        return 0;
+
+    if (hdr[5]) {
+#if CONFIG_ZLIB
+        uLongf len = pc->raw_size;
+        if (!grow(&pc->packed, &pc->packed_size, hdr[4]) ||
+            !get(pc, pc->packed, hdr[4]) ||
+            uncompress(pc->raw, &len, pc->packed, hdr[4]) != Z_OK ||
+            len != pack_frame(NULL, mpi, 1))
+            return 0;
+#else
+        mp_msg(MSGT_VFILTER, MSGL_ERR,
+               "[passcache] Compressed cache files need zlib support.\n");
+        return 0;
+#endif
+    } else if (hdr[4] != pack_frame(NULL, mpi, 1) || !get(pc, pc->raw, hdr[4]))
+        return 0;
+
+    pack_frame(pc->raw, mpi, 1);
+    mpi->fields = hdr[3];
+    vf_next_put_image(vf, mpi, pts);
+    return 1;
+}
+
+/// Send the cached frames to the encoder until the next mark, which has to
+/// be the one MEncoder reached now.
+static int replay(struct vf_instance *vf, int type, int *value)
+{
+    struct passcache *pc = vf->priv->pc;
+    int rec;
+
+    while (get(pc, &rec, sizeof(rec))) {
+        switch (rec) {
+        case REC_CONFIG: {
+            int c[6];
+            if (!get(pc, c, sizeof(c)))
+                break;
+            if (!vf_next_config(vf, c[0], c[1], c[2], c[3], c[4], c[5]))
+                return 0;
+            // MEncoder checks this before flushing the encoder
+            vf->fmt.have_configured = 1;
+            continue;
+        }
+        case REC_FRAME:
+            if (replay_frame(vf))
+                continue;
+            break;
+        case REC_MARK: {
+            int m[2];
+            if (!get(pc, m, sizeof(m)))
+                break;
+            if (m[0] == type) {
+                *value = m[1];
+                return 1;
+            }
+            break;
+        }
+        }
+        mp_msg(MSGT_VFILTER, MSGL_ERR, "[passcache] The cache file does not "
+               "match this encode, use the same input and options as for the "
+               "first pass.\n");
+        pc->failed = 1;
+        return 0;
+    }
+    if (type == PASSCACHE_MARK_FRAME)
+        mp_msg(MSGT_VFILTER, MSGL_WARN,
+               "[passcache] The cache file ends before the input.\n");
+    return 0;
+}
+
+static int config(struct vf_instance *vf,
+                  int width, int height, int d_width, int d_height,
+                  unsigned int flags, unsigned int outfmt)
+{
+    struct passcache *pc = vf->priv->pc;
+    int rec[7] = { REC_CONFIG, width, height, d_width, d_height, flags, outfmt };
+
+    // when replaying, the encoder is configured from the cache
+    if (pc->replay)
+        return 1;
+    put(pc, rec, sizeof(rec));
+    return vf_next_config(vf, width, height, d_width, d_height, flags, outfmt);
+}
+
+static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
+{
+    mp_image_t *dmpi;
+
+    if (vf->priv->pc->replay)
+        return 0;
+    store_frame(vf->priv->pc, mpi, pts);
+
+    dmpi = vf_get_image(vf->next, mpi->imgfmt,
+                        MP_IMGTYPE_EXPORT, 0, mpi->width, mpi->height);
+    dmpi->planes[0] = mpi->planes[0];
+    dmpi->stride[0] = mpi->stride[0];
+    if (dmpi->flags & MP_IMGFLAG_PLANAR) {
+        dmpi->planes[1] = mpi->planes[1];
+        dmpi->stride[1] = mpi->stride[1];
+        dmpi->planes[2] = mpi->planes[2];
+        dmpi->stride[2] = mpi->stride[2];
+    }
+    vf_clone_mpi_attributes(dmpi, mpi);
+
+    return vf_next_put_image(vf, dmpi, pts);
+}
+
+static int control(struct vf_instance *vf, int request, void *data)
+{
+    struct passcache *pc = vf->priv->pc;
+
+    switch (request) {
+    case VFCTRL_PASSCACHE_MARK: {
+        vf_passcache_mark_t *mark = data;
+        if (pc->replay)
+            return pc->failed ? CONTROL_FALSE :
+                   replay(vf, mark->type, &mark->value) ? CONTROL_TRUE : CONTROL_FALSE;
+        if (!pc->failed) {
+            int rec[3] = { REC_MARK, mark->type, mark->value };
+            put(pc, rec, sizeof(rec));
+        }
+        return CONTROL_TRUE;
+    }
+    case VFCTRL_DUPLICATE_FRAME:
+        // frames a duplicate needs were stored before its mark
+        if (pc->replay)
+            return CONTROL_FALSE;
+        break;
+    }
+    return vf_next_control(vf, request, data);
+}
+
+static int query_format(struct vf_instance *vf, unsigned int fmt)
+{
+    return vf_next_query_format(vf, fmt);
+}
+
+static void uninit(struct vf_instance *vf)
+{
+    free(vf->priv);
+}
+
+static int vf_open(vf_instance_t *vf, char *args)
+{
+    vf->config = config;
+    vf->put_image = put_image;
+    vf->control = control;
+    vf->query_format = query_format;
+    vf->uninit = uninit;
+    vf->priv = calloc(1, sizeof(struct vf_priv_s));
+    if (!vf->priv)
+        return 0;
+    vf->priv->pc = (struct passcache *)args;
+    return 1;
+}
+
+static const vf_info_t vf_info_passcache = {
+    "multi-pass encoding frame cache",
+    "passcache",
+    "",
+    "",
+    vf_open,
+    NULL
+};
+
+vf_instance_t *vf_open_passcache(vf_instance_t *next, struct passcache *pc)
+{
+    static const vf_info_t * const list[] = { &vf_info_passcache, NULL };
+    char *args[] = { "_oldargs_", (char *)pc, NULL };
+    return vf_open_plugin(list, next, "passcache", args);
+}
+
+struct passcache *passcache_open(const char *filename, int replay, int level)
+{
+    struct passcache *pc = calloc(1, sizeof(struct passcache));
+    char magic[4];
+    int version = CACHE_VERSION;
+
+    if (!pc)
+        return NULL;
+    pc->replay = replay;
+#if CONFIG_ZLIB
+    pc->level = level;
+#endif
+    pc->f = fopen(filename, replay ? "rb" : "wb");
+    if (!pc->f) {
+        free(pc);
+        return NULL;
+    }
+    if (replay) {
+        if (!get(pc, magic, 4) || memcmp(magic, CACHE_MAGIC, 4) ||
+            !get(pc, &version, sizeof(version)) || version != CACHE_VERSION) {
+            mp_msg(MSGT_VFILTER, MSGL_ERR,
+                   "[passcache] %s is not a frame cache of this version.\n",
+                   filename);
+            fclose(pc->f);
+            free(pc);
+            return NULL;
+        }
+    } else
+        if (!put(pc, CACHE_MAGIC, 4) || !put(pc, &version, sizeof(version))) {
+            fclose(pc->f);
+            free(pc);
+            return NULL;
+        }
+    return pc;
+}
+
+void passcache_close(struct passcache *pc)
+{
+    if (!pc)
+        return;
+    if (fclose(pc->f) && !pc->replay && !pc->failed)
+        mp_msg(MSGT_VFILTER, MSGL_ERR, "[passcache] Error writing the cache file.\n");
+    if (pc->mpi)
+        free_mp_image(pc->mpi);
+    free(pc->raw);
+    free(pc->packed);
+    free(pc);
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_VF_PASSCACHE_H
+#define MPLAYER_VF_PASSCACHE_H
+
+#include "vf.h"
+
+struct passcache;
+
+/**
+ * \brief open the frame cache of a multi-pass encode
+ * \param replay 0 to store the frames reaching the encoder,
+ *               1 to feed the encoder from an existing cache
+ * \param level zlib compression level for stored frames, 0 for none
+ */
+struct passcache *passcache_open(const char *filename, int replay, int level);
+void passcache_close(struct passcache *pc);
+
+/// Insert the cache in front of the encoder, once for every input file.
+vf_instance_t *vf_open_passcache(vf_instance_t *next, struct passcache *pc);
+
+#endif /* MPLAYER_VF_PASSCACHE_H */
@@ -0,0 +1,294 @@
+/*
+ * Run the rest of the filter chain, and with MEncoder the video encoder,
+ * in a separate thread. Incoming frames are copied into a bounded queue so
+ * that decoding the next frame overlaps with filtering and encoding.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+
+#include "img_format.h"
+#include "mp_image.h"
+#include "vf.h"
+
+#define MAX_DEPTH 32
+
+struct slot {
+    mp_image_t *mpi;
+    int qsize;          // allocated size of mpi->qscale
+    double pts;
+    int expect_drop;    // downstream was told to skip this frame
+    int is_mark;        // no frame, pass a VFCTRL_PASSCACHE_MARK on
+    vf_passcache_mark_t mark;
+};
+
+struct vf_priv_s {
+    int depth;
+    struct slot slots[MAX_DEPTH];
+    int head, count;    // next slot for the worker, slots in use
+    int marks;          // slots in use that hold no frame
+    int busy;           // the worker is running the chain
+    int skip_next;      // VFCTRL_SKIP_NEXT_FRAME was accepted downstream
+    int dropped;        // frames the rest of the chain did not output
+    int quit;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake_worker;
+    pthread_cond_t wake_main;
+};
+
+static void *worker(void *arg)
+{
+    struct vf_instance *vf = arg;
+    struct vf_priv_s *p = vf->priv;
+
+    pthread_mutex_lock(&p->lock);
+    while (1) {
+        struct slot *s;
+        int ret;
+        while (!p->count && !p->quit)
+            pthread_cond_wait(&p->wake_worker, &p->lock);
+        if (!p->count)
+            break;
+        s = &p->slots[p->head];
+        p->busy = 1;
+        pthread_mutex_unlock(&p->lock);
+
+        if (s->is_mark)
+            ret = vf_next_control(vf, VFCTRL_PASSCACHE_MARK, &s->mark) != CONTROL_FALSE;
+        else
+            ret = vf_next_put_image(vf, s->mpi, s->pts);
+
+        pthread_mutex_lock(&p->lock);
+        if (s->is_mark)
+            p->marks--;
+        else if (!ret && !s->expect_drop)
+            p->dropped++;
+        p->head = (p->head + 1) % p->depth;
+        p->count--;
+        p->busy = 0;
+        pthread_cond_signal(&p->wake_main);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// Wait until the worker has run all queued frames through the chain.
+static void drain(struct vf_priv_s *p)
+{
+    pthread_mutex_lock(&p->lock);
+    while (p->count)
+        pthread_cond_wait(&p->wake_main, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static int config(struct vf_instance *vf,
+                  int width, int height, int d_width, int d_height,
+                  unsigned int flags, unsigned int outfmt)
+{
+    struct vf_instance *f;
+    for (f = vf->next; f; f = f->next)
+        if (!strcmp(f->info->name, "vo")) {
+            mp_msg(MSGT_VFILTER, MSGL_ERR,
+                   "[pipeline] Video outputs cannot be run from a thread, "
+                   "this filter only works with MEncoder.\n");
+            return 0;
+        }
+    drain(vf->priv);
+    return vf_next_config(vf, width, height, d_width, d_height, flags, outfmt);
+}
+
+// Wait for a free slot, it is not in use by the worker until queued.
+static struct slot *get_slot(struct vf_priv_s *p)
+{
+    struct slot *s;
+    pthread_mutex_lock(&p->lock);
+    while (p->count == p->depth)
+        pthread_cond_wait(&p->wake_main, &p->lock);
+    s = &p->slots[(p->head + p->count) % p->depth];
+    pthread_mutex_unlock(&p->lock);
+    return s;
+}
+
+static void queue_slot(struct vf_priv_s *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->count++;
+    pthread_cond_signal(&p->wake_worker);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
+{
+    struct vf_priv_s *p = vf->priv;
+    struct slot *s = get_slot(p);
+
+    // The slot is not in use by the worker, so it can be filled unlocked.
+    if (s->mpi && (s->mpi->imgfmt != mpi->imgfmt ||
+                   s->mpi->w != mpi->w || s->mpi->h != mpi->h)) {
+        free_mp_image(s->mpi);
+        s->mpi = NULL;
+        s->qsize = 0;
+    }
+    if (!s->mpi)
+        s->mpi = alloc_mpi(mpi->w, mpi->h, mpi->imgfmt);
+    copy_mpi(s->mpi, mpi);
+    s->mpi->pict_type = mpi->pict_type;
+    s->mpi->fields = mpi->fields;
+    s->mpi->qscale_type = mpi->qscale_type;
+    s->mpi->qstride = 0;
+    if (mpi->qscale && mpi->qstride) {
+        int qsize = mpi->qstride * ((mpi->h + 15) >> 4);
+        if (s->qsize < qsize) {
+            // qscale is not freed by free_mp_image, set it free here
+            free(s->mpi->qscale);
+            s->mpi->qscale = malloc(qsize);
+            s->qsize = s->mpi->qscale ? qsize : 0;
+        }
+        if (s->qsize) {
+            memcpy(s->mpi->qscale, mpi->qscale, qsize);
+            s->mpi->qstride = mpi->qstride;
+        }
+    }
+    s->pts = pts;
+    s->expect_drop = p->skip_next;
+    s->is_mark = 0;
+    p->skip_next = 0;
+
+    queue_slot(p);
+    return 1;
+}
+
+static int control(struct vf_instance *vf, int request, void *data)
+{
+    struct vf_priv_s *p = vf->priv;
+    int ret;
+
+    switch (request) {
+    case VFCTRL_GET_PIPELINE_STATUS: {
+        vf_pipeline_status_t *st = data;
+        pthread_mutex_lock(&p->lock);
+        st->queued += p->count - p->marks;
+        st->dropped += p->dropped;
+        p->dropped = 0;
+        pthread_mutex_unlock(&p->lock);
+        // there may be more than one pipeline in the chain
+        vf_next_control(vf, request, data);
+        return CONTROL_TRUE;
+    }
+    case VFCTRL_PASSCACHE_MARK: {
+        // stored in order with the frames, without waiting for them
+        struct slot *s = get_slot(p);
+        s->mark = *(vf_passcache_mark_t *)data;
+        s->expect_drop = 0;
+        s->is_mark = 1;
+        pthread_mutex_lock(&p->lock);
+        p->marks++;
+        pthread_mutex_unlock(&p->lock);
+        queue_slot(p);
+        return CONTROL_TRUE;
+    }
+    }
+    // Everything else has to reach the rest of the chain in order with
+    // the frames, and with the worker idle.
+    drain(p);
+    ret = vf_next_control(vf, request, data);
+    if (request == VFCTRL_SKIP_NEXT_FRAME && ret == CONTROL_TRUE)
+        p->skip_next = 1;
+    return ret;
+}
+
+static int query_format(struct vf_instance *vf, unsigned int fmt)
+{
+    return vf_next_query_format(vf, fmt);
+}
+
+static void uninit(struct vf_instance *vf)
+{
+    struct vf_priv_s *p = vf->priv;
+    int i;
+
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_signal(&p->wake_worker);
+    pthread_mutex_unlock(&p->lock);
+    pthread_join(p->thread, NULL);
+
+    for (i = 0; i < p->depth; i++)
+        if (p->slots[i].mpi) {
+            free(p->slots[i].mpi->qscale);
+            free_mp_image(p->slots[i].mpi);
+        }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake_worker);
+    pthread_cond_destroy(&p->wake_main);
+    free(p);
+}
+
+static int vf_open(vf_instance_t *vf, char *args)
+{
+    struct vf_priv_s *p;
+
+    vf->config = config;
+    vf->put_image = put_image;
+    vf->control = control;
+    vf->query_format = query_format;
+    vf->uninit = uninit;
+    vf->priv = p = calloc(1, sizeof(struct vf_priv_s));
+    if (!p)
+        return 0;
+
+    p->depth = 4;
+    if (args)
+        sscanf(args, "%d", &p->depth);
+    if (p->depth < 1 || p->depth > MAX_DEPTH) {
+        mp_msg(MSGT_VFILTER, MSGL_ERR,
+               "[pipeline] Queue depth must be between 1 and %d.\n", MAX_DEPTH);
+        free(p);
+        return 0;
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake_worker, NULL);
+    pthread_cond_init(&p->wake_main, NULL);
+    if (pthread_create(&p->thread, NULL, worker, vf)) {
+        mp_msg(MSGT_VFILTER, MSGL_ERR, "[pipeline] Could not create thread.\n");
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->wake_worker);
+        pthread_cond_destroy(&p->wake_main);
+        free(p);
+        return 0;
+    }
+    mp_msg(MSGT_VFILTER, MSGL_V, "[pipeline] Queue depth %d\n", p->depth);
+    return 1;
+}
+
+const vf_info_t vf_info_pipeline = {
+    "run the rest of the chain in a separate thread",
+    "pipeline",
+    "",
+    "",
+    vf_open,
+    NULL
+};
@@ -43,6 +43,9 @@
 
 #undef malloc
 
+//number of threads filtering the rows of blocks of each plane
+int pp_threads=1;
+
 struct vf_priv_s {
     int pp;
     pp_mode_t *ppMode[PP_QUALITY_MAX+1];
@@ -69,6 +72,7 @@ static int config(struct vf_instance *vf,
 
     if(vf->priv->context) pp_free_context(vf->priv->context);
     vf->priv->context= pp_get_context(width, height, flags);
+    if(vf->priv->context) pp_set_threads(vf->priv->context, pp_threads);
 
     return vf_next_config(vf,width,height,d_width,d_height,voflags,outfmt);
 }
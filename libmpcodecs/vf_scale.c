@@ -22,6 +22,9 @@
 #include <inttypes.h>
 
 #include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "mp_msg.h"
 #include "cpudetect.h"
 
@@ -276,24 +279,27 @@ static int config(struct vf_instance *vf,
 	vf->priv->w,vf->priv->h,vo_format_name(best));
 
     // free old ctx:
-    if(vf->priv->ctx) sws_freeContext(vf->priv->ctx);
-    if(vf->priv->ctx2)sws_freeContext(vf->priv->ctx2);
+    sws_releaseContext(vf->priv->ctx);
+    sws_releaseContext(vf->priv->ctx2);
+    vf->priv->ctx = vf->priv->ctx2 = NULL;
 
     // new swscaler:
     sws_getFlagsAndFilterFromCmdLine(&int_sws_flags, &srcFilter, &dstFilter);
     int_sws_flags|= vf->priv->v_chr_drop << SWS_SRC_V_CHR_DROP_SHIFT;
     int_sws_flags|= vf->priv->accurate_rnd * SWS_ACCURATE_RND;
-    vf->priv->ctx=sws_getContext(width, height >> vf->priv->interlaced,
+    vf->priv->ctx=sws_acquireContext(width, height >> vf->priv->interlaced,
 	    sfmt,
 		  vf->priv->w, vf->priv->h >> vf->priv->interlaced,
 	    dfmt,
 	    int_sws_flags | get_sws_cpuflags(), srcFilter, dstFilter, vf->priv->param);
+    if(vf->priv->ctx) sws_setThreads(vf->priv->ctx, sws_threads);
     if(vf->priv->interlaced){
-        vf->priv->ctx2=sws_getContext(width, height >> 1,
+        vf->priv->ctx2=sws_acquireContext(width, height >> 1,
 	    sfmt,
 		  vf->priv->w, vf->priv->h >> 1,
 	    dfmt,
 	    int_sws_flags | get_sws_cpuflags(), srcFilter, dstFilter, vf->priv->param);
+        if(vf->priv->ctx2) sws_setThreads(vf->priv->ctx2, sws_threads);
     }
     if(!vf->priv->ctx){
 	// error...
@@ -556,8 +562,8 @@ static int query_format(struct vf_instance *vf, unsigned int fmt){
 }
 
 static void uninit(struct vf_instance *vf){
-    if(vf->priv->ctx) sws_freeContext(vf->priv->ctx);
-    if(vf->priv->ctx2) sws_freeContext(vf->priv->ctx2);
+    sws_releaseContext(vf->priv->ctx);
+    sws_releaseContext(vf->priv->ctx2);
     if(vf->priv->palette) free(vf->priv->palette);
     free(vf->priv);
 }
@@ -590,11 +596,15 @@ int sws_chr_hshift= 0;
 float sws_chr_sharpen= 0.0;
 float sws_lum_sharpen= 0.0;
 
+//number of threads scaling a frame, see sws_setThreads()
+int sws_threads= 1;
+
 int get_sws_cpuflags(void){
     return
           (gCpuCaps.hasMMX   ? SWS_CPU_CAPS_MMX   : 0)
 	| (gCpuCaps.hasMMX2  ? SWS_CPU_CAPS_MMX2  : 0)
 	| (gCpuCaps.has3DNow ? SWS_CPU_CAPS_3DNOW : 0)
+	| (gCpuCaps.hasSSE2  ? SWS_CPU_CAPS_SSE2  : 0)
         | (gCpuCaps.hasAltiVec ? SWS_CPU_CAPS_ALTIVEC : 0);
 }
 
@@ -647,13 +657,209 @@ struct SwsContext *sws_getContextFromCmdLine(int srcW, int srcH, int srcFormat,
 	int flags;
 	SwsFilter *dstFilterParam, *srcFilterParam;
 	enum PixelFormat dfmt, sfmt;
+	struct SwsContext *ctx;
 
 	dfmt = imgfmt2pixfmt(dstFormat);
 	sfmt = imgfmt2pixfmt(srcFormat);
 	if (srcFormat == IMGFMT_RGB8 || srcFormat == IMGFMT_BGR8) sfmt = PIX_FMT_PAL8;
 	sws_getFlagsAndFilterFromCmdLine(&flags, &srcFilterParam, &dstFilterParam);
 
-	return sws_getContext(srcW, srcH, sfmt, dstW, dstH, dfmt, flags | get_sws_cpuflags(), srcFilterParam, dstFilterParam, NULL);
+	ctx= sws_acquireContext(srcW, srcH, sfmt, dstW, dstH, dfmt, flags | get_sws_cpuflags(), srcFilterParam, dstFilterParam, NULL);
+	if(ctx) sws_setThreads(ctx, sws_threads);
+	return ctx;
+}
+
+//number of unused contexts kept for reuse by sws_acquireContext()
+int sws_cache_size= 4;
+
+/* A context holds the state of the frame being scaled, so it is never given
+ * to two users at the same time. Released contexts are kept until they are
+ * the least recently used ones beyond sws_cache_size. */
+struct sws_cache_entry {
+    struct SwsContext *ctx;
+    int srcW, srcH, dstW, dstH;
+    enum PixelFormat srcFormat, dstFormat;
+    int flags;
+    double param[2];
+    double *filter;     // lengths and coefficients of all filter vectors
+    int filter_len;
+    int users;
+    unsigned last_use;
+    // colorspace details as created, equalizer changes are undone on reuse
+    int has_csp;
+    int inv_table[4], table[4];
+    int srcRange, dstRange, brightness, contrast, saturation;
+};
+
+static struct sws_cache_entry *sws_cache;
+static int sws_cache_count;
+static unsigned sws_cache_clock;
+
+#if HAVE_PTHREADS
+/* filters on the -vf pipeline thread use the cache too */
+static pthread_mutex_t sws_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_SWS_CACHE()   pthread_mutex_lock(&sws_cache_lock)
+#define UNLOCK_SWS_CACHE() pthread_mutex_unlock(&sws_cache_lock)
+#else
+#define LOCK_SWS_CACHE()
+#define UNLOCK_SWS_CACHE()
+#endif
+
+static int sws_filter_key(SwsFilter *srcFilter, SwsFilter *dstFilter, double *key)
+{
+    SwsFilter *f[2] = {srcFilter, dstFilter};
+    int i, j, n = 0;
+
+    for (i = 0; i < 2; i++) {
+        SwsVector *v[4] = {NULL, NULL, NULL, NULL};
+        if (f[i]) {
+            v[0] = f[i]->lumH; v[1] = f[i]->lumV;
+            v[2] = f[i]->chrH; v[3] = f[i]->chrV;
+        }
+        for (j = 0; j < 4; j++) {
+            int len = v[j] ? v[j]->length : -1;
+            if (key) {
+                key[n] = len;
+                if (len > 0)
+                    memcpy(key + n + 1, v[j]->coeff, len * sizeof(double));
+            }
+            n += 1 + (len > 0 ? len : 0);
+        }
+    }
+    return n;
+}
+
+static void sws_cache_evict(void)
+{
+    int i, idle = 0, lru;
+
+    for (i = 0; i < sws_cache_count; i++)
+        if (!sws_cache[i].users) idle++;
+    while (idle > sws_cache_size) {
+        lru = -1;
+        for (i = 0; i < sws_cache_count; i++)
+            if (!sws_cache[i].users &&
+                (lru < 0 || (int)(sws_cache[i].last_use - sws_cache[lru].last_use) < 0))
+                lru = i;
+        sws_freeContext(sws_cache[lru].ctx);
+        free(sws_cache[lru].filter);
+        sws_cache[lru] = sws_cache[--sws_cache_count];
+        idle--;
+    }
+}
+
+static struct SwsContext *sws_cache_get(int srcW, int srcH, enum PixelFormat srcFormat,
+                                        int dstW, int dstH, enum PixelFormat dstFormat,
+                                        int flags, SwsFilter *srcFilter, SwsFilter *dstFilter,
+                                        const double *param)
+{
+    double p[2] = {SWS_PARAM_DEFAULT, SWS_PARAM_DEFAULT};
+    int len = sws_filter_key(srcFilter, dstFilter, NULL);
+    double *key = malloc(len * sizeof(double));
+    struct sws_cache_entry *e;
+    struct SwsContext *ctx;
+    int i, *inv_table, *table;
+
+    if (!key)
+        return NULL;
+    sws_filter_key(srcFilter, dstFilter, key);
+    if (param) {
+        p[0] = param[0];
+        p[1] = param[1];
+    }
+
+    for (i = 0; i < sws_cache_count; i++) {
+        e = &sws_cache[i];
+        if (e->users || e->srcW != srcW || e->srcH != srcH ||
+            e->dstW != dstW || e->dstH != dstH ||
+            e->srcFormat != srcFormat || e->dstFormat != dstFormat ||
+            (e->flags ^ flags) & ~SWS_PRINT_INFO ||
+            memcmp(e->param, p, sizeof(p)) || e->filter_len != len ||
+            memcmp(e->filter, key, len * sizeof(double)))
+            continue;
+        free(key);
+        e->users = 1;
+        e->last_use = ++sws_cache_clock;
+        if (e->has_csp)
+            sws_setColorspaceDetails(e->ctx, e->inv_table, e->srcRange,
+                                     e->table, e->dstRange, e->brightness,
+                                     e->contrast, e->saturation);
+        mp_msg(MSGT_VFILTER, MSGL_DBG2, "SwScale: reusing context for %dx%d -> %dx%d\n",
+               srcW, srcH, dstW, dstH);
+        return e->ctx;
+    }
+
+    ctx = sws_getContext(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                         flags, srcFilter, dstFilter, param);
+    e = realloc(sws_cache, (sws_cache_count + 1) * sizeof(*sws_cache));
+    if (!ctx || !e) {
+        if (e) sws_cache = e;
+        if (ctx) sws_freeContext(ctx);
+        free(key);
+        return NULL;
+    }
+    sws_cache = e;
+    e = &sws_cache[sws_cache_count++];
+    memset(e, 0, sizeof(*e));
+    e->ctx        = ctx;
+    e->srcW       = srcW;
+    e->srcH       = srcH;
+    e->dstW       = dstW;
+    e->dstH       = dstH;
+    e->srcFormat  = srcFormat;
+    e->dstFormat  = dstFormat;
+    e->flags      = flags;
+    e->param[0]   = p[0];
+    e->param[1]   = p[1];
+    e->filter     = key;
+    e->filter_len = len;
+    e->users      = 1;
+    e->last_use   = ++sws_cache_clock;
+    if (sws_getColorspaceDetails(ctx, &inv_table, &e->srcRange, &table,
+                                 &e->dstRange, &e->brightness, &e->contrast,
+                                 &e->saturation) >= 0) {
+        e->has_csp = 1;
+        memcpy(e->inv_table, inv_table, sizeof(e->inv_table));
+        memcpy(e->table, table, sizeof(e->table));
+    }
+    return ctx;
+}
+
+struct SwsContext *sws_acquireContext(int srcW, int srcH, enum PixelFormat srcFormat,
+                                      int dstW, int dstH, enum PixelFormat dstFormat,
+                                      int flags, SwsFilter *srcFilter, SwsFilter *dstFilter,
+                                      const double *param)
+{
+    struct SwsContext *ctx;
+
+    LOCK_SWS_CACHE();
+    ctx = sws_cache_get(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                        flags, srcFilter, dstFilter, param);
+    UNLOCK_SWS_CACHE();
+    return ctx;
+}
+
+void sws_releaseContext(struct SwsContext *ctx)
+{
+    int i;
+
+    if (!ctx)
+        return;
+    LOCK_SWS_CACHE();
+    for (i = 0; i < sws_cache_count; i++)
+        if (sws_cache[i].ctx == ctx)
+            break;
+    if (i == sws_cache_count) {
+        UNLOCK_SWS_CACHE();
+        sws_freeContext(ctx);
+        return;
+    }
+    sws_cache[i].users = 0;
+    sws_cache[i].last_use = ++sws_cache_clock;
+    // idle contexts do not keep threads around
+    sws_setThreads(ctx, 1);
+    sws_cache_evict();
+    UNLOCK_SWS_CACHE();
 }
 
 /// An example of presets usage
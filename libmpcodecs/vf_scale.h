@@ -19,7 +19,24 @@
 #ifndef MPLAYER_VF_SCALE_H
 #define MPLAYER_VF_SCALE_H
 
+#include "libswscale/swscale.h"
+
+extern int sws_threads;
+extern int sws_cache_size;
+
 int get_sws_cpuflags(void);
+/// The returned context must be given back with sws_releaseContext().
 struct SwsContext *sws_getContextFromCmdLine(int srcW, int srcH, int srcFormat, int dstW, int dstH, int dstFormat);
 
+/**
+ * \brief like sws_getContext(), but reuses a released context with the same
+ *        parameters if there is one
+ */
+struct SwsContext *sws_acquireContext(int srcW, int srcH, enum PixelFormat srcFormat,
+                                      int dstW, int dstH, enum PixelFormat dstFormat,
+                                      int flags, SwsFilter *srcFilter, SwsFilter *dstFilter,
+                                      const double *param);
+/// Give back a context, the last sws_cache_size unused ones are kept.
+void sws_releaseContext(struct SwsContext *ctx);
+
 #endif /* MPLAYER_VF_SCALE_H */
@@ -62,6 +62,7 @@ static int config(struct vf_instance *vf,
                   int width, int height, int d_width, int d_height,
                   unsigned int flags, unsigned int outfmt)
 {
+    sws_releaseContext(vf->priv->ctx);
     vf->priv->ctx=sws_getContextFromCmdLine(width, height, outfmt,
                                  d_width, d_height, IMGFMT_RGB24);
 
@@ -277,7 +278,7 @@ static void uninit(vf_instance_t *vf)
 {
     avcodec_close(vf->priv->avctx);
     av_freep(&vf->priv->avctx);
-    if(vf->priv->ctx) sws_freeContext(vf->priv->ctx);
+    sws_releaseContext(vf->priv->ctx);
     if (vf->priv->buffer) av_free(vf->priv->buffer);
     free(vf->priv->outbuffer);
     free(vf->priv);
@@ -41,8 +41,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <limits.h>
 
 #include "config.h"
 
@@ -66,6 +68,7 @@
 #include "libavutil/intreadwrite.h"
 
 #include "libvo/sub.h"
+#include "osdep/timer.h"
 
 #include "demux_mov.h"
 #include "qtpalette.h"
@@ -83,7 +86,7 @@
 #define char2int(x,y) 	AV_RB32(&(x)[(y)])
 
 typedef struct {
-    unsigned int pts; // duration
+    uint64_t pts;
     unsigned int size;
     off_t pos;
 } mov_sample_t;
@@ -104,6 +107,8 @@ typedef struct {
 typedef struct {
     unsigned int num;
     unsigned int dur;
+    unsigned int first; // number of the first sample of the run
+    uint64_t pts;       // pts of the first sample of the run
 } mov_durmap_t;
 
 typedef struct {
@@ -150,7 +155,12 @@ typedef struct {
     int stream_header_len; // if >0, this header should be sent before the 1st frame
     //
     int samples_size;
-    mov_sample_t* samples;
+    int sizes_size;
+    unsigned int* sizes;  // from stsz, NULL if all samples are fixed_size long
+    unsigned int fixed_size;
+    mov_sample_t* window; // samples materialized around the playback position
+    int window_start;
+    int window_len;
     int chunks_size;
     mov_chunk_t* chunks;
     int chunkmap_size;
@@ -163,13 +173,117 @@ typedef struct {
     mov_editlist_t* editlist;
     int editlist_pos;
     //
+    unsigned int track_id; // from tkhd, fragments refer to the track by it
+    int fragmented;
+    unsigned int trex_duration; // sample defaults for fragments
+    unsigned int trex_size;
+    unsigned int trex_flags;
+    //
     void* desc; // image/sound/etc description (pointer to ImageDescription etc)
 } mov_track_t;
 
+// number of samples materialized at once by mov_get_sample()
+#define MOV_SAMPLE_WINDOW 1024
+
+static unsigned int mov_sample_size(mov_track_t* trak,int s){
+    if(!trak->sizes) return trak->fixed_size;
+    return s<trak->sizes_size ? trak->sizes[s] : 0;
+}
+
+// durmap run of sample s, the last run if s is beyond all of them
+static int mov_find_run(mov_track_t* trak,int s){
+    int lo=0,hi=trak->durmap_size-1;
+    while(lo<hi){
+	int mid=(lo+hi+1)/2;
+	if(trak->durmap[mid].first<=s) lo=mid; else hi=mid-1;
+    }
+    return lo;
+}
+
+static uint64_t mov_sample_pts(mov_track_t* trak,int s){
+    mov_durmap_t* run;
+    if(!trak->durmap_size) return 0;
+    run=&trak->durmap[mov_find_run(trak,s)];
+    return run->pts+(uint64_t)FFMIN(s-run->first,run->num)*run->dur;
+}
+
+// first sample with a pts not below the given one, samples_size if none
+static int mov_find_sample(mov_track_t* trak,uint64_t pts){
+    int lo=0,hi=trak->durmap_size;
+    mov_durmap_t* run;
+    // find the first run whose last sample is not before pts
+    while(lo<hi){
+	int mid=(lo+hi)/2;
+	run=&trak->durmap[mid];
+	if(run->pts+(uint64_t)(run->num-1)*run->dur<pts) lo=mid+1; else hi=mid;
+    }
+    if(lo==trak->durmap_size){
+	// samples missing from the durmap have the pts of its end
+	int end=lo ? trak->durmap[lo-1].first+trak->durmap[lo-1].num : 0;
+	if(end<trak->samples_size && mov_sample_pts(trak,end)>=pts) return end;
+	return trak->samples_size;
+    }
+    run=&trak->durmap[lo];
+    if(pts<=run->pts) return run->first;
+    return run->first+(pts-run->pts+run->dur-1)/run->dur;
+}
+
+// chunk containing sample s, -1 if there is none
+static int mov_find_chunk(mov_track_t* trak,int s){
+    int lo=0,hi=trak->chunks_size-1;
+    if(hi<0) return -1;
+    while(lo<hi){
+	int mid=(lo+hi+1)/2;
+	if(trak->chunks[mid].sample<=s) lo=mid; else hi=mid-1;
+    }
+    if(s>=trak->chunks[lo].sample+trak->chunks[lo].size) return -1;
+    return lo;
+}
+
+// materialize the samples starting at s
+static void mov_fill_window(mov_track_t* trak,int s){
+    int c=mov_find_chunk(trak,s);
+    off_t pos=0;
+    int i;
+    if(c>=0){
+	if(trak->window_len && s==trak->window_start+trak->window_len &&
+	   s>trak->chunks[c].sample){
+	    // continue the chunk where the previous window stopped
+	    mov_sample_t* last=&trak->window[trak->window_len-1];
+	    pos=last->pos+last->size;
+	} else {
+	    pos=trak->chunks[c].pos;
+	    for(i=trak->chunks[c].sample;i<s;i++)
+		pos+=mov_sample_size(trak,i);
+	}
+    }
+    trak->window_start=s;
+    trak->window_len=FFMIN(MOV_SAMPLE_WINDOW,trak->samples_size-s);
+    for(i=0;i<trak->window_len;i++,s++){
+	mov_sample_t* sample=&trak->window[i];
+	if(c>=0 && s>=trak->chunks[c].sample+trak->chunks[c].size){
+	    // samples of a chunk follow the ones of the previous chunk
+	    do ++c; while(c<trak->chunks_size && !trak->chunks[c].size);
+	    if(c<trak->chunks_size) pos=trak->chunks[c].pos; else c=-1;
+	}
+	sample->pts=mov_sample_pts(trak,s);
+	sample->size=mov_sample_size(trak,s);
+	sample->pos=c>=0 ? pos : 0;
+	pos+=sample->size;
+    }
+}
+
+// s must be below samples_size
+static mov_sample_t* mov_get_sample(mov_track_t* trak,int s){
+    if(s<trak->window_start || s>=trak->window_start+trak->window_len)
+	mov_fill_window(trak,s);
+    return &trak->window[s-trak->window_start];
+}
+
 static void mov_build_index(mov_track_t* trak,int timescale){
     int i,j,s;
     int last=trak->chunks_size;
-    unsigned int pts=0;
+    uint64_t pts=0;
 
 #if 0
     if (trak->chunks_size <= 0)
@@ -228,14 +342,12 @@ static void mov_build_index(mov_track_t* trak,int timescale){
 
     // workaround for fixed-size video frames (dv and uncompressed)
     if(!trak->samples_size && trak->type!=MOV_TRAK_AUDIO){
-	trak->samples=calloc(s, sizeof(mov_sample_t));
-	trak->samples_size=trak->samples ? s : 0;
-	for(i=0;i<trak->samples_size;i++)
-	    trak->samples[i].size=trak->samplesize;
+	trak->fixed_size=trak->samplesize;
+	trak->samples_size=s;
 	trak->samplesize=0;
     }
 
-    if(!trak->samples_size){
+    if(!trak->samples_size && (trak->samplesize || s)){
 	// constant sampesize
 	if(trak->durmap_size==1 || (trak->durmap_size==2 && trak->durmap[1].num==1)){
 	    trak->duration=trak->durmap[0].dur;
@@ -247,36 +359,33 @@ static void mov_build_index(mov_track_t* trak,int timescale){
       mp_msg(MSGT_DEMUX, MSGL_WARN,
              "MOV: durmap or chunkmap bigger than sample count (%i vs %i)\n",
              s, trak->samples_size);
-      trak->samples = realloc_struct(trak->samples, s, sizeof(mov_sample_t));
-      trak->samples_size = trak->samples ? s : 0;
+      trak->samples_size = s;
     }
 
-    // calc pts:
+    // number the durmap runs, empty ones are dropped so that it is sorted
     s=0;
-    for(j=0;j<trak->durmap_size;j++){
-	for(i=0;i<trak->durmap[j].num;i++){
-	    if (s >= trak->samples_size)
-		break;
-	    trak->samples[s].pts=pts;
-	    ++s;
-	    pts+=trak->durmap[j].dur;
-	}
+    for(i=j=0;j<trak->durmap_size;j++){
+	if(!trak->durmap[j].num) continue;
+	trak->durmap[i]=trak->durmap[j];
+	trak->durmap[i].first=s;
+	trak->durmap[i].pts=pts;
+	s+=trak->durmap[j].num;
+	pts+=(uint64_t)trak->durmap[j].num*trak->durmap[j].dur;
+	++i;
     }
-
-    // calc sample offsets
-    s=0;
-    for(j=0;j<trak->chunks_size;j++){
-	off_t pos=trak->chunks[j].pos;
-	for(i=0;i<trak->chunks[j].size;i++){
-	    if (s >= trak->samples_size)
-		break;
-	    trak->samples[s].pos=pos;
-	    mp_msg(MSGT_DEMUX, MSGL_DBG3, "Sample %5d: pts=%8d  off=0x%08X  size=%d\n",s,
-		trak->samples[s].pts,
-		(int)trak->samples[s].pos,
-		trak->samples[s].size);
-	    pos+=trak->samples[s].size;
-	    ++s;
+    trak->durmap_size=i;
+
+    // sample offsets and pts are only calculated for the samples in use
+    trak->window=calloc(MOV_SAMPLE_WINDOW, sizeof(mov_sample_t));
+    if(!trak->window) trak->samples_size=0;
+
+    if(mp_msg_test(MSGT_DEMUX,MSGL_DBG3)){
+	for(s=0;s<trak->samples_size;s++){
+	    mov_sample_t* sample=mov_get_sample(trak,s);
+	    mp_msg(MSGT_DEMUX, MSGL_DBG3, "Sample %5d: pts=%8"PRIu64"  off=0x%08X  size=%d\n",s,
+		sample->pts,
+		(int)sample->pos,
+		sample->size);
 	}
     }
 
@@ -286,7 +395,7 @@ static void mov_build_index(mov_track_t* trak,int timescale){
 	int e_pts=0;
 	for(i=0;i<trak->editlist_size;i++){
 	    mov_editlist_t* el=&trak->editlist[i];
-	    int sample=0;
+	    int sample;
 	    int pts=el->pos;
 	    el->start_frame=frame;
 	    if(pts<0){
@@ -294,17 +403,13 @@ static void mov_build_index(mov_track_t* trak,int timescale){
 		el->frames=0; continue;
 	    }
 	    // find start sample
-	    for(;sample<trak->samples_size;sample++){
-		if(pts<=trak->samples[sample].pts) break;
-	    }
+	    sample=mov_find_sample(trak,pts);
 	    el->start_sample=sample;
-	    el->pts_offset=((long long)e_pts*(long long)trak->timescale)/(long long)timescale-trak->samples[sample].pts;
+	    el->pts_offset=((long long)e_pts*(long long)trak->timescale)/(long long)timescale-mov_sample_pts(trak,sample);
 	    pts+=((long long)el->dur*(long long)trak->timescale)/(long long)timescale;
 	    e_pts+=el->dur;
 	    // find end sample
-	    for(;sample<trak->samples_size;sample++){
-		if(pts<trak->samples[sample].pts) break;
-	    }
+	    sample=mov_find_sample(trak,(uint64_t)pts+1);
 	    el->frames=sample-el->start_sample;
 	    frame+=el->frames;
 	    mp_msg(MSGT_DEMUX,MSGL_V,"EL#%d: pts=%d  1st_sample=%d  frames=%d (%5.3fs)  pts_offs=%d\n",i,
@@ -330,6 +435,7 @@ typedef struct {
     subtitle subs;
     char subtext[MOV_MAX_SUBLEN + 1];
     int current_sub;
+    off_t frag_pos; // next box to look for movie fragments at, 0 if none
 } mov_priv_t;
 
 #define MOV_FOURCC(a,b,c,d) ((a<<24)|(b<<16)|(c<<8)|(d))
@@ -558,7 +664,8 @@ static void demux_close_mov(demuxer_t *demuxer) {
       free(track->tkdata);
       free(track->stdata);
       free(track->stream_header);
-      free(track->samples);
+      free(track->sizes);
+      free(track->window);
       free(track->chunks);
       free(track->chunkmap);
       free(track->durmap);
@@ -1286,6 +1393,13 @@ static int gen_sh_video(sh_video_t* sh, mov_track_t* trak, int timescale) {
     return 1;
 }
 
+static mov_track_t* mov_fragment_track(mov_priv_t* priv,unsigned int track_id){
+    int i;
+    for(i=0;i<priv->track_db;i++)
+	if(priv->tracks[i]->track_id==track_id) return priv->tracks[i];
+    return NULL;
+}
+
 static void lschunks(demuxer_t* demuxer,int level,off_t endpos,mov_track_t* trak){
     mov_priv_t* priv=demuxer->priv;
 //    printf("lschunks (level=%d,endpos=%x)\n", level, endpos);
@@ -1322,6 +1436,28 @@ static void lschunks(demuxer_t* demuxer,int level,off_t endpos,mov_track_t* trak
 		    (int)priv->timescale,(int)priv->duration);
 		break;
 	    }
+	    case MOV_FOURCC('m','v','e','x'): {
+		mp_msg(MSGT_DEMUX, MSGL_V, "MOV: %*sMovie extends, the movie is fragmented\n", level, "");
+		// the fragments follow the movie header
+		priv->frag_pos=priv->moov_end;
+		lschunks(demuxer,level+1,pos+len,NULL);
+		break;
+	    }
+	    case MOV_FOURCC('t','r','e','x'): {
+		mov_track_t* t;
+		stream_skip(demuxer->stream, 4); // version, flags
+		t=mov_fragment_track(priv, stream_read_dword(demuxer->stream));
+		stream_skip(demuxer->stream, 4); // sample description index
+		if(t){
+		    t->fragmented=1;
+		    t->trex_duration=stream_read_dword(demuxer->stream);
+		    t->trex_size=stream_read_dword(demuxer->stream);
+		    t->trex_flags=stream_read_dword(demuxer->stream);
+		    mp_msg(MSGT_DEMUX, MSGL_V, "MOV: %*sTrack #%d fragment defaults: dur=%u size=%u flags=0x%X\n",
+			level, "", t->id, t->trex_duration, t->trex_size, t->trex_flags);
+		}
+		break;
+	    }
 	    case MOV_FOURCC('t','r','a','k'): {
 //	    if(trak) printf("MOV: Warning! trak in trak?\n");
 	    if(priv->track_db>=MOV_MAX_TRACKS){
@@ -1375,12 +1511,13 @@ static void lschunks(demuxer_t* demuxer,int level,off_t endpos,mov_track_t* trak
 
 		for (i=0; i<trak->samples_size; i++)
 		{
-		    char buf[trak->samples[i].size];
-		    stream_seek(demuxer->stream, trak->samples[i].pos);
+		    mov_sample_t* sample = mov_get_sample(trak, i);
+		    char buf[sample->size];
+		    stream_seek(demuxer->stream, sample->pos);
 		    snprintf((char *)&name[0], 20, "samp%d", i);
 		    fd = open((char *)&name[0], O_CREAT|O_WRONLY);
-		    stream_read(demuxer->stream, &buf[0], trak->samples[i].size);
-		    write(fd, &buf[0], trak->samples[i].size);
+		    stream_read(demuxer->stream, &buf[0], sample->size);
+		    write(fd, &buf[0], sample->size);
 		    close(fd);
 		 }
 		for (i=0; i<trak->chunks_size; i++)
@@ -1658,6 +1795,8 @@ static int lschunks_intrak(demuxer_t* demuxer, int level, unsigned int id,
 76 4 Track width
 80 4 Track height
 */
+      if (trak->tkdata_len >= 24)
+        trak->track_id = char2int(trak->tkdata, trak->tkdata[0] == 1 ? 20 : 12);
       mp_msg(MSGT_DEMUX, MSGL_V,
              "tkhd len=%d ver=%d flags=0x%X id=%d dur=%d lay=%d vol=%d\n",
               trak->tkdata_len, trak->tkdata[0], trak->tkdata[1],
@@ -1817,10 +1956,10 @@ static int lschunks_intrak(demuxer_t* demuxer, int level, unsigned int id,
       trak->samplesize = ss;
       if (!ss) {
         // variable samplesize
-        trak->samples = realloc_struct(trak->samples, entries, sizeof(mov_sample_t));
-        trak->samples_size = entries;
-        for (i = 0; i < trak->samples_size; i++)
-          trak->samples[i].size = stream_read_dword(demuxer->stream);
+        trak->sizes = realloc_struct(trak->sizes, entries, sizeof(unsigned int));
+        trak->sizes_size = trak->samples_size = trak->sizes ? entries : 0;
+        for (i = 0; i < trak->sizes_size; i++)
+          trak->sizes[i] = stream_read_dword(demuxer->stream);
       }
       break;
     }
@@ -1938,6 +2077,282 @@ static int lschunks_intrak(demuxer_t* demuxer, int level, unsigned int id,
   return 0;
 }
 
+#define MOV_TFHD_BASE_DATA_OFFSET  0x000001
+#define MOV_TFHD_STSD_INDEX        0x000002
+#define MOV_TFHD_DEFAULT_DURATION  0x000008
+#define MOV_TFHD_DEFAULT_SIZE      0x000010
+#define MOV_TFHD_DEFAULT_FLAGS     0x000020
+#define MOV_TFHD_DEFAULT_BASE_MOOF 0x020000
+
+#define MOV_TRUN_DATA_OFFSET       0x000001
+#define MOV_TRUN_FIRST_FLAGS       0x000004
+#define MOV_TRUN_DURATION          0x000100
+#define MOV_TRUN_SIZE              0x000200
+#define MOV_TRUN_FLAGS             0x000400
+#define MOV_TRUN_CTS_OFFSET        0x000800
+
+#define MOV_SAMPLE_NON_SYNC        0x010000
+
+typedef struct {
+    mov_track_t* trak;
+    off_t base;             // data offsets are relative to this
+    off_t data;             // end of the data of the last trun
+    unsigned int duration;  // sample defaults
+    unsigned int size;
+    unsigned int flags;
+    int64_t time;           // decode time of the next sample, -1 if unknown
+} mov_traf_t;
+
+/**
+ * \brief append the samples of a track fragment run to the index of its track
+ * \return 0 if the run is corrupt or we are out of memory
+ */
+static int mov_read_trun(demuxer_t* demuxer, mov_traf_t* traf){
+    stream_t* s=demuxer->stream;
+    mov_track_t* trak=traf->trak;
+    int flags=stream_read_dword(demuxer->stream)&0xFFFFFF;
+    unsigned int count=stream_read_dword(demuxer->stream);
+    unsigned int first_flags=traf->flags;
+    off_t pos=traf->data;
+    unsigned int i;
+
+    if(flags&MOV_TRUN_DATA_OFFSET)
+	pos=traf->base+(int32_t)stream_read_dword(s);
+    if(flags&MOV_TRUN_FIRST_FLAGS)
+	first_flags=stream_read_dword(s);
+    if(!count) return 1;
+    if(count>INT_MAX/2-trak->samples_size) return 0;
+
+    mp_msg(MSGT_DEMUX, MSGL_DBG2, "MOV: Track #%d fragment: %u samples at 0x%"PRIx64"\n",
+	trak->id, count, (int64_t)pos);
+
+    // one chunk per run
+    trak->chunks=realloc_struct(trak->chunks, trak->chunks_size+1, sizeof(mov_chunk_t));
+    if(!trak->chunks){
+	trak->chunks_size=trak->samples_size=0;
+	return 0;
+    }
+    trak->chunks[trak->chunks_size].sample=trak->chunks_size ?
+	trak->chunks[trak->chunks_size-1].sample+trak->chunks[trak->chunks_size-1].size : 0;
+    trak->chunks[trak->chunks_size].size=count;
+    trak->chunks[trak->chunks_size].desc=0;
+    trak->chunks[trak->chunks_size].pos=pos;
+    trak->chunks_size++;
+
+    if(trak->samplesize){
+	// constant samplesize, only the chunks are used
+	for(i=0;i<count;i++){
+	    unsigned int dur=flags&MOV_TRUN_DURATION ? stream_read_dword(s) : traf->duration;
+	    unsigned int size=flags&MOV_TRUN_SIZE ? stream_read_dword(s) : traf->size;
+	    if(flags&MOV_TRUN_FLAGS) stream_skip(s, 4);
+	    if(flags&MOV_TRUN_CTS_OFFSET) stream_skip(s, 4);
+	    if(!trak->duration) trak->duration=dur;
+	    pos+=size;
+	}
+	traf->data=pos;
+	return 1;
+    }
+
+    if(!trak->sizes){
+	// the samples of the movie header all had the same size
+	trak->sizes=calloc(trak->samples_size+count, sizeof(unsigned int));
+	if(trak->sizes)
+	    for(i=0;i<trak->samples_size;i++) trak->sizes[i]=trak->fixed_size;
+    } else
+	trak->sizes=realloc_struct(trak->sizes, trak->samples_size+count, sizeof(unsigned int));
+    trak->durmap=realloc_struct(trak->durmap, trak->durmap_size+count, sizeof(mov_durmap_t));
+    if(trak->type!=MOV_TRAK_AUDIO)
+	trak->keyframes=realloc_struct(trak->keyframes, trak->keyframes_size+count, sizeof(unsigned int));
+    if(!trak->sizes || !trak->durmap || (trak->type!=MOV_TRAK_AUDIO && !trak->keyframes)){
+	trak->samples_size=trak->sizes_size=trak->durmap_size=trak->keyframes_size=0;
+	return 0;
+    }
+    for(i=trak->sizes_size;i<trak->samples_size;i++)
+	trak->sizes[i]=0;
+
+    for(i=0;i<count;i++){
+	unsigned int dur=flags&MOV_TRUN_DURATION ? stream_read_dword(s) : traf->duration;
+	unsigned int size=flags&MOV_TRUN_SIZE ? stream_read_dword(s) : traf->size;
+	unsigned int sflags=flags&MOV_TRUN_FLAGS ? stream_read_dword(s) : i ? traf->flags : first_flags;
+	uint64_t pts=mov_sample_pts(trak,trak->samples_size);
+	mov_durmap_t* run=trak->durmap_size ? &trak->durmap[trak->durmap_size-1] : NULL;
+	if(flags&MOV_TRUN_CTS_OFFSET) stream_skip(s, 4);
+	// a gap in the decode times starts a new run
+	if(traf->time>(int64_t)pts) pts=traf->time;
+	if(run && run->dur==dur && run->first+run->num==trak->samples_size &&
+	   run->pts+(uint64_t)run->num*dur==pts)
+	    run->num++;
+	else {
+	    run=&trak->durmap[trak->durmap_size++];
+	    run->num=1;
+	    run->dur=dur;
+	    run->first=trak->samples_size;
+	    run->pts=pts;
+	}
+	traf->time=pts+dur;
+	if(trak->keyframes && !(sflags&MOV_SAMPLE_NON_SYNC))
+	    trak->keyframes[trak->keyframes_size++]=trak->samples_size;
+	trak->sizes[trak->samples_size++]=size;
+	pos+=size;
+    }
+    trak->sizes_size=trak->samples_size;
+    traf->data=pos;
+    if(stream_eof(s)) return 0;
+    return 1;
+}
+
+static void mov_read_traf(demuxer_t* demuxer, off_t moof_pos, off_t endpos, off_t* data){
+    mov_priv_t* priv=demuxer->priv;
+    stream_t* s=demuxer->stream;
+    mov_traf_t traf;
+    memset(&traf, 0, sizeof(traf));
+    traf.time=-1;
+    while(1){
+	off_t pos=stream_tell(s);
+	off_t len;
+	unsigned int id;
+	if(pos>=endpos) break;
+	len=stream_read_dword(s);
+	id=stream_read_dword(s);
+	if(len<8 || stream_eof(s)) break;
+	switch(id){
+	case MOV_FOURCC('t','f','h','d'): {
+	    int flags=stream_read_dword(s)&0xFFFFFF;
+	    unsigned int track_id=stream_read_dword(s);
+	    traf.trak=mov_fragment_track(priv, track_id);
+	    if(!traf.trak || !traf.trak->fragmented){
+		mp_msg(MSGT_DEMUX, MSGL_V, "MOV: fragment of unknown track %u\n", track_id);
+		return;
+	    }
+	    if(flags&MOV_TFHD_BASE_DATA_OFFSET)
+		traf.base=stream_read_qword(s);
+	    else if(flags&MOV_TFHD_DEFAULT_BASE_MOOF)
+		traf.base=moof_pos;
+	    else
+		traf.base=*data;
+	    traf.data=traf.base;
+	    if(flags&MOV_TFHD_STSD_INDEX) stream_skip(s, 4);
+	    traf.duration=flags&MOV_TFHD_DEFAULT_DURATION ? stream_read_dword(s) : traf.trak->trex_duration;
+	    traf.size=flags&MOV_TFHD_DEFAULT_SIZE ? stream_read_dword(s) : traf.trak->trex_size;
+	    traf.flags=flags&MOV_TFHD_DEFAULT_FLAGS ? stream_read_dword(s) : traf.trak->trex_flags;
+	    if(traf.trak->editlist_size){
+		mp_msg(MSGT_DEMUX, MSGL_V, "MOV: Track #%d: edit list ignored for fragments\n", traf.trak->id);
+		traf.trak->editlist_size=0;
+	    }
+	    break;
+	}
+	case MOV_FOURCC('t','f','d','t'): {
+	    int version=stream_read_char(s);
+	    stream_skip(s, 3);
+	    traf.time=version==1 ? stream_read_qword(s) : stream_read_dword(s);
+	    break;
+	}
+	case MOV_FOURCC('t','r','u','n'):
+	    if(!traf.trak) return;
+	    if(!mov_read_trun(demuxer, &traf)){
+		mp_msg(MSGT_DEMUX, MSGL_WARN, "MOV: Track #%d: broken fragment run\n", traf.trak->id);
+		return;
+	    }
+	    *data=traf.data;
+	    break;
+	}
+	if(!stream_seek(s, pos+len)) break;
+    }
+}
+
+// how long to wait for a fragment that is still being written, in ms
+#define MOV_FRAGMENT_WAIT 5000
+
+/**
+ * \brief add the next movie fragment to the index
+ * \return 1 if one was added, 0 at the end of the movie,
+ *         -1 if the next one is still being written
+ */
+static int mov_read_fragment(demuxer_t* demuxer){
+    mov_priv_t* priv=demuxer->priv;
+    stream_t* s=demuxer->stream;
+    off_t cur=stream_tell(s);
+    int ret=0;
+
+    if(!priv->frag_pos) return 0;
+    while(!ret){
+	off_t pos=priv->frag_pos;
+	off_t len;
+	unsigned int id;
+	int hdr=8;
+	s->eof=0;
+	if(!stream_seek(s, pos) || (stream_read_char(s), stream_eof(s))){
+	    // nothing follows, unless the file grew since it was opened
+	    if(s->end_pos && pos>s->end_pos) ret=-1;
+	    break;
+	}
+	stream_seek(s, pos);
+	len=stream_read_dword(s);
+	id=stream_read_dword(s);
+	if(len==1){
+	    len=stream_read_qword(s);
+	    hdr=16;
+	}
+	if(stream_eof(s)){
+	    ret=-1;
+	    break;
+	}
+	if(len<hdr) break;
+	if(id==MOV_FOURCC('m','o','o','f')){
+	    off_t end=pos+len;
+	    off_t data=pos;
+	    // wait until the data of the fragment is there too
+	    if(!stream_seek(s, end)){
+		ret=-1;
+		break;
+	    }
+	    len=stream_read_dword(s);
+	    if(stream_read_dword(s)==MOV_FOURCC('m','d','a','t') && len>=8 &&
+	       stream_seek(s, end+len-1))
+		stream_read_char(s);
+	    if(stream_eof(s)){
+		ret=-1;
+		break;
+	    }
+	    stream_seek(s, pos+hdr);
+	    while(stream_tell(s)<end){
+		off_t box=stream_tell(s);
+		len=stream_read_dword(s);
+		id=stream_read_dword(s);
+		if(len<8 || stream_eof(s)) break;
+		if(id==MOV_FOURCC('t','r','a','f'))
+		    mov_read_traf(demuxer, pos, box+len, &data);
+		s->eof=0;
+		if(!stream_seek(s, box+len)) break;
+	    }
+	    len=end-pos;
+	    ret=1;
+	} else {
+	    // skip mdat and the like once they are complete
+	    if(stream_seek(s, pos+len-1)) stream_read_char(s);
+	    if(stream_eof(s)){
+		ret=-1;
+		break;
+	    }
+	}
+	priv->frag_pos=pos+len;
+    }
+    s->eof=0;
+    stream_seek(s, cur);
+    return ret;
+}
+
+// the fragments are indexed when the playback reaches the end of the index
+static int mov_next_fragment(demuxer_t* demuxer){
+    int waited=0;
+    int ret;
+    while((ret=mov_read_fragment(demuxer))<0 && waited<MOV_FRAGMENT_WAIT){
+	usec_sleep(100000);
+	waited+=100;
+    }
+    return ret>0;
+}
+
 static demuxer_t* mov_read_header(demuxer_t* demuxer){
     mov_priv_t* priv=demuxer->priv;
     int t_no;
@@ -1959,10 +2374,25 @@ static demuxer_t* mov_read_header(demuxer_t* demuxer){
     demuxer->stream->eof = 0;
 //    mp_msg(MSGT_DEMUX, MSGL_INFO, "--------------\n");
 
+    // the rest of a fragmented movie is indexed while it is played
+    if(priv->frag_pos){
+	mov_read_fragment(demuxer);
+	for(t_no=0;t_no<priv->track_db;t_no++){
+	    mov_track_t* trak=priv->tracks[t_no];
+	    sh_video_t* sh=demuxer->v_streams[t_no];
+	    if(sh && trak->durmap_size && trak->durmap[0].dur){
+		sh->fps=(float)trak->timescale/trak->durmap[0].dur;
+		sh->frametime=1.0f/sh->fps;
+	    }
+	}
+    }
+
     // find the best (longest) streams:
     for(t_no=0;t_no<priv->track_db;t_no++){
         mov_track_t* trak=priv->tracks[t_no];
 	int len=(trak->samplesize) ? trak->chunks_size : trak->samples_size;
+	// fragmented tracks may not have samples yet
+	if(trak->fragmented && !len) len=1;
 	if(demuxer->a_streams[t_no]){ // need audio
 	    if(len>best_a_len){	best_a_len=len; best_a_id=t_no; }
 	}
@@ -2033,9 +2463,10 @@ static demuxer_t* mov_read_header(demuxer_t* demuxer){
 		mp_msg(MSGT_DEMUX, MSGL_INFO, "MOV: Track #%d: Extracting %d data chunks to files\n",t_no,trak->samples_size);
 		for (i=0; i<trak->samples_size; i++)
 		{
-		    int len=trak->samples[i].size;
+		    mov_sample_t* sample=mov_get_sample(trak,i);
+		    int len=sample->size;
 		    char buf[len];
-		    stream_seek(demuxer->stream, trak->samples[i].pos);
+		    stream_seek(demuxer->stream, sample->pos);
 		    snprintf(name, 20, "t%02d-s%03d.%s", t_no,i,
 			(trak->media_handler==MOV_FOURCC('f','l','s','h')) ?
 			    "swf":"dump");
@@ -2119,6 +2550,11 @@ static int demux_mov_fill_buffer(demuxer_t *demuxer,demux_stream_t* ds){
     trak = stream_track(priv, ds);
     if (!trak) return 0;
 
+    while (trak->fragmented &&
+           trak->pos >= (trak->samplesize ? trak->chunks_size : trak->samples_size))
+      if (!mov_next_fragment(demuxer))
+        break;
+
 if(trak->samplesize){
     // read chunk:
     if(trak->pos>=trak->chunks_size) return 0; // EOF
@@ -2158,6 +2594,7 @@ if(trak->samplesize){
     pos=trak->chunks[trak->pos].pos;
 } else {
     int frame=trak->pos;
+    mov_sample_t* sample;
     // editlist support:
     if(trak->type == MOV_TRAK_VIDEO && trak->editlist_size>=1){
 	// find the right editlist entry:
@@ -2171,17 +2608,19 @@ if(trak->samplesize){
 	// calc real frame index:
 	frame-=trak->editlist[trak->editlist_pos].start_frame;
 	frame+=trak->editlist[trak->editlist_pos].start_sample;
+	sample=mov_get_sample(trak,frame);
 	// calc pts:
-	pts=(float)(trak->samples[frame].pts+
+	pts=(float)((int64_t)sample->pts+
 	    trak->editlist[trak->editlist_pos].pts_offset)/(float)trak->timescale;
     } else {
 	if(frame>=trak->samples_size) return 0; // EOF
-	pts=(float)trak->samples[frame].pts/(float)trak->timescale;
+	sample=mov_get_sample(trak,frame);
+	pts=(float)sample->pts/(float)trak->timescale;
     }
     // read sample:
-    stream_seek(demuxer->stream,trak->samples[frame].pos);
-    x=trak->samples[frame].size;
-    pos=trak->samples[frame].pos;
+    stream_seek(demuxer->stream,sample->pos);
+    x=sample->size;
+    pos=sample->pos;
 }
 if(trak->pos==0 && trak->stream_header_len>0){
     // we have to append the stream header...
@@ -2204,19 +2643,15 @@ if(trak->pos==0 && trak->stream_header_len>0){
     if (demuxer->sub->id >= 0 && demuxer->sub->id < priv->track_db)
       trak = priv->tracks[demuxer->sub->id];
     if (trak) {
-      int samplenr = 0;
-      while (samplenr < trak->samples_size) {
-        double subpts = (double)trak->samples[samplenr].pts / (double)trak->timescale;
-        if (subpts >= pts) break;
-        samplenr++;
-      }
-      samplenr--;
+      // the last subtitle starting before pts
+      int samplenr = mov_find_sample(trak, pts > 0 ? ceil((double)pts * trak->timescale) : 0) - 1;
       if (samplenr < 0)
         vo_sub = NULL;
       else if (samplenr != priv->current_sub) {
-        off_t pos = trak->samples[samplenr].pos;
-        int len = trak->samples[samplenr].size;
-        double subpts = (double)trak->samples[samplenr].pts / (double)trak->timescale;
+        mov_sample_t* sample = mov_get_sample(trak, samplenr);
+        off_t pos = sample->pos;
+        int len = sample->size;
+        double subpts = (double)sample->pts / (double)trak->timescale;
         stream_seek(demuxer->stream, pos);
         ds_read_packet(demuxer->sub, demuxer->stream, len, subpts, pos, 0);
         priv->current_sub = samplenr;
@@ -2241,20 +2676,19 @@ if(trak->samplesize){
     if (trak->pos == trak->chunks_size) return -1;
     pts=(float)(trak->chunks[trak->pos].sample*trak->duration)/(float)trak->timescale;
 } else {
-    unsigned int ipts;
-    if(!(flags&SEEK_ABSOLUTE)) pts+=trak->samples[trak->pos].pts;
+    uint64_t ipts;
+    if(!(flags&SEEK_ABSOLUTE)) pts+=mov_sample_pts(trak,trak->pos);
     if(pts<0) pts=0;
     ipts=pts;
     //printf("MOV track seek - sample: %d  \n",ipts);
-    for(trak->pos=0;trak->pos<trak->samples_size;++trak->pos){
-	if(trak->samples[trak->pos].pts>=ipts) break; // found it!
-    }
+    trak->pos=mov_find_sample(trak,ipts);
     if (trak->pos == trak->samples_size) return -1;
     if(trak->keyframes_size){
 	// find nearest keyframe
-	int i;
-	for(i=0;i<trak->keyframes_size;i++){
-	    if(trak->keyframes[i]>=trak->pos) break;
+	int i=0,hi=trak->keyframes_size;
+	while(i<hi){
+	    int mid=(i+hi)/2;
+	    if(trak->keyframes[mid]<trak->pos) i=mid+1; else hi=mid;
 	}
 	if (i == trak->keyframes_size) return -1;
 	if(i>0 && (trak->keyframes[i]-trak->pos) > (trak->pos-trak->keyframes[i-1]))
@@ -2262,7 +2696,7 @@ if(trak->samplesize){
 	trak->pos=trak->keyframes[i];
 //	printf("nearest keyframe: %d  \n",trak->pos);
     }
-    pts=(float)trak->samples[trak->pos].pts/(float)trak->timescale;
+    pts=(float)mov_sample_pts(trak,trak->pos)/(float)trak->timescale;
 }
 
 //    printf("MOV track seek done:  %5.3f  \n",pts);
@@ -2270,6 +2704,20 @@ if(trak->samplesize){
 return pts;
 }
 
+// time of sample n (chunk n with constant samplesize), or of the end of the index
+static float mov_track_time(mov_track_t* trak,int n){
+    uint64_t pts;
+    if(!trak->timescale) return 0;
+    if(trak->samplesize){
+	mov_chunk_t* c;
+	if(!trak->chunks_size) return 0;
+	c=&trak->chunks[FFMIN(n,trak->chunks_size-1)];
+	pts=(uint64_t)(n<trak->chunks_size ? c->sample : c->sample+c->size)*trak->duration;
+    } else
+	pts=mov_sample_pts(trak,n);
+    return (float)pts/(float)trak->timescale;
+}
+
 static void demux_seek_mov(demuxer_t *demuxer,float pts,float audio_delay,int flags){
     mov_priv_t* priv=demuxer->priv;
     demux_stream_t* ds;
@@ -2277,6 +2725,22 @@ static void demux_seek_mov(demuxer_t *demuxer,float pts,float audio_delay,int fl
 
 //    printf("MOV seek called  %5.3f  flag=%d  \n",pts,flags);
 
+    if(priv->frag_pos){
+	// index the fragments up to the seek target
+	trak = stream_track(priv, demuxer->video);
+	if (!trak) trak = stream_track(priv, demuxer->audio);
+	if(flags&SEEK_FACTOR)
+	    while(mov_read_fragment(demuxer)>0);
+	else if(trak){
+	    float end=pts;
+	    if(!(flags&SEEK_ABSOLUTE)) end+=mov_track_time(trak,trak->pos);
+	    while(mov_track_time(trak,trak->samplesize ? trak->chunks_size : trak->samples_size)<=end &&
+		  mov_read_fragment(demuxer)>0);
+	    // the nearest keyframe may be in the next one
+	    mov_read_fragment(demuxer);
+	}
+    }
+
     ds=demuxer->video;
     trak = stream_track(priv, ds);
     if (trak) {
@@ -3212,52 +3212,17 @@ static void reset_fifos(demuxer_t *demuxer, int a, int v, int s)
 }
 
 
-static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_delay, int flags)
+// Start over after a jump in the stream: find the beginning of a video
+// sequence and drop the audio before it.
+static void ts_resync(demuxer_t *demuxer)
 {
 	demux_stream_t *d_audio=demuxer->audio;
 	demux_stream_t *d_video=demuxer->video;
 	sh_audio_t *sh_audio=d_audio->sh;
 	sh_video_t *sh_video=d_video->sh;
 	ts_priv_t * priv = (ts_priv_t*) demuxer->priv;
-	int i, video_stats;
-	off_t newpos;
-
-	//================= seek in MPEG-TS ==========================
-
-	ts_dump_streams(demuxer->priv);
-	reset_fifos(demuxer, sh_audio != NULL, sh_video != NULL, demuxer->sub->id > 0);
-
-	demux_flush(demuxer);
-
-
-
-	video_stats = (sh_video != NULL);
-	if(video_stats)
-	{
-		mp_msg(MSGT_DEMUX, MSGL_V, "IBPS: %d, vb: %d\r\n", sh_video->i_bps, priv->vbitrate);
-		if(priv->vbitrate)
-			video_stats = priv->vbitrate;
-		else
-			video_stats = sh_video->i_bps;
-	}
-
-	newpos = (flags & SEEK_ABSOLUTE) ? demuxer->movi_start : demuxer->filepos;
-	if(flags & SEEK_FACTOR) // float seek 0..1
-		newpos+=(demuxer->movi_end-demuxer->movi_start)*rel_seek_secs;
-	else
-	{
-		// time seek (secs)
-		if(! video_stats) // unspecified or VBR
-			newpos += 2324*75*rel_seek_secs; // 174.3 kbyte/sec
-		else
-			newpos += video_stats*rel_seek_secs;
-	}
-
-
-	if(newpos < demuxer->movi_start)
-  		newpos = demuxer->movi_start;	//begininng of stream
+	int i;
 
-	stream_seek(demuxer->stream, newpos);
 	for(i = 0; i < 8192; i++)
 		if(priv->ts.pids[i] != NULL)
 			priv->ts.pids[i]->is_synced = 0;
@@ -3305,6 +3270,56 @@ static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_d
 }
 
 
+static void demux_seek_ts(demuxer_t *demuxer, float rel_seek_secs, float audio_delay, int flags)
+{
+	demux_stream_t *d_audio=demuxer->audio;
+	demux_stream_t *d_video=demuxer->video;
+	sh_audio_t *sh_audio=d_audio->sh;
+	sh_video_t *sh_video=d_video->sh;
+	ts_priv_t * priv = (ts_priv_t*) demuxer->priv;
+	int video_stats;
+	off_t newpos;
+
+	//================= seek in MPEG-TS ==========================
+
+	ts_dump_streams(demuxer->priv);
+	reset_fifos(demuxer, sh_audio != NULL, sh_video != NULL, demuxer->sub->id > 0);
+
+	demux_flush(demuxer);
+
+
+
+	video_stats = (sh_video != NULL);
+	if(video_stats)
+	{
+		mp_msg(MSGT_DEMUX, MSGL_V, "IBPS: %d, vb: %d\r\n", sh_video->i_bps, priv->vbitrate);
+		if(priv->vbitrate)
+			video_stats = priv->vbitrate;
+		else
+			video_stats = sh_video->i_bps;
+	}
+
+	newpos = (flags & SEEK_ABSOLUTE) ? demuxer->movi_start : demuxer->filepos;
+	if(flags & SEEK_FACTOR) // float seek 0..1
+		newpos+=(demuxer->movi_end-demuxer->movi_start)*rel_seek_secs;
+	else
+	{
+		// time seek (secs)
+		if(! video_stats) // unspecified or VBR
+			newpos += 2324*75*rel_seek_secs; // 174.3 kbyte/sec
+		else
+			newpos += video_stats*rel_seek_secs;
+	}
+
+
+	if(newpos < demuxer->movi_start)
+  		newpos = demuxer->movi_start;	//begininng of stream
+
+	stream_seek(demuxer->stream, newpos);
+	ts_resync(demuxer);
+}
+
+
 static int demux_ts_fill_buffer(demuxer_t * demuxer, demux_stream_t *ds)
 {
 	ES_stream_t es;
@@ -3481,6 +3496,12 @@ static int demux_ts_control(demuxer_t *demuxer, int cmd, void *arg)
 			return DEMUXER_CTRL_OK;
 		}
 
+		case DEMUXER_CTRL_STREAM_SKIPPED:
+			// drop the PES packets cut by the skip
+			reset_fifos(demuxer, demuxer->audio->sh != NULL, demuxer->video->sh != NULL, demuxer->sub->id > 0);
+			ts_resync(demuxer);
+			return DEMUXER_CTRL_OK;
+
 		default:
 			return DEMUXER_CTRL_NOTIMPL;
 	}
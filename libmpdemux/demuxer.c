@@ -1231,6 +1231,22 @@ void demux_flush(demuxer_t *demuxer)
     ds_free_packs(demuxer->sub);
 }
 
+/**
+ * Skip forward in the stream like after a loss of data, dropping what was
+ * demuxed already. Works without seeking, for catching up with live streams.
+ */
+int demux_skip_bytes(demuxer_t *demuxer, off_t len)
+{
+    demux_flush(demuxer);
+    if (len > 0 && !stream_skip(demuxer->stream, len))
+        return 0;
+    demuxer->video->eof = 0;
+    demuxer->audio->eof = 0;
+    demux_control(demuxer, DEMUXER_CTRL_STREAM_SKIPPED, NULL);
+    demux_resync(demuxer);
+    return 1;
+}
+
 int demux_seek(demuxer_t *demuxer, float rel_seek_secs, float audio_delay,
                int flags)
 {
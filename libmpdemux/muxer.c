@@ -23,6 +23,9 @@
 #include <unistd.h>
 
 #include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "aviheader.h"
 #include "ms_hdr.h"
 
@@ -69,10 +72,21 @@ fail:
     return NULL;
 }
 
+#if HAVE_PTHREADS
+/* with -vf pipeline video chunks come from the encoder thread */
+static pthread_mutex_t muxer_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_MUXER()   pthread_mutex_lock(&muxer_lock)
+#define UNLOCK_MUXER() pthread_mutex_unlock(&muxer_lock)
+#else
+#define LOCK_MUXER()
+#define UNLOCK_MUXER()
+#endif
+
 /* buffer frames until we either:
  * (a) have at least one frame from each stream
  * (b) run out of memory */
 void muxer_write_chunk(muxer_stream_t *s, size_t len, unsigned int flags, double dts, double pts) {
+    LOCK_MUXER();
     if(dts == MP_NOPTS_VALUE) dts= s->timer;
     if(pts == MP_NOPTS_VALUE) pts= s->timer; // this is wrong
 
@@ -86,6 +100,7 @@ void muxer_write_chunk(muxer_stream_t *s, size_t len, unsigned int flags, double
       tmp = realloc_struct(s->muxer->muxbuf, (num+1), sizeof(muxbuf_t));
       if(!tmp) {
         mp_msg(MSGT_MUXER, MSGL_FATAL, MSGTR_MuxbufReallocErr);
+        UNLOCK_MUXER();
         return;
       }
       s->muxer->muxbuf = tmp;
@@ -100,6 +115,7 @@ void muxer_write_chunk(muxer_stream_t *s, size_t len, unsigned int flags, double
       buf->buffer = malloc(len);
       if (!buf->buffer) {
         mp_msg(MSGT_MUXER, MSGL_FATAL, MSGTR_MuxbufMallocErr);
+        UNLOCK_MUXER();
         return;
       }
       memcpy(buf->buffer, s->buffer, buf->len);
@@ -164,5 +180,25 @@ void muxer_write_chunk(muxer_stream_t *s, size_t len, unsigned int flags, double
     s->timer=(double)s->h.dwLength*s->h.dwScale/s->h.dwRate;
     s->size+=len;
 
+    UNLOCK_MUXER();
     return;
 }
+
+/* The video stream is written by the -vf pipeline thread, read its timer
+ * under the lock. */
+double muxer_stream_timer(muxer_stream_t *s) {
+    double timer;
+    LOCK_MUXER();
+    timer = s->timer;
+    UNLOCK_MUXER();
+    return timer;
+}
+
+/* Bytes written to the stream so far, under the lock like its timer. */
+off_t muxer_stream_size(muxer_stream_t *s) {
+    off_t size;
+    LOCK_MUXER();
+    size = s->size;
+    UNLOCK_MUXER();
+    return size;
+}
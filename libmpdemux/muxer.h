@@ -131,6 +131,8 @@ muxer_t *muxer_new_muxer(int type,stream_t *stream);
 #define muxer_new_stream(muxer,a) muxer->cont_new_stream(muxer,a)
 #define muxer_stream_fix_parameters(muxer, a) muxer->fix_stream_parameters(a)
 void muxer_write_chunk(muxer_stream_t *s, size_t len, unsigned int flags, double dts, double pts);
+double muxer_stream_timer(muxer_stream_t *s);
+off_t muxer_stream_size(muxer_stream_t *s);
 #define muxer_write_header(muxer) muxer->cont_write_header(muxer)
 #define muxer_write_index(muxer) muxer->cont_write_index(muxer)
 
@@ -31,6 +31,10 @@
 #include <stdlib.h>
 #include <inttypes.h>
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "mpeg2.h"
 #include "attributes.h"
 #include "mpeg2_internal.h"
@@ -39,6 +43,222 @@ static int mpeg2_accels = 0;
 
 #define BUFFER_SIZE (1194 * 1024)
 
+#if HAVE_PTHREADS
+#define MAX_THREADS 16
+
+/*
+ * With several threads the slices of a picture are kept in the chunk
+ * buffer until the next start code which is not a slice, and are then
+ * decoded in parallel. The slices only write to their own macroblocks,
+ * so every thread decodes them with its own copy of the decoder. Slices
+ * are given to the threads by row, so the output does not depend on the
+ * timing even for slices that overlap in broken streams.
+ */
+
+typedef struct {
+    int code;
+    const uint8_t * buffer;
+} queued_slice_t;
+
+typedef struct {
+    struct mpeg2_threads_s * threads;
+    int index;
+    mpeg2_decoder_t * decoder;
+    pthread_t thread;
+} slice_job_t;
+
+struct mpeg2_threads_s {
+    slice_job_t job[MAX_THREADS];	/* job 0 is run by the parser */
+    int count;
+
+    queued_slice_t * slices;
+    int nb_slices;
+    int max_slices;
+
+    int picture;			/* incremented to wake up the threads */
+    int pending;
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+static void decode_job (slice_job_t * job)
+{
+    mpeg2_threads_t * t = job->threads;
+    int i;
+
+    for (i = 0; i < t->nb_slices; i++)
+	if ((t->slices[i].code - 1) % t->count == job->index)
+	    mpeg2_slice (job->decoder, t->slices[i].code, t->slices[i].buffer);
+}
+
+static void * slice_thread (void * arg)
+{
+    slice_job_t * job = (slice_job_t *) arg;
+    mpeg2_threads_t * t = job->threads;
+    int picture = 0;
+
+    pthread_mutex_lock (&t->lock);
+    while (1) {
+	while (t->picture == picture && !t->quit)
+	    pthread_cond_wait (&t->work_cond, &t->lock);
+	if (t->quit)
+	    break;
+	picture = t->picture;
+	pthread_mutex_unlock (&t->lock);
+
+	decode_job (job);
+
+	pthread_mutex_lock (&t->lock);
+	if (!--t->pending)
+	    pthread_cond_signal (&t->done_cond);
+    }
+    pthread_mutex_unlock (&t->lock);
+    return NULL;
+}
+
+static void free_threads (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+    int i;
+
+    if (!t)
+	return;
+    pthread_mutex_lock (&t->lock);
+    t->quit = 1;
+    pthread_cond_broadcast (&t->work_cond);
+    pthread_mutex_unlock (&t->lock);
+    for (i = 1; i < t->count; i++) {
+	pthread_join (t->job[i].thread, NULL);
+	mpeg2_free (t->job[i].decoder);
+    }
+    pthread_mutex_destroy (&t->lock);
+    pthread_cond_destroy (&t->work_cond);
+    pthread_cond_destroy (&t->done_cond);
+    free (t->slices);
+    free (t);
+    mpeg2dec->threads = NULL;
+}
+
+/* returns 1 if the slice is left in the chunk buffer for the threads */
+static int queue_slice (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+
+    /* the convert callback gets the rows in order */
+    if (!t || mpeg2dec->decoder.convert)
+	return 0;
+    if (t->nb_slices == t->max_slices) {
+	int max = t->max_slices ? 2 * t->max_slices : 128;
+	queued_slice_t * slices;
+
+	slices = (queued_slice_t *) realloc (t->slices,
+					     max * sizeof (queued_slice_t));
+	if (!slices)
+	    return 0;
+	t->slices = slices;
+	t->max_slices = max;
+    }
+    t->slices[t->nb_slices].code = mpeg2dec->code;
+    t->slices[t->nb_slices].buffer = mpeg2dec->chunk_start;
+    t->nb_slices++;
+    return 1;
+}
+
+static void run_jobs (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+    int i;
+
+    for (i = 1; i < t->count; i++)
+	memcpy (t->job[i].decoder, &(mpeg2dec->decoder),
+		sizeof (mpeg2_decoder_t));
+    pthread_mutex_lock (&t->lock);
+    t->pending = t->count - 1;
+    t->picture++;
+    pthread_cond_broadcast (&t->work_cond);
+    pthread_mutex_unlock (&t->lock);
+
+    decode_job (&t->job[0]);
+
+    pthread_mutex_lock (&t->lock);
+    while (t->pending)
+	pthread_cond_wait (&t->done_cond, &t->lock);
+    pthread_mutex_unlock (&t->lock);
+}
+
+/* decodes the queued slices, the slice being copied moves to the start */
+static void decode_slices (mpeg2dec_t * mpeg2dec)
+{
+    mpeg2_threads_t * t = mpeg2dec->threads;
+    int size;
+
+    if (!t || !t->nb_slices)
+	return;
+
+    if (t->nb_slices == 1)
+	mpeg2_slice (&(mpeg2dec->decoder), t->slices[0].code,
+		     t->slices[0].buffer);
+    else
+	run_jobs (mpeg2dec);
+    t->nb_slices = 0;
+
+    size = mpeg2dec->chunk_ptr - mpeg2dec->chunk_start;
+    memmove (mpeg2dec->chunk_buffer, mpeg2dec->chunk_start, size);
+    mpeg2dec->chunk_start = mpeg2dec->chunk_buffer;
+    mpeg2dec->chunk_ptr = mpeg2dec->chunk_buffer + size;
+}
+
+void mpeg2_threads (mpeg2dec_t * mpeg2dec, int threads)
+{
+    mpeg2_threads_t * t;
+    int i;
+
+    free_threads (mpeg2dec);
+    if (threads > MAX_THREADS)
+	threads = MAX_THREADS;
+    if (threads < 2)
+	return;
+
+    t = (mpeg2_threads_t *) calloc (1, sizeof (mpeg2_threads_t));
+    if (t == NULL)
+	return;
+    pthread_mutex_init (&t->lock, NULL);
+    pthread_cond_init (&t->work_cond, NULL);
+    pthread_cond_init (&t->done_cond, NULL);
+    t->job[0].threads = t;
+    t->job[0].decoder = &(mpeg2dec->decoder);
+    t->count = 1;
+    mpeg2dec->threads = t;
+    for (i = 1; i < threads; i++) {
+	slice_job_t * job = &t->job[i];
+
+	job->threads = t;
+	job->index = i;
+	job->decoder = (mpeg2_decoder_t *)
+	    mpeg2_malloc (sizeof (mpeg2_decoder_t), MPEG2_ALLOC_MPEG2DEC);
+	if (job->decoder == NULL)
+	    break;
+	if (pthread_create (&job->thread, NULL, slice_thread, job)) {
+	    mpeg2_free (job->decoder);
+	    break;
+	}
+	t->count++;
+    }
+    if (t->count < 2)
+	free_threads (mpeg2dec);
+}
+#else
+#define queue_slice(mpeg2dec) 0
+#define decode_slices(mpeg2dec)
+#define free_threads(mpeg2dec)
+
+void mpeg2_threads (mpeg2dec_t * mpeg2dec, int threads)
+{
+}
+#endif /* HAVE_PTHREADS */
+
 const mpeg2_info_t * mpeg2_info (mpeg2dec_t * mpeg2dec)
 {
     return &(mpeg2dec->info);
@@ -171,6 +391,12 @@ mpeg2_state_t mpeg2_parse (mpeg2dec_t * mpeg2dec)
 	    size_buffer = mpeg2dec->buf_end - mpeg2dec->buf_start;
 	    size_chunk = (mpeg2dec->chunk_buffer + BUFFER_SIZE -
 			  mpeg2dec->chunk_ptr);
+	    if (size_buffer > size_chunk) {
+		/* make room for the slice */
+		decode_slices (mpeg2dec);
+		size_chunk = (mpeg2dec->chunk_buffer + BUFFER_SIZE -
+			      mpeg2dec->chunk_ptr);
+	    }
 	    if (size_buffer <= size_chunk) {
 		copied = copy_chunk (mpeg2dec, size_buffer);
 		if (!copied) {
@@ -189,16 +415,21 @@ mpeg2_state_t mpeg2_parse (mpeg2dec_t * mpeg2dec)
 	    }
 	    mpeg2dec->bytes_since_tag += copied;
 
-	    mpeg2_slice (&(mpeg2dec->decoder), mpeg2dec->code,
-			 mpeg2dec->chunk_start);
+	    if (queue_slice (mpeg2dec))
+		mpeg2dec->chunk_start = mpeg2dec->chunk_ptr;
+	    else {
+		mpeg2_slice (&(mpeg2dec->decoder), mpeg2dec->code,
+			     mpeg2dec->chunk_start);
+		mpeg2dec->chunk_ptr = mpeg2dec->chunk_start;
+	    }
 	    mpeg2dec->code = mpeg2dec->buf_start[-1];
-	    mpeg2dec->chunk_ptr = mpeg2dec->chunk_start;
 	}
 	if ((unsigned) (mpeg2dec->code - 1) >= 0xb0 - 1)
 	    break;
 	if (seek_chunk (mpeg2dec) == STATE_BUFFER)
 	    return STATE_BUFFER;
     }
+    decode_slices (mpeg2dec);
 
     mpeg2dec->action = mpeg2_seek_header;
     switch (mpeg2dec->code) {
@@ -409,6 +640,10 @@ void mpeg2_reset (mpeg2dec_t * mpeg2dec, int full_reset)
     mpeg2dec->action = mpeg2_seek_header;
     mpeg2dec->state = STATE_INVALID;
     mpeg2dec->first = 1;
+#if HAVE_PTHREADS
+    if (mpeg2dec->threads)
+	mpeg2dec->threads->nb_slices = 0;
+#endif
 
     mpeg2_reset_info(&(mpeg2dec->info));
     mpeg2dec->info.gop = NULL;
@@ -439,6 +674,7 @@ mpeg2dec_t * mpeg2_init (void)
 						       MPEG2_ALLOC_CHUNK);
 
     mpeg2dec->sequence.width = (unsigned)-1;
+    mpeg2dec->threads = NULL;
     mpeg2_reset (mpeg2dec, 1);
 
     return mpeg2dec;
@@ -446,6 +682,7 @@ mpeg2dec_t * mpeg2_init (void)
 
 void mpeg2_close (mpeg2dec_t * mpeg2dec)
 {
+    free_threads (mpeg2dec);
     mpeg2_header_state_init (mpeg2dec);
     mpeg2_free (mpeg2dec->chunk_buffer);
     mpeg2_free (mpeg2dec);
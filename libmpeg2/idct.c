@@ -245,13 +245,15 @@ void mpeg2_idct_init (uint32_t accel)
 	mpeg2_idct_add = mpeg2_idct_add_sse2;
 	mpeg2_idct_mmx_init ();
     } else
-#elif HAVE_MMX2
+#endif
+#if HAVE_MMX2
     if (accel & MPEG2_ACCEL_X86_MMXEXT) {
 	mpeg2_idct_copy = mpeg2_idct_copy_mmxext;
 	mpeg2_idct_add = mpeg2_idct_add_mmxext;
 	mpeg2_idct_mmx_init ();
     } else
-#elif HAVE_MMX
+#endif
+#if HAVE_MMX
     if (accel & MPEG2_ACCEL_X86_MMX) {
 	mpeg2_idct_copy = mpeg2_idct_copy_mmx;
 	mpeg2_idct_add = mpeg2_idct_add_mmx;
@@ -37,6 +37,11 @@ mpeg2_mc_t mpeg2_mc;
 
 void mpeg2_mc_init (uint32_t accel)
 {
+#if HAVE_SSE2
+    if (accel & MPEG2_ACCEL_X86_SSE2)
+	mpeg2_mc = mpeg2_mc_sse2;
+    else
+#endif
 #if HAVE_MMX2
     if (accel & MPEG2_ACCEL_X86_MMXEXT)
 	mpeg2_mc = mpeg2_mc_mmxext;
@@ -1010,4 +1010,226 @@ MPEG2_MC_EXTERN (3dnow)
 
 #endif /* HAVE_AMD3DNOW */
 
+#if HAVE_SSE2
+
+/* CPU_SSE2 code, whole 16 pixel rows in one register */
+/* the 8 pixel wide blocks use the MMXEXT code */
+
+
+static sse_t mask_one_sse2 = {{0x0101010101010101LL, 0x0101010101010101LL}};
+
+static inline void MC_put1_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_avg1_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*dest, xmm1);
+	pavgb_r2r (xmm1, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_put2_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride,
+				    const int offset)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+offset), xmm1);
+	pavgb_r2r (xmm1, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_avg2_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride,
+				    const int offset)
+{
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+offset), xmm1);
+	movdqu_m2r (*dest, xmm2);
+	pavgb_r2r (xmm1, xmm0);
+	pavgb_r2r (xmm2, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+/* same rounding as MC_put4_16 */
+static inline void MC_put4_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    movdqa_m2r (mask_one_sse2, xmm5);
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+stride+1), xmm1);
+	movdqa_r2r (xmm0, xmm7);
+	movdqu_m2r (*(ref+1), xmm2);
+	pxor_r2r (xmm1, xmm7);
+	movdqu_m2r (*(ref+stride), xmm3);
+	movdqa_r2r (xmm2, xmm6);
+	pxor_r2r (xmm3, xmm6);
+	pavgb_r2r (xmm1, xmm0);
+	pavgb_r2r (xmm3, xmm2);
+	por_r2r (xmm6, xmm7);
+	movdqa_r2r (xmm0, xmm6);
+	pxor_r2r (xmm2, xmm6);
+	pand_r2r (xmm6, xmm7);
+	pand_r2r (xmm5, xmm7);
+	pavgb_r2r (xmm2, xmm0);
+	psubusb_r2r (xmm7, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static inline void MC_avg4_16_sse2 (int height, uint8_t * dest,
+				    const uint8_t * ref, const int stride)
+{
+    movdqa_m2r (mask_one_sse2, xmm5);
+    do {
+	movdqu_m2r (*ref, xmm0);
+	movdqu_m2r (*(ref+stride+1), xmm1);
+	movdqa_r2r (xmm0, xmm7);
+	movdqu_m2r (*(ref+1), xmm2);
+	pxor_r2r (xmm1, xmm7);
+	movdqu_m2r (*(ref+stride), xmm3);
+	movdqa_r2r (xmm2, xmm6);
+	pxor_r2r (xmm3, xmm6);
+	pavgb_r2r (xmm1, xmm0);
+	pavgb_r2r (xmm3, xmm2);
+	por_r2r (xmm6, xmm7);
+	movdqa_r2r (xmm0, xmm6);
+	pxor_r2r (xmm2, xmm6);
+	pand_r2r (xmm6, xmm7);
+	pand_r2r (xmm5, xmm7);
+	pavgb_r2r (xmm2, xmm0);
+	psubusb_r2r (xmm7, xmm0);
+	movdqu_m2r (*dest, xmm1);
+	pavgb_r2r (xmm1, xmm0);
+	ref += stride;
+	movdqu_r2m (xmm0, *dest);
+	dest += stride;
+    } while (--height);
+}
+
+static void MC_avg_o_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg1_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_avg_o_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg1_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+static void MC_put_o_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put1_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_put_o_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put1_8 (height, dest, ref, stride);
+}
+
+static void MC_avg_x_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg2_16_sse2 (height, dest, ref, stride, 1);
+}
+
+static void MC_avg_x_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg2_8 (height, dest, ref, stride, 1, CPU_MMXEXT);
+}
+
+static void MC_put_x_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put2_16_sse2 (height, dest, ref, stride, 1);
+}
+
+static void MC_put_x_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put2_8 (height, dest, ref, stride, 1, CPU_MMXEXT);
+}
+
+static void MC_avg_y_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg2_16_sse2 (height, dest, ref, stride, stride);
+}
+
+static void MC_avg_y_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_avg2_8 (height, dest, ref, stride, stride, CPU_MMXEXT);
+}
+
+static void MC_put_y_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put2_16_sse2 (height, dest, ref, stride, stride);
+}
+
+static void MC_put_y_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			     int stride, int height)
+{
+    MC_put2_8 (height, dest, ref, stride, stride, CPU_MMXEXT);
+}
+
+static void MC_avg_xy_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			       int stride, int height)
+{
+    MC_avg4_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_avg_xy_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_avg4_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+static void MC_put_xy_16_sse2 (uint8_t * dest, const uint8_t * ref,
+			       int stride, int height)
+{
+    MC_put4_16_sse2 (height, dest, ref, stride);
+}
+
+static void MC_put_xy_8_sse2 (uint8_t * dest, const uint8_t * ref,
+			      int stride, int height)
+{
+    MC_put4_8 (height, dest, ref, stride, CPU_MMXEXT);
+}
+
+
+MPEG2_MC_EXTERN (sse2)
+
+#endif /* HAVE_SSE2 */
+
 #endif
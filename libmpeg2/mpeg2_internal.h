@@ -167,6 +167,8 @@ typedef struct {
     mpeg2_fbuf_t fbuf;
 } fbuf_alloc_t;
 
+typedef struct mpeg2_threads_s mpeg2_threads_t;
+
 struct mpeg2dec_s {
     mpeg2_decoder_t decoder;
 
@@ -235,6 +237,9 @@ struct mpeg2dec_s {
 
     unsigned char *pending_buffer;
     int pending_length;
+
+    /* threads decoding the slices, NULL if they are decoded by the parser */
+    mpeg2_threads_t * threads;
 };
 
 typedef struct {
@@ -320,6 +325,7 @@ typedef struct {
 extern mpeg2_mc_t mpeg2_mc_c;
 extern mpeg2_mc_t mpeg2_mc_mmx;
 extern mpeg2_mc_t mpeg2_mc_mmxext;
+extern mpeg2_mc_t mpeg2_mc_sse2;
 extern mpeg2_mc_t mpeg2_mc_3dnow;
 extern mpeg2_mc_t mpeg2_mc_altivec;
 extern mpeg2_mc_t mpeg2_mc_alpha;
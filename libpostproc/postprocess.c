@@ -79,6 +79,10 @@ try to unroll inner for(x=0 ... loop to avoid these damn if(x ... checks
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 //#undef HAVE_MMX2
 //#define HAVE_AMD3DNOW
 //#undef HAVE_MMX
@@ -563,6 +567,269 @@ static av_always_inline void do_a_deblock_C(uint8_t *src, int step, int stride,
 }*/
 }
 
+/**
+ * One plane as given to the rows function of a template.
+ */
+typedef struct PPRows{
+    const uint8_t *src;
+    int srcStride;
+    uint8_t *dst;
+    int dstStride;
+    int width;
+    int height;
+    const QP_STORE_T *QPs;
+    int QPStride;
+    int isColor;
+    int copyAhead;
+    int QPCorrecture;
+} PPRows;
+
+/**
+ * The rows of blocks filtered by one thread: first, first+step, ...
+ * Every row can only be filtered behind the row above it, so the threads
+ * work on neighbouring rows like a wavefront and the output is identical
+ * to filtering all rows in order.
+ */
+typedef struct PPRowJob{
+    struct PPThreads *t;          ///< NULL if all rows are filtered by one thread
+    int first;
+    int step;
+    uint8_t *tempBlocks;
+    uint64_t *yHistogram;
+    int above;                    ///< last known progress of the row above
+} PPRowJob;
+
+typedef void (*PPRowsFunc)(const PPContext *c, const PPRows *r, PPRowJob *j);
+
+#define PP_MAX_THREADS 16
+#define PP_ROW_DONE INT_MAX
+
+/* a block touches the columns x-9 to x+8, the deringing of the block to
+   its left included, so blocks 3 apart never touch the same pixels */
+#define PP_ROW_DISTANCE (3*BLOCK_SIZE)
+
+/* The last block of a line and the deringing reach past the ends of the
+   lines. Without padding they touch the neighbouring lines, which may
+   belong to a row that another thread is filtering. */
+#define PP_PADDED(stride, width) (FFABS(stride) >= FFALIGN(width, BLOCK_SIZE) + BLOCK_SIZE)
+
+#if HAVE_PTHREADS
+typedef struct PPThreads{
+    int count;                    ///< number of jobs, job 0 is run by the caller
+    pthread_t thread[PP_MAX_THREADS];
+    PPRowJob job[PP_MAX_THREADS];
+    uint64_t *yHistogram[PP_MAX_THREADS];
+
+    /* current plane */
+    PPRowsFunc rows;
+    const PPContext *c;
+    const PPRows *r;
+    int jobs;                     ///< jobs used for this plane, less for small planes
+    int *progress;                ///< x of the first block not filtered yet, per row
+    int progressSize;
+
+    int plane;                    ///< incremented to wake up the threads
+    int pending;
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    pthread_cond_t progress_cond;
+} PPThreads;
+
+/**
+ * Waits until the row above has left the pixels of block x behind.
+ * x == PP_ROW_DONE waits for the whole row above.
+ */
+static void pp_wait_row(PPRowJob *j, int y, int x, int width)
+{
+    PPThreads *t= j->t;
+    int row= y/BLOCK_SIZE;
+    int need;
+
+    if(!t || !row) return;
+    need= x > width - PP_ROW_DISTANCE ? PP_ROW_DONE : x + PP_ROW_DISTANCE;
+    if(j->above >= need) return;
+    pthread_mutex_lock(&t->lock);
+    while(t->progress[row-1] < need)
+        pthread_cond_wait(&t->progress_cond, &t->lock);
+    j->above= t->progress[row-1];
+    pthread_mutex_unlock(&t->lock);
+}
+
+/// Publishes that the blocks of the row left of x are done.
+static void pp_row_progress(PPRowJob *j, int y, int x)
+{
+    PPThreads *t= j->t;
+
+    if(!t) return;
+    if(x == PP_ROW_DONE)
+        j->above= 0; // the next row of this thread has another row above
+    else if(x & (4*BLOCK_SIZE-1))
+        return;
+    pthread_mutex_lock(&t->lock);
+    t->progress[y/BLOCK_SIZE]= x;
+    pthread_cond_broadcast(&t->progress_cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+static void *pp_thread(void *arg)
+{
+    PPRowJob *j= arg;
+    PPThreads *t= j->t;
+    int plane= 0;
+
+    pthread_mutex_lock(&t->lock);
+    while(1){
+        while(t->plane == plane && !t->quit)
+            pthread_cond_wait(&t->work_cond, &t->lock);
+        if(t->quit) break;
+        plane= t->plane;
+        if(j - t->job >= t->jobs) continue;
+        pthread_mutex_unlock(&t->lock);
+
+        t->rows(t->c, t->r, j);
+
+        pthread_mutex_lock(&t->lock);
+        if(!--t->pending)
+            pthread_cond_signal(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static void pp_free_threads(PPContext *c)
+{
+    PPThreads *t= c->thr;
+    int i;
+
+    if(!t) return;
+    pthread_mutex_lock(&t->lock);
+    t->quit= 1;
+    pthread_cond_broadcast(&t->work_cond);
+    pthread_mutex_unlock(&t->lock);
+    for(i=1; i<t->count; i++)
+        pthread_join(t->thread[i], NULL);
+    for(i=0; i<t->count; i++){
+        av_free(t->job[i].tempBlocks);
+        av_free(t->yHistogram[i]);
+    }
+    av_free(t->progress);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->work_cond);
+    pthread_cond_destroy(&t->done_cond);
+    pthread_cond_destroy(&t->progress_cond);
+    av_freep(&c->thr);
+}
+
+static PPThreads *pp_init_threads(PPContext *c)
+{
+    PPThreads *t= av_mallocz(sizeof(PPThreads));
+    int i;
+
+    if(!t) return NULL;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->work_cond, NULL);
+    pthread_cond_init(&t->done_cond, NULL);
+    pthread_cond_init(&t->progress_cond, NULL);
+    c->thr= t;
+    for(i=0; i<c->threads; i++){
+        t->job[i].t= t;
+        t->job[i].tempBlocks= av_mallocz(2*16*8);
+        t->yHistogram[i]= av_mallocz(256*sizeof(uint64_t));
+        if(!t->job[i].tempBlocks || !t->yHistogram[i] ||
+           (i && pthread_create(&t->thread[i], NULL, pp_thread, &t->job[i]))){
+            av_free(t->job[i].tempBlocks);
+            av_free(t->yHistogram[i]);
+            break;
+        }
+        t->count= i+1;
+    }
+    if(t->count < 2){
+        av_log(c, AV_LOG_WARNING, "Could not start %d postprocessing threads.\n", c->threads);
+        pp_free_threads(c);
+        c->threads= 1;
+        return NULL;
+    }
+    return t;
+}
+
+static void pp_filter_rows(PPContext *c, const PPRows *r, PPRowsFunc rows)
+{
+    PPThreads *t= c->thr;
+    int blockRows= (r->height + BLOCK_SIZE - 1)/BLOCK_SIZE;
+    int mode= r->isColor ? c->ppMode.chromMode : c->ppMode.lumMode;
+    int i, k;
+
+    if(c->threads > 1 && !t)
+        t= pp_init_threads(c);
+    // the two line buffers of the lowpass5 deinterlacer overlap if the
+    // width is not a multiple of the block size
+    if(!t || blockRows < 2 || !PP_PADDED(r->dstStride, r->width) ||
+       (r->src == r->dst && !PP_PADDED(r->srcStride, r->width)) ||
+       ((mode & LOWPASS5_DEINT_FILTER) && r->width % BLOCK_SIZE)){
+        PPRowJob j= { NULL, 0, 1, c->tempBlocks, c->yHistogram, 0 };
+        rows(c, r, &j);
+        return;
+    }
+
+    if(t->progressSize < blockRows){
+        av_free(t->progress);
+        t->progress= av_malloc(blockRows*sizeof(int));
+        t->progressSize= t->progress ? blockRows : 0;
+        if(!t->progress){
+            PPRowJob j= { NULL, 0, 1, c->tempBlocks, c->yHistogram, 0 };
+            rows(c, r, &j);
+            return;
+        }
+    }
+    memset(t->progress, 0, blockRows*sizeof(int));
+
+    t->jobs= FFMIN(t->count, blockRows);
+    for(i=0; i<t->jobs; i++){
+        PPRowJob *j= &t->job[i];
+        j->first= i;
+        j->step= t->jobs;
+        j->above= 0;
+        // the first thread counts into the histogram of the context
+        j->yHistogram= i ? t->yHistogram[i] : c->yHistogram;
+        if(i && !r->isColor)
+            memset(j->yHistogram, 0, 256*sizeof(uint64_t));
+    }
+
+    pthread_mutex_lock(&t->lock);
+    t->rows= rows;
+    t->c= c;
+    t->r= r;
+    t->pending= t->jobs - 1;
+    t->plane++;
+    pthread_cond_broadcast(&t->work_cond);
+    pthread_mutex_unlock(&t->lock);
+
+    rows(c, r, &t->job[0]);
+
+    pthread_mutex_lock(&t->lock);
+    while(t->pending)
+        pthread_cond_wait(&t->done_cond, &t->lock);
+    pthread_mutex_unlock(&t->lock);
+
+    if(!r->isColor)
+        for(i=1; i<t->jobs; i++)
+            for(k=0; k<256; k++)
+                c->yHistogram[k]+= t->yHistogram[i][k];
+}
+#else /* HAVE_PTHREADS */
+static void pp_wait_row(PPRowJob *j, int y, int x, int width) {}
+static void pp_row_progress(PPRowJob *j, int y, int x) {}
+static void pp_free_threads(PPContext *c) {}
+
+static void pp_filter_rows(PPContext *c, const PPRows *r, PPRowsFunc rows)
+{
+    PPRowJob j= { NULL, 0, 1, c->tempBlocks, c->yHistogram, 0 };
+    rows(c, r, &j);
+}
+#endif /* HAVE_PTHREADS */
+
 //Note: we have C, MMX, MMX2, 3DNOW version there is no 3DNOW+MMX2 one
 //Plain C versions
 #if !(HAVE_MMX || HAVE_ALTIVEC) || CONFIG_RUNTIME_CPUDETECT
@@ -979,14 +1246,28 @@ pp_context *pp_get_context(int width, int height, int cpuCaps){
     reallocBuffers(c, width, height, stride, qpStride);
 
     c->frameNum=-1;
+    c->threads= 1;
 
     return c;
 }
 
+int pp_set_threads(pp_context *vc, int threads){
+    PPContext *c = (PPContext*)vc;
+
+    if(threads < 1 || threads > PP_MAX_THREADS)
+        return -1;
+    if(threads != c->threads)
+        pp_free_threads(c);
+    c->threads= threads;
+    return 0;
+}
+
 void pp_free_context(void *vc){
     PPContext *c = (PPContext*)vc;
     int i;
 
+    pp_free_threads(c);
+
     for(i=0; i<3; i++) av_free(c->tempBlurred[i]);
     for(i=0; i<3; i++) av_free(c->tempBlurredPast[i]);
 
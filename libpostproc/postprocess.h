@@ -30,7 +30,7 @@
 #include "libavutil/avutil.h"
 
 #define LIBPOSTPROC_VERSION_MAJOR 51
-#define LIBPOSTPROC_VERSION_MINOR  2
+#define LIBPOSTPROC_VERSION_MINOR  3
 #define LIBPOSTPROC_VERSION_MICRO  0
 
 #define LIBPOSTPROC_VERSION_INT AV_VERSION_INT(LIBPOSTPROC_VERSION_MAJOR, \
@@ -93,6 +93,13 @@ void pp_free_mode(pp_mode *mode);
 pp_context *pp_get_context(int width, int height, int flags);
 void pp_free_context(pp_context *ppContext);
 
+/**
+ * Sets the number of threads filtering the rows of blocks of a plane.
+ * The output does not depend on the number of threads.
+ * returns a negative value if the number is not between 1 and 16
+ */
+int pp_set_threads(pp_context *ppContext, int threads);
+
 #define PP_CPU_CAPS_MMX   0x80000000
 #define PP_CPU_CAPS_MMX2  0x20000000
 #define PP_CPU_CAPS_3DNOW 0x40000000
@@ -164,6 +164,9 @@ typedef struct PPContext{
     int vChromaSubSample;
 
     PPMode ppMode;
+
+    int threads;                  ///< number of threads filtering the rows of blocks
+    struct PPThreads *thr;
 } PPContext;
 
 
@@ -3163,118 +3163,39 @@ static inline void RENAME(duplicate)(uint8_t src[], int stride)
 }
 
 /**
- * Filters array of bytes (Y or U or V values)
+ * Filters the rows of blocks of a plane given by the job.
  */
-static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[], int dstStride, int width, int height,
-                                const QP_STORE_T QPs[], int QPStride, int isColor, PPContext *c2)
+static void RENAME(postProcessRows)(const PPContext *c2, const PPRows *r, PPRowJob *j)
 {
     DECLARE_ALIGNED(8, PPContext, c)= *c2; //copy to stack for faster access
+    const uint8_t * const src= r->src;
+    const int srcStride= r->srcStride;
+    uint8_t * const dst= r->dst;
+    const int dstStride= r->dstStride;
+    const int width= r->width;
+    const int height= r->height;
+    const QP_STORE_T * const QPs= r->QPs;
+    const int QPStride= r->QPStride;
+    const int isColor= r->isColor;
+    const int copyAhead= r->copyAhead;
+    const int QPCorrecture= r->QPCorrecture;
     int x,y;
 #ifdef COMPILE_TIME_MODE
     const int mode= COMPILE_TIME_MODE;
 #else
     const int mode= isColor ? c.ppMode.chromMode : c.ppMode.lumMode;
 #endif
-    int black=0, white=255; // blackest black and whitest white in the picture
-    int QPCorrecture= 256*256;
-
-    int copyAhead;
-#if HAVE_MMX
-    int i;
-#endif
 
     const int qpHShift= isColor ? 4-c.hChromaSubSample : 4;
     const int qpVShift= isColor ? 4-c.vChromaSubSample : 4;
 
-    //FIXME remove
-    uint64_t * const yHistogram= c.yHistogram;
+    uint64_t * const yHistogram= j->yHistogram;
     uint8_t * const tempSrc= srcStride > 0 ? c.tempSrc : c.tempSrc - 23*srcStride;
     uint8_t * const tempDst= dstStride > 0 ? c.tempDst : c.tempDst - 23*dstStride;
-    //const int mbWidth= isColor ? (width+7)>>3 : (width+15)>>4;
-
-#if HAVE_MMX
-    for(i=0; i<57; i++){
-        int offset= ((i*c.ppMode.baseDcDiff)>>8) + 1;
-        int threshold= offset*2 + 1;
-        c.mmxDcOffset[i]= 0x7F - offset;
-        c.mmxDcThreshold[i]= 0x7F - threshold;
-        c.mmxDcOffset[i]*= 0x0101010101010101LL;
-        c.mmxDcThreshold[i]*= 0x0101010101010101LL;
-    }
-#endif
-
-    if(mode & CUBIC_IPOL_DEINT_FILTER) copyAhead=16;
-    else if(   (mode & LINEAR_BLEND_DEINT_FILTER)
-            || (mode & FFMPEG_DEINT_FILTER)
-            || (mode & LOWPASS5_DEINT_FILTER)) copyAhead=14;
-    else if(   (mode & V_DEBLOCK)
-            || (mode & LINEAR_IPOL_DEINT_FILTER)
-            || (mode & MEDIAN_DEINT_FILTER)
-            || (mode & V_A_DEBLOCK)) copyAhead=13;
-    else if(mode & V_X1_FILTER) copyAhead=11;
-//    else if(mode & V_RK1_FILTER) copyAhead=10;
-    else if(mode & DERING) copyAhead=9;
-    else copyAhead=8;
-
-    copyAhead-= 8;
-
-    if(!isColor){
-        uint64_t sum= 0;
-        int i;
-        uint64_t maxClipped;
-        uint64_t clipped;
-        double scale;
-
-        c.frameNum++;
-        // first frame is fscked so we ignore it
-        if(c.frameNum == 1) yHistogram[0]= width*height/64*15/256;
-
-        for(i=0; i<256; i++){
-            sum+= yHistogram[i];
-        }
-
-        /* We always get a completely black picture first. */
-        maxClipped= (uint64_t)(sum * c.ppMode.maxClippedThreshold);
-
-        clipped= sum;
-        for(black=255; black>0; black--){
-            if(clipped < maxClipped) break;
-            clipped-= yHistogram[black];
-        }
-
-        clipped= sum;
-        for(white=0; white<256; white++){
-            if(clipped < maxClipped) break;
-            clipped-= yHistogram[white];
-        }
-
-        scale= (double)(c.ppMode.maxAllowedY - c.ppMode.minAllowedY) / (double)(white-black);
-
-#if HAVE_MMX2
-        c.packedYScale= (uint16_t)(scale*256.0 + 0.5);
-        c.packedYOffset= (((black*c.packedYScale)>>8) - c.ppMode.minAllowedY) & 0xFFFF;
-#else
-        c.packedYScale= (uint16_t)(scale*1024.0 + 0.5);
-        c.packedYOffset= (black - c.ppMode.minAllowedY) & 0xFFFF;
-#endif
-
-        c.packedYOffset|= c.packedYOffset<<32;
-        c.packedYOffset|= c.packedYOffset<<16;
-
-        c.packedYScale|= c.packedYScale<<32;
-        c.packedYScale|= c.packedYScale<<16;
-
-        if(mode & LEVEL_FIX)        QPCorrecture= (int)(scale*256*256 + 0.5);
-        else                        QPCorrecture= 256*256;
-    }else{
-        c.packedYScale= 0x0100010001000100LL;
-        c.packedYOffset= 0;
-        QPCorrecture= 256*256;
-    }
 
     /* copy & deinterlace first row of blocks */
     y=-BLOCK_SIZE;
-    {
+    if(j->first == 0){
         const uint8_t *srcBlock= &(src[y*srcStride]);
         uint8_t *dstBlock= tempDst + dstStride;
 
@@ -3352,13 +3273,13 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
         }
     }
 
-    for(y=0; y<height; y+=BLOCK_SIZE){
+    for(y=j->first*BLOCK_SIZE; y<height; y+=j->step*BLOCK_SIZE){
         //1% speedup if these are here instead of the inner loop
         const uint8_t *srcBlock= &(src[y*srcStride]);
         uint8_t *dstBlock= &(dst[y*dstStride]);
 #if HAVE_MMX
-        uint8_t *tempBlock1= c.tempBlocks;
-        uint8_t *tempBlock2= c.tempBlocks + 8;
+        uint8_t *tempBlock1= j->tempBlocks;
+        uint8_t *tempBlock2= j->tempBlocks + 8;
 #endif
         const int8_t *QPptr= &QPs[(y>>qpVShift)*QPStride];
         int8_t *nonBQPptr= &c.nonBQPTable[(y>>qpVShift)*FFABS(QPStride)];
@@ -3367,6 +3288,7 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
            if not than use a temporary buffer */
         if(y+15 >= height){
             int i;
+            pp_wait_row(j, y, PP_ROW_DONE, width);
             /* copy from line (copyAhead) to (copyAhead+7) of src, these will be copied with
                blockcopy to dst later */
             linecpy(tempSrc + srcStride*copyAhead, srcBlock + srcStride*copyAhead,
@@ -3395,6 +3317,7 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
 #if HAVE_MMX
             uint8_t *tmpXchg;
 #endif
+            pp_wait_row(j, y, x, width);
             if(isColor){
                 QP= QPptr[x>>qpHShift];
                 c.nonBQP= nonBQPptr[x>>qpHShift];
@@ -3563,6 +3486,7 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
             tempBlock1= tempBlock2;
             tempBlock2 = tmpXchg;
 #endif
+            pp_row_progress(j, y, x + BLOCK_SIZE);
         }
 
         if(mode & DERING){
@@ -3588,6 +3512,7 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
                 }
             }
         }
+        pp_row_progress(j, y, PP_ROW_DONE);
 /*
         for(x=0; x<width; x+=32){
             volatile int i;
@@ -3604,6 +3529,126 @@ static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[
     __asm__ volatile("emms");
 #endif
 
+}
+
+/**
+ * Filters array of bytes (Y or U or V values)
+ */
+static void RENAME(postProcess)(const uint8_t src[], int srcStride, uint8_t dst[], int dstStride, int width, int height,
+                                const QP_STORE_T QPs[], int QPStride, int isColor, PPContext *c2)
+{
+    DECLARE_ALIGNED(8, PPContext, c)= *c2; //copy to stack for faster access
+    PPRows r;
+#ifdef COMPILE_TIME_MODE
+    const int mode= COMPILE_TIME_MODE;
+#else
+    const int mode= isColor ? c.ppMode.chromMode : c.ppMode.lumMode;
+#endif
+    int black=0, white=255; // blackest black and whitest white in the picture
+    int QPCorrecture= 256*256;
+
+    int copyAhead;
+#if HAVE_MMX
+    int i;
+#endif
+
+    //FIXME remove
+    uint64_t * const yHistogram= c.yHistogram;
+    //const int mbWidth= isColor ? (width+7)>>3 : (width+15)>>4;
+
+#if HAVE_MMX
+    for(i=0; i<57; i++){
+        int offset= ((i*c.ppMode.baseDcDiff)>>8) + 1;
+        int threshold= offset*2 + 1;
+        c.mmxDcOffset[i]= 0x7F - offset;
+        c.mmxDcThreshold[i]= 0x7F - threshold;
+        c.mmxDcOffset[i]*= 0x0101010101010101LL;
+        c.mmxDcThreshold[i]*= 0x0101010101010101LL;
+    }
+#endif
+
+    if(mode & CUBIC_IPOL_DEINT_FILTER) copyAhead=16;
+    else if(   (mode & LINEAR_BLEND_DEINT_FILTER)
+            || (mode & FFMPEG_DEINT_FILTER)
+            || (mode & LOWPASS5_DEINT_FILTER)) copyAhead=14;
+    else if(   (mode & V_DEBLOCK)
+            || (mode & LINEAR_IPOL_DEINT_FILTER)
+            || (mode & MEDIAN_DEINT_FILTER)
+            || (mode & V_A_DEBLOCK)) copyAhead=13;
+    else if(mode & V_X1_FILTER) copyAhead=11;
+//    else if(mode & V_RK1_FILTER) copyAhead=10;
+    else if(mode & DERING) copyAhead=9;
+    else copyAhead=8;
+
+    copyAhead-= 8;
+
+    if(!isColor){
+        uint64_t sum= 0;
+        int i;
+        uint64_t maxClipped;
+        uint64_t clipped;
+        double scale;
+
+        c.frameNum++;
+        // first frame is fscked so we ignore it
+        if(c.frameNum == 1) yHistogram[0]= width*height/64*15/256;
+
+        for(i=0; i<256; i++){
+            sum+= yHistogram[i];
+        }
+
+        /* We always get a completely black picture first. */
+        maxClipped= (uint64_t)(sum * c.ppMode.maxClippedThreshold);
+
+        clipped= sum;
+        for(black=255; black>0; black--){
+            if(clipped < maxClipped) break;
+            clipped-= yHistogram[black];
+        }
+
+        clipped= sum;
+        for(white=0; white<256; white++){
+            if(clipped < maxClipped) break;
+            clipped-= yHistogram[white];
+        }
+
+        scale= (double)(c.ppMode.maxAllowedY - c.ppMode.minAllowedY) / (double)(white-black);
+
+#if HAVE_MMX2
+        c.packedYScale= (uint16_t)(scale*256.0 + 0.5);
+        c.packedYOffset= (((black*c.packedYScale)>>8) - c.ppMode.minAllowedY) & 0xFFFF;
+#else
+        c.packedYScale= (uint16_t)(scale*1024.0 + 0.5);
+        c.packedYOffset= (black - c.ppMode.minAllowedY) & 0xFFFF;
+#endif
+
+        c.packedYOffset|= c.packedYOffset<<32;
+        c.packedYOffset|= c.packedYOffset<<16;
+
+        c.packedYScale|= c.packedYScale<<32;
+        c.packedYScale|= c.packedYScale<<16;
+
+        if(mode & LEVEL_FIX)        QPCorrecture= (int)(scale*256*256 + 0.5);
+        else                        QPCorrecture= 256*256;
+    }else{
+        c.packedYScale= 0x0100010001000100LL;
+        c.packedYOffset= 0;
+        QPCorrecture= 256*256;
+    }
+
+    r.src= src;
+    r.srcStride= srcStride;
+    r.dst= dst;
+    r.dstStride= dstStride;
+    r.width= width;
+    r.height= height;
+    r.QPs= QPs;
+    r.QPStride= QPStride;
+    r.isColor= isColor;
+    r.copyAhead= copyAhead;
+    r.QPCorrecture= QPCorrecture;
+    pp_filter_rows(&c, &r, RENAME(postProcessRows));
+
 #ifdef DEBUG_BRIGHTNESS
     if(!isColor){
         int max=1;
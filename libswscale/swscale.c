@@ -1923,6 +1923,12 @@ int sws_scale(SwsContext *c, const uint8_t* const src[], const int srcStride[],
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
+        if (c->threads > 1 && srcSliceY == 0 && srcSliceH == c->srcH) {
+            int ret = ff_sws_scale_threaded(c, src2, srcStride2, dst2, dstStride2);
+            if (ret >= 0)
+                return ret;
+        }
+
         return c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2, dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
@@ -30,7 +30,7 @@
 #include "libavutil/avutil.h"
 
 #define LIBSWSCALE_VERSION_MAJOR 0
-#define LIBSWSCALE_VERSION_MINOR 10
+#define LIBSWSCALE_VERSION_MINOR 11
 #define LIBSWSCALE_VERSION_MICRO 0
 
 #define LIBSWSCALE_VERSION_INT  AV_VERSION_INT(LIBSWSCALE_VERSION_MAJOR, \
@@ -92,6 +92,7 @@ const char *swscale_license(void);
 #define SWS_CPU_CAPS_3DNOW    0x40000000
 #define SWS_CPU_CAPS_ALTIVEC  0x10000000
 #define SWS_CPU_CAPS_BFIN     0x01000000
+#define SWS_CPU_CAPS_SSE2     0x02000000
 
 #define SWS_MAX_REDUCE_CUTOFF 0.002
 
@@ -166,6 +167,17 @@ struct SwsContext *sws_getContext(int srcW, int srcH, enum PixelFormat srcFormat
                                   int flags, SwsFilter *srcFilter,
                                   SwsFilter *dstFilter, const double *param);
 
+/**
+ * Sets the number of threads used to scale whole frames. When sws_scale()
+ * is given a complete frame the destination is split into horizontal bands
+ * which are scaled in parallel. The output is the same as with one thread.
+ * Partial slices and unscaled special converters always use one thread.
+ *
+ * @param threads the number of threads, 1 disables threading
+ * @return 0 on success, a negative value if threads is out of range
+ */
+int sws_setThreads(struct SwsContext *context, int threads);
+
 /**
  * Scales the image slice in srcSlice and puts the resulting scaled
  * slice in the image in dst. A slice is a sequence of consecutive
@@ -33,6 +33,8 @@
 
 #define MAX_FILTER_SIZE 256
 
+#define MAX_SWS_THREADS 16
+
 #if ARCH_X86
 #define VOFW 5120
 #else
@@ -94,6 +96,10 @@ typedef struct SwsContext {
     int chrDstVSubSample;         ///< Binary logarithm of vertical   subsampling factor between luma/alpha and chroma planes in destination image.
     int vChrDrop;                 ///< Binary logarithm of extra vertical subsampling factor in source image chroma planes specified by user.
     int sliceDir;                 ///< Direction that slices are fed to the scaler (1 = top-to-bottom, -1 = bottom-to-top).
+    int threads;                  ///< Number of threads a whole frame may be split into by sws_scale().
+    struct SwsThreads *thr;       ///< Band threads, started by the first threaded sws_scale() call.
+    int bandStart;                ///< First destination line output by a band context.
+    int bandEnd;                  ///< Last destination line + 1 output by a band context, 0 for all lines.
     double param[2];              ///< Input parameters for scaling algorithms that need them.
 
     uint32_t pal_yuv[256];
@@ -466,4 +472,18 @@ int ff_hardcodedcpuflags(void);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Scales a whole frame by splitting the destination into horizontal bands
+ * which are scaled in parallel by c->threads threads.
+ * @return the height of the output, or a negative value if the frame
+ *         cannot be threaded and has to be scaled with c->swScale
+ */
+int ff_sws_scale_threaded(SwsContext *c, const uint8_t* src[], int srcStride[],
+                          uint8_t* dst[], int dstStride[]);
+
+/**
+ * Stops the band threads of c and frees their contexts.
+ */
+void ff_sws_free_threads(SwsContext *c);
+
 #endif /* SWSCALE_SWSCALE_INTERNAL_H */
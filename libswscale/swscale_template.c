@@ -146,6 +146,88 @@
         : "%"REG_a, "%"REG_d, "%"REG_S\
     );
 
+#if COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64
+/* Same as YSCALEYUV2YV12X for 16 pixels per loop, from start to end.
+ * The filter coefficients of the MMX filter are duplicated into the
+ * high half of the register. */
+#define YSCALEYUV2YV12X_SSE2(x, offset, dest, start, end) \
+    __asm__ volatile(\
+        "mov                                 %2, %%"REG_a"  \n\t"\
+        "movq             "VROUNDER_OFFSET"(%0), %%xmm3     \n\t"\
+        "punpcklqdq                      %%xmm3, %%xmm3     \n\t"\
+        "movdqa                          %%xmm3, %%xmm4     \n\t"\
+        "lea                     " offset "(%0), %%"REG_d"  \n\t"\
+        "mov                        (%%"REG_d"), %%"REG_S"  \n\t"\
+        ASMALIGN(4)\
+        "1:                                                 \n\t"\
+        "movq                      8(%%"REG_d"), %%xmm0     \n\t" /* filterCoeff */\
+        "punpcklqdq                      %%xmm0, %%xmm0     \n\t"\
+        "movdqu    "  x "(%%"REG_S", %%"REG_a", 2), %%xmm2  \n\t" /* srcData */\
+        "movdqu 16+"  x "(%%"REG_S", %%"REG_a", 2), %%xmm5  \n\t" /* srcData */\
+        "add                                $16, %%"REG_d"  \n\t"\
+        "mov                        (%%"REG_d"), %%"REG_S"  \n\t"\
+        "test                         %%"REG_S", %%"REG_S"  \n\t"\
+        "pmulhw                          %%xmm0, %%xmm2     \n\t"\
+        "pmulhw                          %%xmm0, %%xmm5     \n\t"\
+        "paddw                           %%xmm2, %%xmm3     \n\t"\
+        "paddw                           %%xmm5, %%xmm4     \n\t"\
+        " jnz                                1b             \n\t"\
+        "psraw                               $3, %%xmm3     \n\t"\
+        "psraw                               $3, %%xmm4     \n\t"\
+        "packuswb                        %%xmm4, %%xmm3     \n\t"\
+        "movdqu                          %%xmm3, (%1, %%"REG_a") \n\t"\
+        "add                                $16, %%"REG_a"  \n\t"\
+        "cmp                                 %3, %%"REG_a"  \n\t"\
+        "movq             "VROUNDER_OFFSET"(%0), %%xmm3     \n\t"\
+        "punpcklqdq                      %%xmm3, %%xmm3     \n\t"\
+        "movdqa                          %%xmm3, %%xmm4     \n\t"\
+        "lea                     " offset "(%0), %%"REG_d"  \n\t"\
+        "mov                        (%%"REG_d"), %%"REG_S"  \n\t"\
+        "jb                                  1b             \n\t"\
+        :: "r" (&c->redDither),\
+        "r" (dest), "g" ((x86_reg)(start)), "g" ((x86_reg)(end))\
+        : "memory", "%"REG_a, "%"REG_d, "%"REG_S,\
+          "%xmm0", "%xmm2", "%xmm3", "%xmm4", "%xmm5"\
+    );
+
+/* 8 pixel tail of YSCALEYUV2YV12X_SSE2, writes the same 8 bytes as MMX */
+#define YSCALEYUV2YV12X_SSE2_TAIL(x, offset, dest, start, end) \
+    __asm__ volatile(\
+        "mov                                 %2, %%"REG_a"  \n\t"\
+        "1:                                                 \n\t"\
+        "movq             "VROUNDER_OFFSET"(%0), %%xmm3     \n\t"\
+        "punpcklqdq                      %%xmm3, %%xmm3     \n\t"\
+        "lea                     " offset "(%0), %%"REG_d"  \n\t"\
+        "mov                        (%%"REG_d"), %%"REG_S"  \n\t"\
+        "2:                                                 \n\t"\
+        "movq                      8(%%"REG_d"), %%xmm0     \n\t" /* filterCoeff */\
+        "punpcklqdq                      %%xmm0, %%xmm0     \n\t"\
+        "movdqu    "  x "(%%"REG_S", %%"REG_a", 2), %%xmm2  \n\t" /* srcData */\
+        "add                                $16, %%"REG_d"  \n\t"\
+        "mov                        (%%"REG_d"), %%"REG_S"  \n\t"\
+        "test                         %%"REG_S", %%"REG_S"  \n\t"\
+        "pmulhw                          %%xmm0, %%xmm2     \n\t"\
+        "paddw                           %%xmm2, %%xmm3     \n\t"\
+        " jnz                                2b             \n\t"\
+        "psraw                               $3, %%xmm3     \n\t"\
+        "packuswb                        %%xmm3, %%xmm3     \n\t"\
+        "movq                            %%xmm3, (%1, %%"REG_a") \n\t"\
+        "add                                 $8, %%"REG_a"  \n\t"\
+        "cmp                                 %3, %%"REG_a"  \n\t"\
+        "jb                                  1b             \n\t"\
+        :: "r" (&c->redDither),\
+        "r" (dest), "g" ((x86_reg)(start)), "g" ((x86_reg)(end))\
+        : "memory", "%"REG_a, "%"REG_d, "%"REG_S,\
+          "%xmm0", "%xmm2", "%xmm3"\
+    );
+
+#define YSCALEYUV2YV12X_SSE2_LINE(x, offset, dest, width) \
+    if ((width) & ~15)\
+        YSCALEYUV2YV12X_SSE2(x, offset, dest, 0, (width) & ~15)\
+    if ((width) & 15)\
+        YSCALEYUV2YV12X_SSE2_TAIL(x, offset, dest, (width) & ~15, width)
+#endif /* COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64 */
+
 #define YSCALEYUV2YV121 \
     "mov %2, %%"REG_a"                    \n\t"\
     ASMALIGN(4) /* FIXME Unroll? */\
@@ -935,6 +1017,29 @@ static inline void RENAME(yuv2yuvX)(SwsContext *c, const int16_t *lumFilter, con
 #endif //!COMPILE_TEMPLATE_ALTIVEC
 }
 
+#if COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64
+/* SSE2 vertical scaler, only replaces the default (not accurate) MMX one */
+static inline void RENAME(yuv2yuvX_SSE2)(SwsContext *c, const int16_t *lumFilter, const int16_t **lumSrc, int lumFilterSize,
+                                         const int16_t *chrFilter, const int16_t **chrSrc, int chrFilterSize, const int16_t **alpSrc,
+                                         uint8_t *dest, uint8_t *uDest, uint8_t *vDest, uint8_t *aDest, long dstW, long chrDstW)
+{
+    if (c->flags & (SWS_BITEXACT | SWS_ACCURATE_RND)) {
+        RENAME(yuv2yuvX)(c, lumFilter, lumSrc, lumFilterSize, chrFilter, chrSrc, chrFilterSize,
+                         alpSrc, dest, uDest, vDest, aDest, dstW, chrDstW);
+        return;
+    }
+    if (uDest) {
+        YSCALEYUV2YV12X_SSE2_LINE(   "0", CHR_MMX_FILTER_OFFSET, uDest, chrDstW)
+        YSCALEYUV2YV12X_SSE2_LINE(AV_STRINGIFY(VOF), CHR_MMX_FILTER_OFFSET, vDest, chrDstW)
+    }
+    if (CONFIG_SWSCALE_ALPHA && aDest) {
+        YSCALEYUV2YV12X_SSE2_LINE(   "0", ALP_MMX_FILTER_OFFSET, aDest, dstW)
+    }
+
+    YSCALEYUV2YV12X_SSE2_LINE("0", LUM_MMX_FILTER_OFFSET, dest, dstW)
+}
+#endif /* COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64 */
+
 static inline void RENAME(yuv2nv12X)(SwsContext *c, const int16_t *lumFilter, const int16_t **lumSrc, int lumFilterSize,
                                      const int16_t *chrFilter, const int16_t **chrSrc, int chrFilterSize,
                                      uint8_t *dest, uint8_t *uDest, int dstW, int chrDstW, enum PixelFormat dstFormat)
@@ -2212,6 +2317,116 @@ static inline void RENAME(hScale)(int16_t *dst, int dstW, const uint8_t *src, in
 #endif /* COMPILE_MMX */
 }
 
+#if COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64
+/* SSE2 version of the 4 and 8 tap cases of hScale, 4 pixels per loop.
+ * The results are the same as the MMX ones. */
+static inline void RENAME(hScale_SSE2)(int16_t *dst, int dstW, const uint8_t *src, int srcW, int xInc,
+                                       const int16_t *filter, const int16_t *filterPos, long filterSize)
+{
+    x86_reg i= 0, pos;
+    x86_reg dstW4= dstW & ~3;
+
+    if ((filterSize != 4 && filterSize != 8) || !dstW4) {
+        RENAME(hScale)(dst, dstW, src, srcW, xInc, filter, filterPos, filterSize);
+        return;
+    }
+    if (filterSize==4) {
+        __asm__ volatile(
+            "pxor                %%xmm7, %%xmm7     \n\t"
+            ASMALIGN(4)
+            "1:                                     \n\t"
+            "movzwl     (%3, %0, 2), %k1            \n\t"
+            "movd          (%4, %1), %%xmm0         \n\t"
+            "movzwl    2(%3, %0, 2), %k1            \n\t"
+            "movd          (%4, %1), %%xmm1         \n\t"
+            "movzwl    4(%3, %0, 2), %k1            \n\t"
+            "movd          (%4, %1), %%xmm2         \n\t"
+            "movzwl    6(%3, %0, 2), %k1            \n\t"
+            "movd          (%4, %1), %%xmm3         \n\t"
+            "punpckldq           %%xmm1, %%xmm0     \n\t"
+            "punpckldq           %%xmm3, %%xmm2     \n\t"
+            "punpcklbw           %%xmm7, %%xmm0     \n\t"
+            "punpcklbw           %%xmm7, %%xmm2     \n\t"
+            "movdqu                (%2), %%xmm4     \n\t"
+            "movdqu              16(%2), %%xmm5     \n\t"
+            "pmaddwd             %%xmm4, %%xmm0     \n\t"
+            "pmaddwd             %%xmm5, %%xmm2     \n\t"
+            "movdqa              %%xmm0, %%xmm1     \n\t"
+            "shufps       $0x88, %%xmm2, %%xmm0     \n\t"
+            "shufps       $0xDD, %%xmm2, %%xmm1     \n\t"
+            "paddd               %%xmm1, %%xmm0     \n\t"
+            "psrad                   $7, %%xmm0     \n\t"
+            "packssdw            %%xmm0, %%xmm0     \n\t"
+            "movq                %%xmm0, (%5, %0, 2)\n\t"
+            "add                    $32, %2         \n\t"
+            "add                     $4, %0         \n\t"
+            "cmp                     %6, %0         \n\t"
+            " jb                     1b             \n\t"
+            : "+r" (i), "=&r" (pos), "+r" (filter)
+            : "r" (filterPos), "r" (src), "r" (dst), "r" (dstW4)
+            : "memory", "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7"
+        );
+    } else {
+        __asm__ volatile(
+            "pxor                %%xmm7, %%xmm7     \n\t"
+            ASMALIGN(4)
+            "1:                                     \n\t"
+            "movzwl     (%3, %0, 2), %k1            \n\t"
+            "movq          (%4, %1), %%xmm0         \n\t"
+            "movzwl    2(%3, %0, 2), %k1            \n\t"
+            "movq          (%4, %1), %%xmm1         \n\t"
+            "movzwl    4(%3, %0, 2), %k1            \n\t"
+            "movq          (%4, %1), %%xmm2         \n\t"
+            "movzwl    6(%3, %0, 2), %k1            \n\t"
+            "movq          (%4, %1), %%xmm3         \n\t"
+            "punpcklbw           %%xmm7, %%xmm0     \n\t"
+            "punpcklbw           %%xmm7, %%xmm1     \n\t"
+            "punpcklbw           %%xmm7, %%xmm2     \n\t"
+            "punpcklbw           %%xmm7, %%xmm3     \n\t"
+            "movdqu                (%2), %%xmm4     \n\t"
+            "movdqu              16(%2), %%xmm5     \n\t"
+            "pmaddwd             %%xmm4, %%xmm0     \n\t"
+            "pmaddwd             %%xmm5, %%xmm1     \n\t"
+            "movdqu              32(%2), %%xmm4     \n\t"
+            "movdqu              48(%2), %%xmm5     \n\t"
+            "pmaddwd             %%xmm4, %%xmm2     \n\t"
+            "pmaddwd             %%xmm5, %%xmm3     \n\t"
+            "movdqa              %%xmm0, %%xmm4     \n\t"
+            "punpckldq           %%xmm1, %%xmm0     \n\t"
+            "punpckhdq           %%xmm1, %%xmm4     \n\t"
+            "paddd               %%xmm4, %%xmm0     \n\t"
+            "movdqa              %%xmm2, %%xmm5     \n\t"
+            "punpckldq           %%xmm3, %%xmm2     \n\t"
+            "punpckhdq           %%xmm3, %%xmm5     \n\t"
+            "paddd               %%xmm5, %%xmm2     \n\t"
+            "movdqa              %%xmm0, %%xmm1     \n\t"
+            "punpcklqdq          %%xmm2, %%xmm0     \n\t"
+            "punpckhqdq          %%xmm2, %%xmm1     \n\t"
+            "paddd               %%xmm1, %%xmm0     \n\t"
+            "psrad                   $7, %%xmm0     \n\t"
+            "packssdw            %%xmm0, %%xmm0     \n\t"
+            "movq                %%xmm0, (%5, %0, 2)\n\t"
+            "add                    $64, %2         \n\t"
+            "add                     $4, %0         \n\t"
+            "cmp                     %6, %0         \n\t"
+            " jb                     1b             \n\t"
+            : "+r" (i), "=&r" (pos), "+r" (filter)
+            : "r" (filterPos), "r" (src), "r" (dst), "r" (dstW4)
+            : "memory", "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7"
+        );
+    }
+    for (; i<dstW; i++) {
+        int j;
+        int srcPos= filterPos[i];
+        int val=0;
+        for (j=0; j<filterSize; j++)
+            val += ((int)src[srcPos + j])*filter[j];
+        filter += filterSize;
+        dst[i] = av_clip_int16(val>>7);
+    }
+}
+#endif /* COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64 */
+
 //FIXME all pal and rgb srcFormats could do this convertion as well
 //FIXME all scalers more complex than bilinear could do half of this transform
 static void RENAME(chrRangeToJpeg)(uint16_t *dst, int width)
@@ -2587,6 +2802,7 @@ static int RENAME(swScale)(SwsContext *c, const uint8_t* src[], int srcStride[],
     uint8_t *formatConvBuffer= c->formatConvBuffer;
     const int chrSrcSliceY= srcSliceY >> c->chrSrcVSubSample;
     const int chrSrcSliceH= -((-srcSliceH) >> c->chrSrcVSubSample);
+    const int dstEnd= c->bandEnd ? c->bandEnd : dstH;
     int lastDstY;
     uint32_t *pal=c->pal_yuv;
 
@@ -2633,14 +2849,14 @@ static int RENAME(swScale)(SwsContext *c, const uint8_t* src[], int srcStride[],
     if (srcSliceY ==0) {
         lumBufIndex=-1;
         chrBufIndex=-1;
-        dstY=0;
+        dstY= c->bandStart;
         lastInLumBuf= -1;
         lastInChrBuf= -1;
     }
 
     lastDstY= dstY;
 
-    for (;dstY < dstH; dstY++) {
+    for (;dstY < dstEnd; dstY++) {
         unsigned char *dest =dst[0]+dstStride[0]*dstY;
         const int chrDstY= dstY>>c->chrDstVSubSample;
         unsigned char *uDest=dst[1]+dstStride[1]*chrDstY;
@@ -2929,6 +3145,12 @@ static void RENAME(sws_init_swScale)(SwsContext *c)
     c->yuv2packedX  = RENAME(yuv2packedX );
 
     c->hScale       = RENAME(hScale      );
+#if COMPILE_TEMPLATE_MMX2 && HAVE_SSE2 && ARCH_X86_64
+    if (c->flags & SWS_CPU_CAPS_SSE2) {
+        c->yuv2yuvX = RENAME(yuv2yuvX_SSE2);
+        c->hScale   = RENAME(hScale_SSE2  );
+    }
+#endif
 
 #if COMPILE_TEMPLATE_MMX
     // Use the new MMX scaler if the MMX2 one can't be used (it is faster than the x86 ASM one).
@@ -0,0 +1,326 @@
+/*
+ * Slice threading for the generic scaler
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The destination of a whole frame is split into horizontal bands. Every
+ * band is scaled from the complete source by a private copy of the context
+ * which has its own ring buffers of horizontally scaled lines and its own
+ * MMX filter state, so the output is identical to unthreaded scaling.
+ * The filter coefficients and the runtime generated code are shared.
+ */
+
+#include <string.h>
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#include "libavutil/avutil.h"
+#include "swscale.h"
+#include "swscale_internal.h"
+
+#if HAVE_PTHREADS
+
+/* bands smaller than this are not worth a thread */
+#define MIN_BAND_HEIGHT 16
+
+typedef struct SwsBand {
+    struct SwsThreads *t;
+    SwsContext *c;              ///< copy of the parent context, refreshed for each frame
+    int16_t **lumPixBuf;
+    int16_t **chrPixBuf;
+    int16_t **alpPixBuf;
+    int start, end;             ///< destination lines of the band
+    pthread_t thread;
+} SwsBand;
+
+typedef struct SwsThreads {
+    SwsContext *parent;
+    SwsBand band[MAX_SWS_THREADS];
+    int count;                  ///< number of bands, band 0 is scaled by the caller
+    int started;                ///< number of threads running
+
+    /* current frame */
+    const uint8_t **src;
+    int *srcStride;
+    uint8_t **dst;
+    int *dstStride;
+
+    int frame;                  ///< incremented to wake up the threads
+    int pending;                ///< bands of the current frame not done yet
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+} SwsThreads;
+
+static void scale_band(SwsBand *b)
+{
+    SwsThreads *t = b->t;
+    SwsContext *c = b->c;
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    // swScale() modifies the pointers and strides it gets
+    memcpy(src,       t->src,       sizeof(src));
+    memcpy(srcStride, t->srcStride, sizeof(srcStride));
+    memcpy(dst,       t->dst,       sizeof(dst));
+    memcpy(dstStride, t->dstStride, sizeof(dstStride));
+
+    // pick up palette and colorspace changes made to the parent
+    memcpy(c, t->parent, sizeof(SwsContext));
+    c->lumPixBuf = b->lumPixBuf;
+    c->chrPixBuf = b->chrPixBuf;
+    c->alpPixBuf = b->alpPixBuf;
+    c->bandStart = b->start;
+    c->bandEnd   = b->end;
+    c->threads   = 1;
+    c->thr       = NULL;
+
+    c->swScale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+}
+
+static void *band_thread(void *arg)
+{
+    SwsBand *b = arg;
+    SwsThreads *t = b->t;
+    int frame = 0;
+
+    pthread_mutex_lock(&t->lock);
+    while (1) {
+        while (t->frame == frame && !t->quit)
+            pthread_cond_wait(&t->work_cond, &t->lock);
+        if (t->quit)
+            break;
+        frame = t->frame;
+        pthread_mutex_unlock(&t->lock);
+
+        scale_band(b);
+
+        pthread_mutex_lock(&t->lock);
+        if (!--t->pending)
+            pthread_cond_signal(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static void free_pixbuf(int16_t ***buf, int size)
+{
+    int i;
+    if (!*buf)
+        return;
+    for (i = 0; i < size; i++)
+        av_freep(&(*buf)[i + size]);
+    av_freep(buf);
+}
+
+/* same layout as the ring buffers allocated by sws_getContext() */
+static int16_t **alloc_pixbuf(int size, int line_size, int fill)
+{
+    int16_t **buf = av_mallocz(size * 2 * sizeof(int16_t*));
+    int i;
+    if (!buf)
+        return NULL;
+    for (i = 0; i < size; i++) {
+        buf[i + size] = av_malloc(line_size);
+        if (!buf[i + size]) {
+            free_pixbuf(&buf, size);
+            return NULL;
+        }
+        memset(buf[i + size], fill, line_size);
+        buf[i] = buf[i + size];
+    }
+    return buf;
+}
+
+static void free_band(SwsBand *b, SwsContext *c)
+{
+    free_pixbuf(&b->lumPixBuf, c->vLumBufSize);
+    free_pixbuf(&b->chrPixBuf, c->vChrBufSize);
+    free_pixbuf(&b->alpPixBuf, c->vLumBufSize);
+    av_freep(&b->c);
+}
+
+static int init_band(SwsBand *b, SwsContext *c)
+{
+    b->c         = av_mallocz(sizeof(SwsContext));
+    b->lumPixBuf = alloc_pixbuf(c->vLumBufSize, VOF+1, 0);
+    b->chrPixBuf = alloc_pixbuf(c->vChrBufSize, (VOF+1)*2, 64);
+    if (c->alpPixBuf)
+        b->alpPixBuf = alloc_pixbuf(c->vLumBufSize, VOF+1, 0);
+    if (!b->c || !b->lumPixBuf || !b->chrPixBuf ||
+        (c->alpPixBuf && !b->alpPixBuf)) {
+        free_band(b, c);
+        return -1;
+    }
+    return 0;
+}
+
+static SwsThreads *init_threads(SwsContext *c)
+{
+    SwsThreads *t;
+    int count = FFMIN(c->threads, MAX_SWS_THREADS);
+    int align = 1 << c->chrDstVSubSample;
+    int i;
+
+    count = FFMIN(count, c->dstH / MIN_BAND_HEIGHT);
+    if (count < 2)
+        return NULL;
+
+    t = av_mallocz(sizeof(SwsThreads));
+    if (!t)
+        return NULL;
+    t->parent = c;
+    t->count  = count;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->work_cond, NULL);
+    pthread_cond_init(&t->done_cond, NULL);
+
+    // band boundaries are kept on chroma lines
+    for (i = 0; i < count; i++) {
+        SwsBand *b = &t->band[i];
+        b->t     = t;
+        b->start = (c->dstH *  i      / count) & ~(align - 1);
+        b->end   = (c->dstH * (i + 1) / count) & ~(align - 1);
+        if (i == count - 1)
+            b->end = c->dstH;
+        if (init_band(b, c) < 0)
+            goto fail;
+        if (i && pthread_create(&b->thread, NULL, band_thread, b)) {
+            free_band(b, c);
+            goto fail;
+        }
+        t->started = i;
+    }
+    return t;
+
+fail:
+    av_log(c, AV_LOG_WARNING, "Could not start %d scaler threads.\n", count);
+    c->thr = t;
+    ff_sws_free_threads(c);
+    return NULL;
+}
+
+/*
+ * The SIMD output functions write whole blocks of pixels and may go past
+ * the end of a line. Without padding this clobbers the first line of the
+ * next band, which could have been written already by another thread.
+ */
+static int strides_padded(SwsContext *c, int dstStride[])
+{
+    enum PixelFormat fmt = c->dstFormat;
+    int lumW = FFALIGN(c->dstW,    16);
+    int chrW = FFALIGN(c->chrDstW, 16);
+
+    if (fmt == PIX_FMT_NV12 || fmt == PIX_FMT_NV21)
+        return FFABS(dstStride[0]) >= lumW && FFABS(dstStride[1]) >= 2*chrW;
+    if (isPlanarYUV(fmt) || isGray(fmt)) {
+        int bytes = is16BPS(fmt) ? 2 : 1;
+        if (FFABS(dstStride[0]) < lumW*bytes)
+            return 0;
+        if (fmt == PIX_FMT_YUVA420P && FFABS(dstStride[3]) < lumW)
+            return 0;
+        return isGray(fmt) || (FFABS(dstStride[1]) >= chrW*bytes &&
+                               FFABS(dstStride[2]) >= chrW*bytes);
+    }
+    return FFABS(dstStride[0]) >= (lumW*c->dstFormatBpp + 7) >> 3;
+}
+
+int ff_sws_scale_threaded(SwsContext *c, const uint8_t* src[], int srcStride[],
+                          uint8_t* dst[], int dstStride[])
+{
+    SwsThreads *t = c->thr;
+
+    // only the generic scaler can output bands
+    if (!c->lumPixBuf || !strides_padded(c, dstStride))
+        return -1;
+    if (!t) {
+        t = c->thr = init_threads(c);
+        if (!t) {
+            c->threads = 1;
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&t->lock);
+    t->src       = src;
+    t->srcStride = srcStride;
+    t->dst       = dst;
+    t->dstStride = dstStride;
+    t->pending   = t->count - 1;
+    t->frame++;
+    pthread_cond_broadcast(&t->work_cond);
+    pthread_mutex_unlock(&t->lock);
+
+    scale_band(&t->band[0]);
+
+    pthread_mutex_lock(&t->lock);
+    while (t->pending)
+        pthread_cond_wait(&t->done_cond, &t->lock);
+    pthread_mutex_unlock(&t->lock);
+
+    return c->dstH;
+}
+
+void ff_sws_free_threads(SwsContext *c)
+{
+    SwsThreads *t = c->thr;
+    int i;
+
+    if (!t)
+        return;
+    pthread_mutex_lock(&t->lock);
+    t->quit = 1;
+    pthread_cond_broadcast(&t->work_cond);
+    pthread_mutex_unlock(&t->lock);
+    for (i = 1; i <= t->started; i++)
+        pthread_join(t->band[i].thread, NULL);
+    for (i = 0; i <= t->started; i++)
+        free_band(&t->band[i], c);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->work_cond);
+    pthread_cond_destroy(&t->done_cond);
+    av_freep(&c->thr);
+}
+
+#else /* HAVE_PTHREADS */
+
+int ff_sws_scale_threaded(SwsContext *c, const uint8_t* src[], int srcStride[],
+                          uint8_t* dst[], int dstStride[])
+{
+    return -1;
+}
+
+void ff_sws_free_threads(SwsContext *c)
+{
+}
+
+#endif /* HAVE_PTHREADS */
+
+int sws_setThreads(SwsContext *c, int threads)
+{
+    if (threads < 1 || threads > MAX_SWS_THREADS)
+        return -1;
+    if (threads != c->threads)
+        ff_sws_free_threads(c);
+    c->threads = threads;
+    return 0;
+}
@@ -1111,7 +1111,9 @@ SwsContext *sws_getContext(int srcW, int srcH, enum PixelFormat srcFormat,
 #endif
                sws_format_name(dstFormat));
 
-        if (flags & SWS_CPU_CAPS_MMX2)
+        if ((flags & SWS_CPU_CAPS_MMX2) && (flags & SWS_CPU_CAPS_SSE2) && HAVE_SSE2 && ARCH_X86_64)
+            av_log(c, AV_LOG_INFO, "using MMX2 and SSE2\n");
+        else if (flags & SWS_CPU_CAPS_MMX2)
             av_log(c, AV_LOG_INFO, "using MMX2\n");
         else if (flags & SWS_CPU_CAPS_3DNOW)
             av_log(c, AV_LOG_INFO, "using 3DNOW\n");
@@ -1496,6 +1498,8 @@ void sws_freeContext(SwsContext *c)
     int i;
     if (!c) return;
 
+    ff_sws_free_threads(c);
+
     if (c->lumPixBuf) {
         for (i=0; i<c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
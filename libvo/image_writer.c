@@ -0,0 +1,296 @@
+/*
+ * Pool of threads compressing and writing image files for the image
+ * sequence video outputs.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "mp_msg.h"
+#include "help_mp.h"
+#include "libavutil/common.h"
+#include "osdep/timer.h"
+#include "image_writer.h"
+
+enum { JOB_FREE, JOB_QUEUED, JOB_RUNNING };
+
+struct job {
+    int state;
+    unsigned seq;           // images are picked up in the order they came
+    char *filename;
+    uint8_t *data;
+    int size;
+    int stride, w, h;
+};
+
+struct worker {
+    struct image_writer *wr;
+    void *ctx;
+#if HAVE_PTHREADS
+    pthread_t thread;
+#endif
+};
+
+struct image_writer {
+    int threads, queue;
+    image_write_func write;
+    struct worker *workers;
+    struct job *jobs;
+    unsigned seq;
+    int pending;            // jobs queued or running
+    int failed;
+    int quit;
+    // statistics, times in microseconds
+    int images;
+    double time_total;
+    unsigned time_max;
+    double time_waited;     // put() blocked on a full queue
+#if HAVE_PTHREADS
+    pthread_mutex_t lock;
+    pthread_cond_t wake_worker;
+    pthread_cond_t wake_main;
+#endif
+};
+
+// Called with the lock held if there are threads.
+static void account(struct image_writer *wr, const char *filename,
+                    unsigned t, int ok)
+{
+    wr->images++;
+    wr->time_total += t;
+    if (t > wr->time_max)
+        wr->time_max = t;
+    if (!ok)
+        wr->failed = 1;
+    mp_msg(MSGT_VO, MSGL_DBG2, "%s written in %.1f ms\n", filename, t / 1000.0);
+}
+
+#if HAVE_PTHREADS
+static void *writer_thread(void *arg)
+{
+    struct worker *w = arg;
+    struct image_writer *wr = w->wr;
+
+    pthread_mutex_lock(&wr->lock);
+    while (1) {
+        struct job *job = NULL;
+        unsigned t;
+        int i, ok;
+
+        for (i = 0; i < wr->queue; i++)
+            if (wr->jobs[i].state == JOB_QUEUED &&
+                (!job || (int)(wr->jobs[i].seq - job->seq) < 0))
+                job = &wr->jobs[i];
+        if (!job) {
+            if (wr->quit)
+                break;
+            pthread_cond_wait(&wr->wake_worker, &wr->lock);
+            continue;
+        }
+        job->state = JOB_RUNNING;
+        pthread_mutex_unlock(&wr->lock);
+
+        t = GetTimer();
+        ok = !wr->write(w->ctx, job->filename, job->data, job->stride,
+                        job->w, job->h);
+        t = GetTimer() - t;
+
+        pthread_mutex_lock(&wr->lock);
+        account(wr, job->filename, t, ok);
+        job->state = JOB_FREE;
+        wr->pending--;
+        pthread_cond_broadcast(&wr->wake_main);
+    }
+    pthread_mutex_unlock(&wr->lock);
+    return NULL;
+}
+#endif
+
+struct image_writer *image_writer_new(int threads, int queue,
+                                      image_write_func write, void **ctx)
+{
+    struct image_writer *wr = calloc(1, sizeof(struct image_writer));
+    int i;
+
+    if (!wr)
+        return NULL;
+#if !HAVE_PTHREADS
+    threads = 1;
+#endif
+    wr->threads = threads;
+    wr->queue = threads > 1 ? FFMAX(queue, threads) : 0;
+    wr->write = write;
+    wr->workers = calloc(threads, sizeof(struct worker));
+    wr->jobs = calloc(wr->queue, sizeof(struct job));
+    if (!wr->workers || (wr->queue && !wr->jobs)) {
+        free(wr->workers);
+        free(wr->jobs);
+        free(wr);
+        return NULL;
+    }
+    for (i = 0; i < threads; i++) {
+        wr->workers[i].wr = wr;
+        wr->workers[i].ctx = ctx[i];
+    }
+#if HAVE_PTHREADS
+    if (threads > 1) {
+        pthread_mutex_init(&wr->lock, NULL);
+        pthread_cond_init(&wr->wake_worker, NULL);
+        pthread_cond_init(&wr->wake_main, NULL);
+        for (i = 0; i < threads; i++)
+            if (pthread_create(&wr->workers[i].thread, NULL, writer_thread,
+                               &wr->workers[i]))
+                break;
+        if (i < threads) {
+            // write with the threads we got
+            mp_msg(MSGT_VO, MSGL_WARN, "Could only start %d of %d image "
+                   "writer threads.\n", i, threads);
+            if (!i) {
+                pthread_mutex_destroy(&wr->lock);
+                pthread_cond_destroy(&wr->wake_worker);
+                pthread_cond_destroy(&wr->wake_main);
+                wr->queue = 0;
+                i = 1;
+            }
+            wr->threads = i;
+        }
+    }
+#endif
+    return wr;
+}
+
+#if HAVE_PTHREADS
+static int queue_image(struct image_writer *wr, const char *filename,
+                       uint8_t *data, int stride, int w, int h, int bpp)
+{
+    struct job *job = NULL;
+    unsigned t = GetTimer();
+    int i, ok, size = w * bpp * h;
+
+    pthread_mutex_lock(&wr->lock);
+    while (1) {
+        for (i = 0; i < wr->queue && !job; i++)
+            if (wr->jobs[i].state == JOB_FREE)
+                job = &wr->jobs[i];
+        if (job)
+            break;
+        pthread_cond_wait(&wr->wake_main, &wr->lock);
+    }
+    pthread_mutex_unlock(&wr->lock);
+    wr->time_waited += GetTimer() - t;
+
+    // the job is ours until it is queued
+    free(job->filename);
+    job->filename = strdup(filename);
+    if (job->size < size) {
+        free(job->data);
+        job->data = malloc(size);
+        job->size = job->data ? size : 0;
+    }
+    if (!job->filename || !job->data) {
+        pthread_mutex_lock(&wr->lock);
+        wr->failed = 1;
+        pthread_mutex_unlock(&wr->lock);
+        return 0;
+    }
+    for (i = 0; i < h; i++)
+        memcpy(job->data + i * w * bpp, data + i * stride, w * bpp);
+    job->stride = w * bpp;
+    job->w = w;
+    job->h = h;
+
+    pthread_mutex_lock(&wr->lock);
+    job->seq = wr->seq++;
+    job->state = JOB_QUEUED;
+    wr->pending++;
+    pthread_cond_signal(&wr->wake_worker);
+    ok = !wr->failed;
+    pthread_mutex_unlock(&wr->lock);
+    return ok;
+}
+#endif
+
+int image_writer_put(struct image_writer *wr, const char *filename,
+                     uint8_t *data, int stride, int w, int h, int bpp)
+{
+    unsigned t;
+    int ok;
+
+#if HAVE_PTHREADS
+    if (wr->queue)
+        return queue_image(wr, filename, data, stride, w, h, bpp);
+#endif
+    t = GetTimer();
+    ok = !wr->write(wr->workers[0].ctx, filename, data, stride, w, h);
+    account(wr, filename, GetTimer() - t, ok);
+    return !wr->failed;
+}
+
+int image_writer_flush(struct image_writer *wr)
+{
+#if HAVE_PTHREADS
+    if (wr->queue) {
+        int ok;
+        pthread_mutex_lock(&wr->lock);
+        while (wr->pending)
+            pthread_cond_wait(&wr->wake_main, &wr->lock);
+        ok = !wr->failed;
+        pthread_mutex_unlock(&wr->lock);
+        return ok;
+    }
+#endif
+    return !wr->failed;
+}
+
+void image_writer_free(struct image_writer *wr, const char *name)
+{
+    if (!wr)
+        return;
+    image_writer_flush(wr);
+#if HAVE_PTHREADS
+    if (wr->queue) {
+        int i;
+        pthread_mutex_lock(&wr->lock);
+        wr->quit = 1;
+        pthread_cond_broadcast(&wr->wake_worker);
+        pthread_mutex_unlock(&wr->lock);
+        for (i = 0; i < wr->threads; i++)
+            pthread_join(wr->workers[i].thread, NULL);
+        for (i = 0; i < wr->queue; i++) {
+            free(wr->jobs[i].filename);
+            free(wr->jobs[i].data);
+        }
+        pthread_mutex_destroy(&wr->lock);
+        pthread_cond_destroy(&wr->wake_worker);
+        pthread_cond_destroy(&wr->wake_main);
+    }
+#endif
+    if (wr->images)
+        mp_msg(MSGT_VO, MSGL_INFO, MSGTR_VO_ImageWriterStats, name, wr->images,
+               wr->threads, wr->time_total / wr->images / 1000.0,
+               wr->time_max / 1000.0, wr->time_waited / 1000000.0);
+    free(wr->workers);
+    free(wr->jobs);
+    free(wr);
+}
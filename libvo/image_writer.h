@@ -0,0 +1,58 @@
+/*
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_IMAGE_WRITER_H
+#define MPLAYER_IMAGE_WRITER_H
+
+#include <stdint.h>
+
+struct image_writer;
+
+/**
+ * \brief compress and write one image file
+ * \param ctx the context of the thread, see image_writer_new()
+ * \return 0 on success
+ */
+typedef int (*image_write_func)(void *ctx, const char *filename,
+                                uint8_t *data, int stride, int w, int h);
+
+/**
+ * \brief create a pool of threads that write image files
+ * \param threads number of threads, with 1 images are written by
+ *                image_writer_put() itself
+ * \param queue maximum number of images waiting or being written
+ * \param ctx array of threads contexts, e.g. one encoder each
+ */
+struct image_writer *image_writer_new(int threads, int queue,
+                                      image_write_func write, void **ctx);
+
+/**
+ * \brief write an image, the data is copied if it is written by a thread
+ * \param bpp bytes per pixel
+ * \return 0 if writing this or an earlier image failed
+ */
+int image_writer_put(struct image_writer *wr, const char *filename,
+                     uint8_t *data, int stride, int w, int h, int bpp);
+
+/// Wait until all images have been written, returns 0 if one failed.
+int image_writer_flush(struct image_writer *wr);
+
+/// Flush, stop the threads and print the timing statistics.
+void image_writer_free(struct image_writer *wr, const char *name);
+
+#endif /* MPLAYER_IMAGE_WRITER_H */
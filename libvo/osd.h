@@ -22,6 +22,14 @@
 #ifndef MPLAYER_OSD_H
 #define MPLAYER_OSD_H
 
+// max number of dirty rectangles a single alpha bitmap is split into;
+// some VOs (gl, vdpau) create one texture/surface per draw_alpha call
+#define VO_ALPHA_MAX_RECTS 3
+
+typedef struct vo_alpha_rect_s {
+    int x, y, w, h; // relative to the bitmap origin
+} vo_alpha_rect_t;
+
 void vo_draw_alpha_init(void); // build tables
 
 void vo_draw_alpha_yv12(int w,  int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase, int dststride);
@@ -34,4 +42,10 @@ void vo_draw_alpha_rgb12(int w, int h, unsigned char* src, unsigned char *srca,
 void vo_draw_alpha_rgb15(int w, int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase, int dststride);
 void vo_draw_alpha_rgb16(int w, int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase, int dststride);
 
+int vo_alpha_find_rects(int w, int h, unsigned char *srca, int stride,
+                        vo_alpha_rect_t *rects, int max_rects);
+void vo_draw_alpha_rects(int x0, int y0, unsigned char *src, unsigned char *srca,
+                         int stride, const vo_alpha_rect_t *rects, int num_rects,
+                         void (*draw_alpha)(int x0, int y0, int w, int h, unsigned char* src, unsigned char *srca, int stride));
+
 #endif /* MPLAYER_OSD_H */
@@ -49,7 +49,7 @@ static inline void RENAME(vo_draw_alpha_yv12)(int w,int h, unsigned char* src, u
 #if defined(FAST_OSD) && !HAVE_MMX
     w=w>>1;
 #endif
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
     __asm__ volatile(
         "pcmpeqb %%mm5, %%mm5\n\t" // F..F
         "movq %%mm5, %%mm4\n\t"
@@ -60,7 +60,50 @@ static inline void RENAME(vo_draw_alpha_yv12)(int w,int h, unsigned char* src, u
 #endif
     for(y=0;y<h;y++){
         register int x;
-#if HAVE_MMX
+#if HAVE_SSE2
+        x86_reg xo = -(w&~15);
+	__asm__ volatile(
+		"pxor %%xmm7, %%xmm7\n\t"
+		"test %0, %0\n\t"
+		" jz 2f\n\t"
+		"1:\n\t"
+		"movdqu	(%2,%0), %%xmm2\n\t"	//srca
+		"movdqa %%xmm2, %%xmm3\n\t"
+		"pcmpeqb %%xmm7, %%xmm3\n\t"	//srca==0
+		"pmovmskb %%xmm3, %%eax\n\t"
+		"cmpl $0xFFFF, %%eax\n\t"
+		" je 3f\n\t"
+		"movdqu	(%1,%0), %%xmm0\n\t"	//dstbase
+		"movdqa %%xmm0, %%xmm1\n\t"
+		"movdqa %%xmm0, %%xmm5\n\t"
+		"movdqa %%xmm2, %%xmm4\n\t"
+		"punpcklbw %%xmm7, %%xmm0\n\t"	//0Y0Y0Y0Y
+		"punpckhbw %%xmm7, %%xmm1\n\t"
+		"punpcklbw %%xmm7, %%xmm2\n\t"	//0A0A0A0A
+		"punpckhbw %%xmm7, %%xmm4\n\t"
+		"pmullw	%%xmm2, %%xmm0\n\t"
+		"pmullw	%%xmm4, %%xmm1\n\t"
+		"psrlw	$8, %%xmm0\n\t"
+		"psrlw	$8, %%xmm1\n\t"
+		"packuswb %%xmm1, %%xmm0\n\t"
+		"movdqu	(%3,%0), %%xmm1\n\t"	//src
+		"paddb	%%xmm1, %%xmm0\n\t"
+		"pand %%xmm3, %%xmm5\n\t"		//keep dst where srca==0
+		"pandn %%xmm0, %%xmm3\n\t"
+		"por %%xmm5, %%xmm3\n\t"
+		"movdqu	%%xmm3, (%1,%0)\n\t"
+		"3:\n\t"
+		"add $16, %0\n\t"
+		" jl 1b\n\t"
+		"2:\n\t"
+		: "+r" (xo)
+		: "r" (dstbase+(w&~15)), "r" (srca+(w&~15)), "r" (src+(w&~15))
+		: "%eax", "memory",
+		  "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7");
+        for(x=w&~15;x<w;x++){
+            if(srca[x]) dstbase[x]=((dstbase[x]*srca[x])>>8)+src[x];
+        }
+#elif HAVE_MMX
     __asm__ volatile(
 	PREFETCHW" %0\n\t"
 	PREFETCH" %1\n\t"
@@ -108,7 +151,7 @@ static inline void RENAME(vo_draw_alpha_yv12)(int w,int h, unsigned char* src, u
         srca+=srcstride;
         dstbase+=dststride;
     }
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
 	__asm__ volatile(EMMS:::"memory");
 #endif
     return;
@@ -119,7 +162,7 @@ static inline void RENAME(vo_draw_alpha_yuy2)(int w,int h, unsigned char* src, u
 #if defined(FAST_OSD) && !HAVE_MMX
     w=w>>1;
 #endif
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
     __asm__ volatile(
         "pxor %%mm7, %%mm7\n\t"
         "pcmpeqb %%mm5, %%mm5\n\t" // F..F
@@ -131,7 +174,62 @@ static inline void RENAME(vo_draw_alpha_yuy2)(int w,int h, unsigned char* src, u
 #endif
     for(y=0;y<h;y++){
         register int x;
-#if HAVE_MMX
+#if HAVE_SSE2
+        x86_reg xo = -(w&~7);
+	__asm__ volatile(
+		"pxor %%xmm7, %%xmm7\n\t"
+		"pcmpeqw %%xmm6, %%xmm6\n\t"
+		"psrlw $8, %%xmm6\n\t"		//00FF00FF00FF
+		"movdqa %%xmm6, %%xmm5\n\t"
+		"psrlw $7, %%xmm5\n\t"
+		"psllw $7, %%xmm5\n\t"		//0080008000800080
+		"test %0, %0\n\t"
+		" jz 2f\n\t"
+		"1:\n\t"
+		"movq	(%2,%0), %%xmm2\n\t"	//srca
+		"movdqa %%xmm2, %%xmm3\n\t"
+		"pcmpeqb %%xmm7, %%xmm3\n\t"	//srca==0
+		"pmovmskb %%xmm3, %%eax\n\t"
+		"cmpl $0xFFFF, %%eax\n\t"
+		" je 3f\n\t"
+		"punpcklbw %%xmm7, %%xmm2\n\t"	//0A0A0A0A
+		"punpcklbw %%xmm3, %%xmm3\n\t"
+		"movdqu	(%1,%0,2), %%xmm0\n\t"	//dstbase
+		"movdqa %%xmm0, %%xmm1\n\t"
+		"movdqa %%xmm0, %%xmm4\n\t"
+		"pand %%xmm6, %%xmm0\n\t"		//0Y0Y0Y0Y
+		"psrlw $8, %%xmm1\n\t"		//0U0V0U0V
+		"pmullw	%%xmm2, %%xmm0\n\t"
+		"psrlw	$8, %%xmm0\n\t"
+		"psubw	%%xmm5, %%xmm1\n\t"
+		"pmullw	%%xmm2, %%xmm1\n\t"
+		"psraw	$8, %%xmm1\n\t"
+		"paddw	%%xmm5, %%xmm1\n\t"
+		"psllw	$8, %%xmm1\n\t"		//U0V0U0V0
+		"movq	(%3,%0), %%xmm2\n\t"	//src
+		"punpcklbw %%xmm7, %%xmm2\n\t"
+		"paddw	%%xmm2, %%xmm0\n\t"
+		"pand %%xmm6, %%xmm0\n\t"
+		"por %%xmm1, %%xmm0\n\t"
+		"pand %%xmm3, %%xmm4\n\t"		//keep dst where srca==0
+		"pandn %%xmm0, %%xmm3\n\t"
+		"por %%xmm4, %%xmm3\n\t"
+		"movdqu	%%xmm3, (%1,%0,2)\n\t"
+		"3:\n\t"
+		"add $8, %0\n\t"
+		" jl 1b\n\t"
+		"2:\n\t"
+		: "+r" (xo)
+		: "r" (dstbase+2*(w&~7)), "r" (srca+(w&~7)), "r" (src+(w&~7))
+		: "%eax", "memory",
+		  "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7");
+        for(x=w&~7;x<w;x++){
+            if(srca[x]) {
+               dstbase[2*x]=((dstbase[2*x]*srca[x])>>8)+src[x];
+               dstbase[2*x+1]=((((signed)dstbase[2*x+1]-128)*srca[x])>>8)+128;
+            }
+        }
+#elif HAVE_MMX
     __asm__ volatile(
 	PREFETCHW" %0\n\t"
 	PREFETCH" %1\n\t"
@@ -180,7 +278,7 @@ static inline void RENAME(vo_draw_alpha_yuy2)(int w,int h, unsigned char* src, u
         srca+=srcstride;
         dstbase+=dststride;
     }
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
 	__asm__ volatile(EMMS:::"memory");
 #endif
     return;
@@ -193,7 +291,58 @@ static inline void RENAME(vo_draw_alpha_uyvy)(int w,int h, unsigned char* src, u
 #endif
   for(y=0;y<h;y++){
     register int x;
+#if HAVE_SSE2 && !defined(FAST_OSD)
+    x86_reg xo = -(w&~7);
+    __asm__ volatile(
+	"pxor %%xmm7, %%xmm7\n\t"
+	"pcmpeqw %%xmm6, %%xmm6\n\t"
+	"psrlw $8, %%xmm6\n\t"		//00FF00FF00FF
+	"movdqa %%xmm6, %%xmm5\n\t"
+	"psrlw $7, %%xmm5\n\t"
+	"psllw $7, %%xmm5\n\t"		//0080008000800080
+	"test %0, %0\n\t"
+	" jz 2f\n\t"
+	"1:\n\t"
+	"movq	(%2,%0), %%xmm2\n\t"	//srca
+	"movdqa %%xmm2, %%xmm3\n\t"
+	"pcmpeqb %%xmm7, %%xmm3\n\t"	//srca==0
+	"pmovmskb %%xmm3, %%eax\n\t"
+	"cmpl $0xFFFF, %%eax\n\t"
+	" je 3f\n\t"
+	"punpcklbw %%xmm7, %%xmm2\n\t"	//0A0A0A0A
+	"punpcklbw %%xmm3, %%xmm3\n\t"
+	"movdqu	(%1,%0,2), %%xmm0\n\t"	//dstbase
+	"movdqa %%xmm0, %%xmm1\n\t"
+	"movdqa %%xmm0, %%xmm4\n\t"
+	"psrlw $8, %%xmm0\n\t"		//0Y0Y0Y0Y
+	"pand %%xmm6, %%xmm1\n\t"		//0U0V0U0V
+	"pmullw	%%xmm2, %%xmm0\n\t"
+	"psrlw	$8, %%xmm0\n\t"
+	"psubw	%%xmm5, %%xmm1\n\t"
+	"pmullw	%%xmm2, %%xmm1\n\t"
+	"psraw	$8, %%xmm1\n\t"
+	"paddw	%%xmm5, %%xmm1\n\t"
+	"movq	(%3,%0), %%xmm2\n\t"	//src
+	"punpcklbw %%xmm7, %%xmm2\n\t"
+	"paddw	%%xmm2, %%xmm0\n\t"
+	"psllw	$8, %%xmm0\n\t"		//Y0Y0Y0Y0
+	"por %%xmm1, %%xmm0\n\t"
+	"pand %%xmm3, %%xmm4\n\t"		//keep dst where srca==0
+	"pandn %%xmm0, %%xmm3\n\t"
+	"por %%xmm4, %%xmm3\n\t"
+	"movdqu	%%xmm3, (%1,%0,2)\n\t"
+	"3:\n\t"
+	"add $8, %0\n\t"
+	" jl 1b\n\t"
+	"2:\n\t"
+	: "+r" (xo)
+	: "r" (dstbase+2*(w&~7)), "r" (srca+(w&~7)), "r" (src+(w&~7))
+	: "%eax", "memory",
+	  "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7");
+    for(x=w&~7;x<w;x++){
+#else
     for(x=0;x<w;x++){
+#endif
 #ifdef FAST_OSD
       if(srca[2*x+0]) dstbase[4*x+2]=src[2*x+0];
       if(srca[2*x+1]) dstbase[4*x+0]=src[2*x+1];
@@ -323,7 +472,7 @@ static inline void RENAME(vo_draw_alpha_rgb32)(int w,int h, unsigned char* src,
 #if HAVE_BIGENDIAN
     dstbase++;
 #endif
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
 #if HAVE_AMD3DNOW
     __asm__ volatile(
         "pxor %%mm7, %%mm7\n\t"
@@ -342,7 +491,61 @@ static inline void RENAME(vo_draw_alpha_rgb32)(int w,int h, unsigned char* src,
     for(y=0;y<h;y++){
         register int x;
 #if ARCH_X86 && (!ARCH_X86_64 || HAVE_MMX)
-#if HAVE_MMX
+#if HAVE_SSE2
+        x86_reg xo = -(w&~3);
+	__asm__ volatile(
+		"pxor %%xmm7, %%xmm7\n\t"
+		"pcmpeqd %%xmm6, %%xmm6\n\t"
+		"pslld $24, %%xmm6\n\t"		//FF000000FF000000
+		"test %0, %0\n\t"
+		" jz 2f\n\t"
+		"1:\n\t"
+		"movl	(%2,%0), %%eax\n\t"	//srca DCBA
+		"testl %%eax, %%eax\n\t"
+		" jz 3f\n\t"
+		"movd	%%eax, %%xmm2\n\t"
+		"punpcklbw %%xmm2, %%xmm2\n\t"	//srca DDCCBBAA
+		"punpcklwd %%xmm2, %%xmm2\n\t"	//srca DDDDCCCCBBBBAAAA
+		"movdqa %%xmm2, %%xmm3\n\t"
+		"pcmpeqb %%xmm7, %%xmm3\n\t"	//srca==0
+		"por %%xmm6, %%xmm3\n\t"		//never touch the 4th byte
+		"movdqu	(%1,%0,4), %%xmm0\n\t"	//dstbase
+		"movdqa %%xmm0, %%xmm1\n\t"
+		"movdqa %%xmm0, %%xmm5\n\t"
+		"movdqa %%xmm2, %%xmm4\n\t"
+		"punpcklbw %%xmm7, %%xmm0\n\t"
+		"punpckhbw %%xmm7, %%xmm1\n\t"
+		"punpcklbw %%xmm7, %%xmm2\n\t"
+		"punpckhbw %%xmm7, %%xmm4\n\t"
+		"pmullw	%%xmm2, %%xmm0\n\t"
+		"pmullw	%%xmm4, %%xmm1\n\t"
+		"psrlw	$8, %%xmm0\n\t"
+		"psrlw	$8, %%xmm1\n\t"
+		"packuswb %%xmm1, %%xmm0\n\t"
+		"movd	(%3,%0), %%xmm1\n\t"	//src DCBA
+		"punpcklbw %%xmm1, %%xmm1\n\t"
+		"punpcklwd %%xmm1, %%xmm1\n\t"	//src DDDDCCCCBBBBAAAA
+		"paddb	%%xmm1, %%xmm0\n\t"
+		"pand %%xmm3, %%xmm5\n\t"
+		"pandn %%xmm0, %%xmm3\n\t"
+		"por %%xmm5, %%xmm3\n\t"
+		"movdqu	%%xmm3, (%1,%0,4)\n\t"
+		"3:\n\t"
+		"add $4, %0\n\t"
+		" jl 1b\n\t"
+		"2:\n\t"
+		: "+r" (xo)
+		: "r" (dstbase+4*(w&~3)), "r" (srca+(w&~3)), "r" (src+(w&~3))
+		: "%eax", "memory",
+		  "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7");
+        for(x=w&~3;x<w;x++){
+            if(srca[x]){
+		dstbase[4*x+0]=((dstbase[4*x+0]*srca[x])>>8)+src[x];
+		dstbase[4*x+1]=((dstbase[4*x+1]*srca[x])>>8)+src[x];
+		dstbase[4*x+2]=((dstbase[4*x+2]*srca[x])>>8)+src[x];
+            }
+        }
+#elif HAVE_MMX
 #if HAVE_AMD3DNOW
     __asm__ volatile(
 	PREFETCHW" %0\n\t"
@@ -477,7 +680,7 @@ static inline void RENAME(vo_draw_alpha_rgb32)(int w,int h, unsigned char* src,
         srca+=srcstride;
         dstbase+=dststride;
     }
-#if HAVE_MMX
+#if HAVE_MMX && !HAVE_SSE2
 	__asm__ volatile(EMMS:::"memory");
 #endif
     return;
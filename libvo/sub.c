@@ -164,15 +164,19 @@ static void alloc_buf(mp_osd_obj_t* obj)
     memset(obj->alpha_buffer, sub_bg_alpha, len);
 }
 
-// renders the buffer
+// renders the buffer, skipping its fully transparent parts
 inline static void vo_draw_text_from_buffer(mp_osd_obj_t* obj,void (*draw_alpha)(int x0,int y0, int w,int h, unsigned char* src, unsigned char *srca, int stride)){
     if (obj->allocated > 0) {
-	draw_alpha(obj->bbox.x1,obj->bbox.y1,
-		   obj->bbox.x2-obj->bbox.x1,
-		   obj->bbox.y2-obj->bbox.y1,
-		   obj->bitmap_buffer,
-		   obj->alpha_buffer,
-		   obj->stride);
+	if (obj->num_rects < 0)
+	    obj->num_rects = vo_alpha_find_rects(obj->bbox.x2-obj->bbox.x1,
+						 obj->bbox.y2-obj->bbox.y1,
+						 obj->alpha_buffer, obj->stride,
+						 obj->rects, VO_ALPHA_MAX_RECTS);
+	vo_draw_alpha_rects(obj->bbox.x1,obj->bbox.y1,
+			    obj->bitmap_buffer,
+			    obj->alpha_buffer,
+			    obj->stride,
+			    obj->rects, obj->num_rects, draw_alpha);
     }
 }
 
@@ -1060,8 +1064,6 @@ void *vo_vobsub=NULL;
 
 static int draw_alpha_init_flag=0;
 
-void vo_draw_alpha_init(void);
-
        mp_osd_obj_t* vo_osd_list=NULL;
 
 static mp_osd_obj_t* new_osd_obj(int type){
@@ -1073,6 +1075,7 @@ static mp_osd_obj_t* new_osd_obj(int type){
     osd->alpha_buffer = NULL;
     osd->bitmap_buffer = NULL;
     osd->allocated = -1;
+    osd->num_rects = -1;
     return osd;
 }
 
@@ -1145,6 +1148,7 @@ static int vo_update_osd_ext(int dxs,int dys, int left_border, int top_border,
       if(dxs!=obj->dxs || dys!=obj->dys || obj->flags&OSDFLAG_FORCE_UPDATE){
         int vis=obj->flags&OSDFLAG_VISIBLE;
 	obj->flags&=~OSDFLAG_BBOX;
+	obj->num_rects=-1;
 	switch(obj->type){
 #ifdef CONFIG_DVDNAV
         case OSDTYPE_DVDNAV:
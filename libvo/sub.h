@@ -19,6 +19,8 @@
 #ifndef MPLAYER_SUB_H
 #define MPLAYER_SUB_H
 
+#include "osd.h"
+
 typedef struct mp_osd_bbox_s {
     int x1,y1,x2,y2;
 } mp_osd_bbox_t;
@@ -64,6 +66,8 @@ typedef struct mp_osd_obj_s {
     int allocated;
     unsigned char *alpha_buffer;
     unsigned char *bitmap_buffer;
+    int num_rects; // -1 if rects must be recomputed from alpha_buffer
+    vo_alpha_rect_t rects[VO_ALPHA_MAX_RECTS];
 } mp_osd_obj_t;
 
 
@@ -121,6 +125,7 @@ extern int sub_bg_alpha;
 extern int spu_alignment;
 extern int spu_aamode;
 extern float spu_gaussvar;
+extern int spu_aa_threads;
 
 void vo_draw_text(int dxs,int dys,void (*draw_alpha)(int x0,int y0, int w,int h, unsigned char* src, unsigned char *srca, int stride));
 void vo_draw_text_ext(int dxs, int dys, int left_border, int top_border,
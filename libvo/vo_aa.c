@@ -119,7 +119,7 @@ resize(void){
     screen_x = (aa_scrwidth(c) - screen_w) / 2;
     screen_y = (aa_scrheight(c) - screen_h) / 2;
 
-    if(sws) sws_freeContext(sws);
+    sws_releaseContext(sws);
     sws = sws_getContextFromCmdLine(src_width,src_height,image_format,
 				   image_width,image_height,IMGFMT_Y8);
 
@@ -46,6 +46,7 @@
 #include "video_out_internal.h"
 #include "mp_core.h"
 #include "help_mp.h"
+#include "image_writer.h"
 
 /* ------------------------------------------------------------------------- */
 
@@ -54,6 +55,9 @@
 /* Used for temporary buffers to store file- and pathnames */
 #define BUFLENGTH 512
 
+/* Maximum number of threads compressing images */
+#define MAX_THREADS 16
+
 /* ------------------------------------------------------------------------- */
 
 /* Info */
@@ -86,8 +90,10 @@ int jpeg_dpi = 72; /** Screen resolution = 72 dpi */
 char *jpeg_outdir = NULL;
 char *jpeg_subdirs = NULL;
 int jpeg_maxfiles = 1000;
+int jpeg_threads = 1;
 
 static int framenum = 0;
+static struct image_writer *writer = NULL;
 
 /* ------------------------------------------------------------------------- */
 
@@ -159,6 +165,10 @@ static int config(uint32_t width, uint32_t height, uint32_t d_width,
 {
     char buf[BUFLENGTH];
 
+    /* The threads still writing images use the old size. */
+
+    image_writer_flush(writer);
+
     /* Create outdir. */
 
     snprintf(buf, BUFLENGTH, "%s", jpeg_outdir);
@@ -177,30 +187,36 @@ static int config(uint32_t width, uint32_t height, uint32_t d_width,
 
 /* ------------------------------------------------------------------------- */
 
-static uint32_t jpeg_write(uint8_t * name, uint8_t * buffer)
+/** \brief Compress and write one image.
+ *
+ *  This is called by the image writer threads, see image_writer.h.
+ *
+ * \return 0 on success, the player exits after an error.
+ */
+
+static int jpeg_write(void *ctx, const char *name, uint8_t *buffer,
+                      int row_stride, int width, int height)
 {
     FILE *outfile;
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
     JSAMPROW row_pointer[1];
-    int row_stride;
 
-    if ( !buffer ) return 1;
     if ( (outfile = fopen(name, "wb") ) == NULL ) {
         mp_msg(MSGT_VO, MSGL_ERR, "\n%s: %s\n", info.short_name,
                 MSGTR_VO_CantCreateFile);
         mp_msg(MSGT_VO, MSGL_ERR, "%s: %s: %s\n",
                 info.short_name, MSGTR_VO_GenericError,
                 strerror(errno) );
-        exit_player(EXIT_ERROR);
+        return 1;
     }
 
     cinfo.err = jpeg_std_error(&jerr);
     jpeg_create_compress(&cinfo);
     jpeg_stdio_dest(&cinfo, outfile);
 
-    cinfo.image_width = image_width;
-    cinfo.image_height = image_height;
+    cinfo.image_width = width;
+    cinfo.image_height = height;
     cinfo.input_components = 3;
     cinfo.in_color_space = JCS_RGB;
 
@@ -212,8 +228,8 @@ static uint32_t jpeg_write(uint8_t * name, uint8_t * buffer)
     cinfo.density_unit = 1; /* 0=unknown, 1=dpi, 2=dpcm */
     /* Image DPI is determined by Y_density, so we leave that at
        jpeg_dpi if possible and crunch X_density instead (PAR > 1) */
-    cinfo.X_density = jpeg_dpi*image_width/image_d_width;
-    cinfo.Y_density = jpeg_dpi*image_height/image_d_height;
+    cinfo.X_density = jpeg_dpi*width/image_d_width;
+    cinfo.Y_density = jpeg_dpi*height/image_d_height;
     cinfo.write_Adobe_marker = TRUE;
 
     jpeg_set_quality(&cinfo,jpeg_quality, jpeg_baseline);
@@ -226,7 +242,6 @@ static uint32_t jpeg_write(uint8_t * name, uint8_t * buffer)
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    row_stride = image_width * 3;
     while (cinfo.next_scanline < cinfo.image_height) {
         row_pointer[0] = &buffer[cinfo.next_scanline * row_stride];
         (void)jpeg_write_scanlines(&cinfo, row_pointer,1);
@@ -271,7 +286,11 @@ static int draw_frame(uint8_t *src[])
 
     framecounter++;
 
-    return jpeg_write(buf, src[0]);
+    if ( !src[0] ) return 1;
+    if ( !image_writer_put(writer, buf, src[0], image_width * 3,
+                           image_width, image_height, 3) )
+        exit_player(EXIT_ERROR);
+    return 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -309,6 +328,8 @@ static int query_format(uint32_t format)
 
 static void uninit(void)
 {
+    image_writer_free(writer, info.short_name);
+    writer = NULL;
     if (jpeg_subdirs) {
         free(jpeg_subdirs);
         jpeg_subdirs = NULL;
@@ -336,6 +357,15 @@ static int int_zero_hundred(void *valp)
     return *val >= 0 && *val <= 100;
 }
 
+/** \brief Validation function for the number of threads
+ */
+
+static int int_threads(void *valp)
+{
+    int *val = valp;
+    return *val >= 1 && *val <= MAX_THREADS;
+}
+
 static int preinit(const char *arg)
 {
     const opt_t subopts[] = {
@@ -351,8 +381,10 @@ static int preinit(const char *arg)
         {"outdir",      OPT_ARG_MSTRZ,  &jpeg_outdir,           NULL},
         {"subdirs",     OPT_ARG_MSTRZ,  &jpeg_subdirs,          NULL},
         {"maxfiles",    OPT_ARG_INT,    &jpeg_maxfiles, int_pos},
+        {"threads",     OPT_ARG_INT,    &jpeg_threads,  int_threads},
         {NULL, 0, NULL, NULL}
     };
+    void *ctx[MAX_THREADS] = { NULL };
     const char *info_message = NULL;
 
     mp_msg(MSGT_VO, MSGL_INFO, "%s: %s\n", info.short_name,
@@ -364,6 +396,7 @@ static int preinit(const char *arg)
     jpeg_smooth = 0;
     jpeg_quality = 75;
     jpeg_maxfiles = 1000;
+    jpeg_threads = 1;
     jpeg_outdir = strdup(".");
     jpeg_subdirs = NULL;
 
@@ -371,6 +404,12 @@ static int preinit(const char *arg)
         return -1;
     }
 
+    /* libjpeg keeps all its state in cinfo, the threads need no context */
+    writer = image_writer_new(jpeg_threads, 2 * jpeg_threads, jpeg_write, ctx);
+    if (!writer) {
+        return -1;
+    }
+
     if (jpeg_progressive_mode) info_message = MSGTR_VO_JPEG_ProgressiveJPEG;
     else info_message = MSGTR_VO_JPEG_NoProgressiveJPEG;
     mp_msg(MSGT_VO, MSGL_INFO, "%s: %s\n", info.short_name, info_message);
@@ -395,6 +434,8 @@ static int preinit(const char *arg)
         mp_msg(MSGT_VO, MSGL_V, "%s: maxfiles --> %d\n", info.short_name,
                                                                 jpeg_maxfiles);
     }
+    mp_msg(MSGT_VO, MSGL_V, "%s: threads --> %d\n", info.short_name,
+                                                                jpeg_threads);
 
     mp_msg(MSGT_VO, MSGL_INFO, "%s: %s\n", info.short_name,
                                             MSGTR_VO_SuboptionsParsedOK);
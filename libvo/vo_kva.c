@@ -635,7 +635,7 @@ static void uninit(void)
 
     imgFree();
 
-    sws_freeContext(m_int.sws);
+    sws_releaseContext(m_int.sws);
 
     if (m_int.hwndFrame != NULLHANDLE) {
         kvaResetAttr();
@@ -674,7 +674,8 @@ static int config(uint32_t width, uint32_t height,
     if (!m_int.fHWAccel) {
         int dstFormat = 0;
 
-        sws_freeContext(m_int.sws);
+        sws_releaseContext(m_int.sws);
+        m_int.sws = NULL;
 
         if (m_int.kvac.ulInputFormatFlags & KVAF_YV12)
             dstFormat = IMGFMT_YV12;
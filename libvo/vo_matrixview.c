@@ -137,7 +137,7 @@ static int config(uint32_t width, uint32_t height,
         return -1;
 
     if (sws)
-        sws_freeContext(sws);
+        sws_releaseContext(sws);
 
     sws = sws_getContextFromCmdLine(image_width, image_height, image_format,
                                     matrix_cols, matrix_rows, IMGFMT_Y8);
@@ -227,7 +227,7 @@ static void uninit(void)
     uninit_mpglcontext(&glctx);
     free(map_image[0]);
     map_image[0] = NULL;
-    sws_freeContext(sws);
+    sws_releaseContext(sws);
     sws = NULL;
 }
 
@@ -38,9 +38,11 @@
 #include "video_out.h"
 #include "video_out_internal.h"
 #include "subopt-helper.h"
+#include "image_writer.h"
 #include "libavcodec/avcodec.h"
 
 #define BUFLENGTH 512
+#define MAX_THREADS 16
 
 static const vo_info_t info =
 {
@@ -56,9 +58,17 @@ static int z_compression;
 static char *png_outdir;
 static int framenum;
 static int use_alpha;
-static AVCodecContext *avctx;
-static uint8_t *outbuffer;
-int outbuffer_size;
+static int threads;
+static int write_failed;
+
+// one for each thread writing images
+struct png_encoder {
+    AVCodecContext *avctx;
+    uint8_t *outbuffer;
+    int outbuffer_size;
+};
+static struct png_encoder *encoders[MAX_THREADS];
+static struct image_writer *writer;
 
 static void png_mkdir(char *buf, int verbose) {
     struct stat stat_p;
@@ -125,35 +135,34 @@ config(uint32_t width, uint32_t height, uint32_t d_width, uint32_t d_height, uin
 }
 
 
-static uint32_t draw_image(mp_image_t* mpi){
+// Runs in the image writer threads.
+static int png_write(void *ctx, const char *name, uint8_t *data, int stride,
+                     int w, int h)
+{
+    struct png_encoder *enc = ctx;
     AVFrame pic;
     int buffersize;
     int res;
-    char buf[100];
     FILE *outfile;
 
-    // if -dr or -slices then do nothing:
-    if(mpi->flags&(MP_IMGFLAG_DIRECT|MP_IMGFLAG_DRAW_CALLBACK)) return VO_TRUE;
-
-    snprintf (buf, 100, "%s/%08d.png", png_outdir, ++framenum);
-    outfile = fopen(buf, "wb");
+    outfile = fopen(name, "wb");
     if (!outfile) {
         mp_msg(MSGT_VO,MSGL_WARN, MSGTR_LIBVO_PNG_ErrorOpeningForWriting, strerror(errno));
         return 1;
     }
 
-    avctx->width = mpi->w;
-    avctx->height = mpi->h;
-    avctx->pix_fmt = imgfmt2pixfmt(mpi->imgfmt);
-    pic.data[0] = mpi->planes[0];
-    pic.linesize[0] = mpi->stride[0];
-    buffersize = mpi->w * mpi->h * 8;
-    if (outbuffer_size < buffersize) {
-        av_freep(&outbuffer);
-        outbuffer = av_malloc(buffersize);
-        outbuffer_size = buffersize;
+    enc->avctx->width = w;
+    enc->avctx->height = h;
+    enc->avctx->pix_fmt = imgfmt2pixfmt(use_alpha ? IMGFMT_BGR32 : IMGFMT_RGB24);
+    pic.data[0] = data;
+    pic.linesize[0] = stride;
+    buffersize = w * h * 8;
+    if (enc->outbuffer_size < buffersize) {
+        av_freep(&enc->outbuffer);
+        enc->outbuffer = av_malloc(buffersize);
+        enc->outbuffer_size = buffersize;
     }
-    res = avcodec_encode_video(avctx, outbuffer, outbuffer_size, &pic);
+    res = avcodec_encode_video(enc->avctx, enc->outbuffer, enc->outbuffer_size, &pic);
 
     if(res < 0){
  	    mp_msg(MSGT_VO,MSGL_WARN, MSGTR_LIBVO_PNG_ErrorInCreatePng);
@@ -161,9 +170,26 @@ static uint32_t draw_image(mp_image_t* mpi){
 	    return 1;
     }
 
-    fwrite(outbuffer, res, 1, outfile);
+    fwrite(enc->outbuffer, res, 1, outfile);
     fclose(outfile);
 
+    return 0;
+}
+
+static uint32_t draw_image(mp_image_t* mpi){
+    char buf[BUFLENGTH];
+
+    // if -dr or -slices then do nothing:
+    if(mpi->flags&(MP_IMGFLAG_DIRECT|MP_IMGFLAG_DRAW_CALLBACK)) return VO_TRUE;
+
+    snprintf (buf, BUFLENGTH, "%s/%08d.png", png_outdir, ++framenum);
+    // the failure flag is sticky, report it only once
+    if (!image_writer_put(writer, buf, mpi->planes[0], mpi->stride[0],
+                          mpi->w, mpi->h, mpi->bpp / 8) && !write_failed) {
+        mp_msg(MSGT_VO, MSGL_ERR, MSGTR_LIBVO_PNG_ErrorWritingImages);
+        write_failed = 1;
+    }
+
     return VO_TRUE;
 }
 
@@ -195,10 +221,16 @@ query_format(uint32_t format)
 }
 
 static void uninit(void){
-    avcodec_close(avctx);
-    av_freep(&avctx);
-    av_freep(&outbuffer);
-    outbuffer_size = 0;
+    int i;
+
+    image_writer_free(writer, info.short_name);
+    writer = NULL;
+    for (i = 0; i < MAX_THREADS && encoders[i]; i++) {
+        avcodec_close(encoders[i]->avctx);
+        av_freep(&encoders[i]->avctx);
+        av_freep(&encoders[i]->outbuffer);
+        av_freep(&encoders[i]);
+    }
     if (png_outdir) {
         free(png_outdir);
         png_outdir = NULL;
@@ -213,28 +245,52 @@ static int int_zero_to_nine(void *value)
     return *sh >= 0 && *sh <= 9;
 }
 
+static int int_threads(void *value)
+{
+    int *sh = value;
+    return *sh >= 1 && *sh <= MAX_THREADS;
+}
+
 static const opt_t subopts[] = {
     {"alpha", OPT_ARG_BOOL, &use_alpha, NULL},
     {"z",   OPT_ARG_INT, &z_compression, int_zero_to_nine},
     {"outdir",      OPT_ARG_MSTRZ,  &png_outdir,           NULL},
+    {"threads",     OPT_ARG_INT,    &threads,              int_threads},
     {NULL}
 };
 
 static int preinit(const char *arg)
 {
+    int i;
+
     z_compression = 0;
     png_outdir = strdup(".");
     use_alpha = 0;
+    threads = 1;
+    write_failed = 0;
     if (subopt_parse(arg, subopts) != 0) {
         return -1;
     }
     avcodec_register_all();
-    avctx = avcodec_alloc_context();
-    if (avcodec_open(avctx, avcodec_find_encoder(CODEC_ID_PNG)) < 0) {
+    // avcodec_open() is not thread safe, open all encoders here
+    for (i = 0; i < threads; i++) {
+        encoders[i] = av_mallocz(sizeof(struct png_encoder));
+        if (!encoders[i]) {
+            uninit();
+            return -1;
+        }
+        encoders[i]->avctx = avcodec_alloc_context();
+        if (avcodec_open(encoders[i]->avctx, avcodec_find_encoder(CODEC_ID_PNG)) < 0) {
+            uninit();
+            return -1;
+        }
+        encoders[i]->avctx->compression_level = z_compression;
+    }
+    writer = image_writer_new(threads, 2 * threads, png_write, (void **)encoders);
+    if (!writer) {
         uninit();
         return -1;
     }
-    avctx->compression_level = z_compression;
     return 0;
 }
 
@@ -174,7 +174,7 @@ static void vesa_term( void )
   if(HAS_DGA()) vbeUnmapVideoBuffer((unsigned long)win.ptr,win.high);
   if(dga_buffer && !HAS_DGA()) free(dga_buffer);
   vbeDestroy();
-  if(sws) sws_freeContext(sws);
+  sws_releaseContext(sws);
   sws=NULL;
 }
 
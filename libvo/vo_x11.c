@@ -409,7 +409,7 @@ static int config(uint32_t width, uint32_t height, uint32_t d_width,
     if (myximage)
     {
         freeMyXImage();
-        sws_freeContext(swsContext);
+        sws_releaseContext(swsContext);
     }
     getMyXImage();
 
@@ -550,7 +550,7 @@ static int draw_slice(uint8_t * src[], int stride[], int w, int h,
 
             freeMyXImage();
             getMyXImage();
-            sws_freeContext(oldContext);
+            sws_releaseContext(oldContext);
         } else
         {
             swsContext = oldContext;
@@ -649,7 +649,7 @@ static void uninit(void)
     zoomFlag = 0;
     vo_x11_uninit();
 
-    sws_freeContext(swsContext);
+    sws_releaseContext(swsContext);
 }
 
 static int preinit(const char *arg)
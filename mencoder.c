@@ -53,6 +53,12 @@
 #endif
 
 #include <sys/time.h>
+#ifndef __MINGW32__
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "mp_msg.h"
 #include "help_mp.h"
@@ -82,6 +88,7 @@
 #include "libmpcodecs/dec_video.h"
 #include "libmpcodecs/vf.h"
 #include "libmpcodecs/vd.h"
+#include "libmpcodecs/vf_passcache.h"
 
 // for MPEGLAYER3WAVEFORMAT:
 #include "libmpdemux/ms_hdr.h"
@@ -174,11 +181,16 @@ unsigned int vobsub_out_index=0;
 char *vobsub_out_id=NULL;
 
 char* out_filename=NULL;
+static int write_cache_size=0; // KiB, written by a separate thread
 
 char *force_fourcc=NULL;
 int force_audiofmttag=-1;
 
 char* passtmpfile="divx2pass.log";
+static char *passcache_out=NULL;  ///< store the encoder's input frames here
+static char *passcache_in=NULL;   ///< and feed a later pass from it
+static int passcache_level=1;
+static struct passcache *passcache=NULL;
 
 static int play_n_frames=-1;
 static int play_n_frames_mf=-1;
@@ -251,6 +263,12 @@ static off_t seek_to_byte=0;
 
 static m_time_size_t end_at = { .type = END_AT_NONE, .pos = 0 };
 
+#define MAX_SEGMENTS 64
+static int encode_segments=1;
+static double segment_end=0;    ///< -segments worker: source time to stop at
+static float segment_start=0;   ///< pts of the first frame of the segment
+static char **segment_files=NULL; ///< temporary files of a -segments encode
+
 static char * frameno_filename=NULL;
 
 typedef struct {
@@ -333,6 +351,31 @@ static void exit_sighandler(int x){
 
 static muxer_t* muxer=NULL;
 
+/** \brief Store an encoding decision with -passcache-out, or replace it
+ *  with the one taken in the first pass with -passcache-in.
+ *  \return 0 if there is no decision to replay. */
+static int passcache_mark(vf_instance_t *vf, int type, int *value)
+{
+    vf_passcache_mark_t mark = { type, *value };
+    if (!passcache)
+        return 1;
+    if (vf && vf->control(vf, VFCTRL_PASSCACHE_MARK, &mark) == CONTROL_FALSE)
+        return 0;
+    *value = mark.value;
+    return 1;
+}
+
+/// Encode the last frame again, or write a zero-size frame to repeat it.
+static void duplicate_frame(vf_instance_t *vf, muxer_stream_t *mux_v)
+{
+    int encoded = encode_duplicates && vf &&
+                  vf->control(vf, VFCTRL_DUPLICATE_FRAME, 0) == CONTROL_TRUE;
+    if (!passcache_mark(vf, PASSCACHE_MARK_DUPLICATE, &encoded))
+        mencoder_exit(1, NULL);
+    if (!encoded)
+        muxer_write_chunk(mux_v,0,0, MP_NOPTS_VALUE, MP_NOPTS_VALUE);
+}
+
 static void add_subtitles(char *filename, float fps, int silent)
 {
     sub_data *subd;
@@ -343,6 +386,8 @@ static void add_subtitles(char *filename, float fps, int silent)
     if (!filename) return;
 
     subd = sub_read_file(filename, fps);
+    // the whole file is needed, the encoding can run ahead of the reading
+    sub_wait(subd);
 #ifdef CONFIG_ASS
     if (ass_enabled)
 #ifdef CONFIG_ICONV
@@ -376,10 +421,11 @@ static void add_subtitles(char *filename, float fps, int silent)
 static float stop_time(demuxer_t* demuxer, muxer_stream_t* mux_v)
 {
 	float timeleft = -1;
-	if (play_n_frames >= 0) timeleft = mux_v->timer + play_n_frames * (double)(mux_v->h.dwScale) / mux_v->h.dwRate;
+	if (play_n_frames >= 0) timeleft = muxer_stream_timer(mux_v) + play_n_frames * (double)(mux_v->h.dwScale) / mux_v->h.dwRate;
 	if (end_at.type == END_AT_TIME && (timeleft > end_at.pos || timeleft == -1)) timeleft = end_at.pos;
+	if (segment_end > 0 && (timeleft > segment_end - segment_start || timeleft == -1)) timeleft = segment_end - segment_start;
 	if (next_edl_record && demuxer && demuxer->video) { // everything is OK to be checked
-		float tmp = mux_v->timer + next_edl_record->start_sec - demuxer->video->pts;
+		float tmp = muxer_stream_timer(mux_v) + next_edl_record->start_sec - demuxer->video->pts;
 		if (timeleft == -1 || timeleft > tmp) {
 			// There's less time in EDL than what we already know
 			if (next_edl_record->action == EDL_SKIP && edl_seeking) {
@@ -541,6 +587,121 @@ static int edl_seek(edl_record_ptr next_edl_record, demuxer_t *demuxer,
     return slowseek(next_edl_record->stop_sec, demuxer->video, d_audio, mux_a, frame_data, framecopy, 1);
 }
 
+/** \brief Finds keyframes that split the input into up to n parts of equal
+ *  length for -segments.
+ *  \return the number of segments, their start times are put in starts. */
+static int find_segment_starts(demuxer_t *demuxer, sh_video_t *sh_video,
+                               double *starts, int n)
+{
+    double len = demuxer_get_time_length(demuxer);
+    float frame_time;
+    unsigned char *start;
+    int i, count = 1;
+
+    if (video_read_frame(sh_video, &frame_time, &start, force_fps) < 0)
+        return 0;
+    starts[0] = sh_video->pts;
+
+    for (i = 1; i < n; i++) {
+        int frames = 0;
+        if (!demux_seek(demuxer, starts[0] + len * i / n, 0, SEEK_ABSOLUTE))
+            break;
+        // seeking normally lands on a keyframe, but do not trust it
+        do {
+            if (video_read_frame(sh_video, &frame_time, &start, force_fps) < 0)
+                return count;
+        } while (!(sh_video->ds->flags & 1) && ++frames < 1000);
+        if (!(sh_video->ds->flags & 1))
+            break;
+        // long GOPs may make two split points share a keyframe
+        if (sh_video->pts < starts[count - 1] + sh_video->frametime)
+            continue;
+        starts[count++] = sh_video->pts;
+    }
+    return count;
+}
+
+/** \brief Encodes every segment in its own MEncoder process.
+ *  Each worker gets the original command line with the segment limits and
+ *  its temporary output file appended.
+ *  \return 1 if all workers succeeded. */
+static int run_segment_workers(int argc, char *argv[], const double *starts,
+                               int n, float frame_time)
+{
+#ifndef __MINGW32__
+    pid_t pids[MAX_SEGMENTS];
+    char exe[PATH_MAX];
+    ssize_t len;
+    int i, ok = 1;
+
+    // run this very binary, argv[0] may resolve to another one through PATH
+    len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len > 0)
+        exe[len] = 0;
+    else if (!strchr(argv[0], '/') || !realpath(argv[0], exe)) {
+        mp_msg(MSGT_MENCODER, MSGL_ERR, MSGTR_CannotFindExecutable, argv[0]);
+        return 0;
+    }
+
+    for (i = 0; i < n; i++) {
+        char ss[32], end[32];
+        char *logfile = malloc(strlen(passtmpfile) + 8);
+        char **args = calloc(argc + 20, sizeof(char *));
+        int a = argc;
+
+        memcpy(args, argv, argc * sizeof(char *));
+        args[a++] = "-segments";
+        args[a++] = "1";
+        args[a++] = "-quiet";
+        args[a++] = "-of";
+        args[a++] = "avi";
+        args[a++] = "-o";
+        args[a++] = segment_files[i];
+        // separate statistics files, so that 2-pass encodes work too
+        sprintf(logfile, "%s.seg%02d", passtmpfile, i);
+        args[a++] = "-passlogfile";
+        args[a++] = logfile;
+        if (i > 0) {
+            // seek into the keyframe's frame, not right onto its edge
+            snprintf(ss, sizeof(ss), "%f", starts[i] + frame_time / 2);
+            args[a++] = "-ss";
+            args[a++] = ss;
+        }
+        if (i < n - 1) {
+            snprintf(end, sizeof(end), "%f", starts[i + 1]);
+            args[a++] = "-segment-end";
+            args[a++] = end;
+        }
+
+        pids[i] = fork();
+        if (!pids[i]) {
+            execv(exe, args);
+            _exit(1);
+        }
+        free(args);
+        free(logfile);
+        if (pids[i] < 0) {
+            ok = 0;
+            n = i;
+            break;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        int status;
+        pid_t r;
+        while ((r = waitpid(pids[i], &status, 0)) < 0 && errno == EINTR)
+            ;
+        if (r < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            mp_msg(MSGT_MENCODER, MSGL_ERR, MSGTR_SegmentFailed, i);
+            ok = 0;
+        }
+    }
+    return ok;
+#else
+    return 0;
+#endif
+}
 
 int main(int argc,char* argv[]){
 
@@ -567,6 +728,7 @@ uint32_t videosamples=1;
 uint32_t skippedframes=0;
 uint32_t duplicatedframes=0;
 uint32_t badframes=0;
+int pipeline_queued=0;
 
 muxer_stream_t* mux_a=NULL;
 muxer_stream_t* mux_v=NULL;
@@ -805,6 +967,82 @@ sh_video=d_video->sh;
     mp_msg(MSGT_MENCODER,MSGL_INFO,MSGTR_ForcingInputFPS, sh_video->fps);
   }
 
+  if (encode_segments > 1) {
+    // Encode parts of the file in parallel worker processes, then join
+    // them by copying the streams, as MEncoder does with several files.
+    double starts[MAX_SEGMENTS];
+    int n = 0;
+    float frame_time = sh_video->frametime;
+
+    if (filelist[1].name || seek_to_sec || seek_to_byte || demuxer2 ||
+        end_at.type != END_AT_NONE || play_n_frames_mf >= 0 ||
+        edl_filename || vobsub_out || audio_delay != 0 ||
+        passcache_out || passcache_in) {
+      mp_msg(MSGT_MENCODER, MSGL_FATAL, MSGTR_SegmentsOptionConflict);
+      mencoder_exit(1, NULL);
+    }
+#ifndef __MINGW32__
+    if (!demuxer->seekable || !(stream->flags & MP_STREAM_SEEK) ||
+        demuxer_get_time_length(demuxer) <= 0)
+#endif
+    {
+      // nothing has been read yet, just go on with a normal encode
+      mp_msg(MSGT_MENCODER, MSGL_WARN, MSGTR_CannotSplitIntoSegments);
+      encode_segments = 1;
+      goto encode_file;
+    }
+    n = find_segment_starts(demuxer, sh_video, starts, encode_segments);
+    free_demuxer(demuxer);
+    free_stream(stream);
+    demuxer = NULL;
+    stream = NULL;
+    m_config_pop(mconfig);
+    encode_segments = 1;
+
+    if (n < 2) {
+      // too short or no keyframes to split at: encode it in one piece
+      mp_msg(MSGT_MENCODER, MSGL_WARN, MSGTR_CannotSplitIntoSegments);
+      goto play_next_file;
+    }
+
+    segment_files = calloc(n + 1, sizeof(char *));
+    for (i = 0; i < n; i++) {
+      segment_files[i] = malloc(strlen(out_filename) + 12);
+      sprintf(segment_files[i], "%s.seg%02d.avi", out_filename, i);
+      mp_msg(MSGT_MENCODER, MSGL_INFO, MSGTR_EncodingSegment, i, starts[i],
+             segment_files[i]);
+    }
+    if (!run_segment_workers(argc, argv, starts, n, frame_time)) {
+      for (i = 0; i < n; i++)
+        unlink(segment_files[i]);
+      mencoder_exit(1, NULL);
+    }
+
+    // continue with the segments as input files, copying their streams
+    filelist = calloc(n + 1, sizeof(m_entry_t));
+    for (i = 0; i < n; i++) {
+      filelist[i].name = segment_files[i];
+      filelist[i].opts = calloc(2, sizeof(char *));
+    }
+    out_video_codec = VCODEC_COPY;
+    out_audio_codec = ACODEC_COPY;
+    demuxer_name = audio_demuxer_name = sub_demuxer_name = NULL;
+    audio_stream = NULL;
+    audio_id = video_id = dvdsub_id = -1;
+    audio_lang = dvdsub_lang = NULL;
+    sub_name = NULL;
+    ts_prog = 0;
+    dvd_chapter = 1;
+    dvd_last_chapter = 0;
+    force_fps = 0;
+    playback_speed = 1.0;
+    // the segments are in sync already, take every frame as it is
+    skip_limit = 0;
+    default_max_pts_correction = 0;
+    goto play_next_file;
+  }
+encode_file:
+
   if(sh_audio && out_audio_codec<0){
     if(audio_id==-2)
 	mp_msg(MSGT_MENCODER,MSGL_ERR,MSGTR_DemuxerDoesntSupportNosound);
@@ -886,6 +1124,8 @@ if(!ostream) {
   mp_msg(MSGT_MENCODER, MSGL_FATAL, MSGTR_CannotOpenOutputFile, out_filename);
   mencoder_exit(1,NULL);
 }
+if (write_cache_size > 0 && !stream_enable_write_cache(ostream, write_cache_size*1024))
+  mp_msg(MSGT_MENCODER, MSGL_WARN, MSGTR_CannotEnableWriteCache);
 
 muxer=muxer_new_muxer(out_file_format,ostream);
 if(!muxer) {
@@ -1013,7 +1253,22 @@ default: {
         mencoder_exit(1,NULL);
     }
     ve = sh_video->vfilter;
+    if (passcache_out || passcache_in) {
+      const char *name = passcache_in ? passcache_in : passcache_out;
+      passcache = passcache_open(name, !!passcache_in, passcache_level);
+      if (!passcache) {
+        mp_msg(MSGT_MENCODER, MSGL_FATAL, MSGTR_CannotOpenPassCache, name);
+        mencoder_exit(1,NULL);
+      }
+    }
   } else sh_video->vfilter = ve;
+    // the cache sees exactly what the encoder gets, with -passcache-in
+    // it replaces the decoder and all other filters
+    if (passcache)
+      sh_video->vfilter=vf_open_passcache(sh_video->vfilter, passcache);
+    if (passcache_in)
+      goto filters_done;
+
     // append 'expand' filter, it fixes stride problems and renders osd:
 #ifdef CONFIG_ASS
     if (auto_expand && !ass_enabled) { /* we do not want both */
@@ -1059,6 +1314,7 @@ default: {
 #endif
 
     sh_video->vfilter=append_filters(sh_video->vfilter);
+filters_done:
 
 #ifdef CONFIG_ASS
   if (ass_enabled)
@@ -1289,7 +1545,7 @@ if(file_format == DEMUXER_TYPE_TV)
 	}
 
 play_n_frames=play_n_frames_mf;
-if (curfile && end_at.type == END_AT_TIME) end_at.pos += mux_v->timer;
+if (curfile && end_at.type == END_AT_TIME) end_at.pos += muxer_stream_timer(mux_v);
 
 if (edl_records) free_edl(edl_records);
 next_edl_record = edl_records = NULL;
@@ -1301,6 +1557,15 @@ if (edl_filename) {
 
 if (sh_audio && audio_delay != 0.) fixdelay(d_video, d_audio, mux_a, &frame_data, mux_v->codec==VCODEC_COPY);
 
+if (segment_end > 0) {
+    // -segments worker: the first frame tells where the segment starts,
+    // audio has to end together with the video of the segment
+    frame_data.in_size = video_read_frame(sh_video, &frame_data.frame_time, &frame_data.start, force_fps);
+    sh_video->timer += frame_data.frame_time;
+    frame_data.already_read = 1;
+    segment_start = sh_video->pts;
+}
+
 while(!at_eof){
 
     int blit_frame=0;
@@ -1309,7 +1574,7 @@ while(!at_eof){
     int skip_flag=0; // 1=skip  -1=duplicate
 
     if((end_at.type == END_AT_SIZE && end_at.pos <= stream_tell(muxer->stream))  ||
-       (end_at.type == END_AT_TIME && end_at.pos < mux_v->timer))
+       (end_at.type == END_AT_TIME && end_at.pos < muxer_stream_timer(mux_v)))
         break;
 
     if(play_n_frames>=0){
@@ -1363,7 +1628,7 @@ goto_redo_edl:
 
 if(sh_audio){
     // get audio:
-    while(mux_a->timer-audio_preload<mux_v->timer){
+    while(muxer_stream_timer(mux_a)-audio_preload<muxer_stream_timer(mux_v)){
         float tottime;
 	int len=0;
 
@@ -1372,7 +1637,7 @@ if(sh_audio){
 	// or until the end of video:
 	tottime = stop_time(demuxer, mux_v);
 	if (tottime != -1) {
-		tottime -= mux_a->timer;
+		tottime -= muxer_stream_timer(mux_a);
 		if (tottime > 1./audio_density) tottime = 1./audio_density;
 	}
 	else tottime = 1./audio_density;
@@ -1423,7 +1688,7 @@ if(sh_audio){
 				mux_a->buffer_len += len;
 			}
 	    }
-	    if (mux_v->timer == 0) mux_a->h.dwInitialFrames++;
+	    if (muxer_stream_timer(mux_v) == 0) mux_a->h.dwInitialFrames++;
 	}
 	else {
 	if(mux_a->h.dwSampleSize){
@@ -1446,8 +1711,8 @@ if(sh_audio){
 	}
 	if(len<=0) break; // EOF?
 	muxer_write_chunk(mux_a,len,AVIIF_KEYFRAME, MP_NOPTS_VALUE, MP_NOPTS_VALUE);
-	if(!mux_a->h.dwSampleSize && mux_a->timer>0)
-	    mux_a->wf->nAvgBytesPerSec=0.5f+(double)mux_a->size/mux_a->timer; // avg bps (VBR)
+	if(!mux_a->h.dwSampleSize && muxer_stream_timer(mux_a)>0)
+	    mux_a->wf->nAvgBytesPerSec=0.5f+(double)mux_a->size/muxer_stream_timer(mux_a); // avg bps (VBR)
 	if(mux_a->buffer_len>=len){
 	    mux_a->buffer_len-=len;
 	    fast_memcpy(mux_a->buffer,mux_a->buffer+len,mux_a->buffer_len);
@@ -1468,6 +1733,19 @@ if(sh_audio){
     }
     frame_data.frame_time /= playback_speed;
     if(frame_data.in_size<0){ at_eof=1; break; }
+    if (segment_end > 0 && sh_video->pts >= segment_end - frame_data.frame_time / 2) {
+        // The next segment starts with this frame. With -ofps the video
+        // may fall short of the audio, pad it to the segment length.
+        vf_instance_t *vf = sh_video->vfilter;
+        if (vf)
+            vf->control(vf, VFCTRL_PIPELINE_SYNC, 0);
+        while (muxer_stream_timer(mux_v) + 0.5 * mux_v->h.dwScale / mux_v->h.dwRate < segment_end - segment_start) {
+            duplicatedframes++;
+            duplicate_frame(vf, mux_v);
+        }
+        at_eof=1;
+        break;
+    }
     ++decoded_frameno;
 
     v_timer_corr-=frame_data.frame_time-(float)mux_v->h.dwScale/mux_v->h.dwRate;
@@ -1522,6 +1800,12 @@ if ((v_pts_corr >= mux_frametime && skip_flag < 0) || (v_pts_corr >= 2*mux_frame
 
 } // demuxer2
 
+// the frames cached by the first pass depend on its decisions
+if (!passcache_mark(sh_video->vfilter, PASSCACHE_MARK_FRAME, &skip_flag)) {
+    at_eof=1;
+    break;
+}
+
 ptimer_start = GetTimerMS();
 
 switch(mux_v->codec){
@@ -1535,9 +1819,14 @@ case VCODEC_FRAMENO:
     break;
 default:
     // decode_video will callback down to ve_*.c encoders, through the video filters
+    if (passcache_in)
+      blit_frame = 0; // the filtered frames come from the cache
+    else
     {void *decoded_frame = decode_video(sh_video,frame_data.start,frame_data.in_size,
       skip_flag>0 && (!sh_video->vfilter || ((vf_instance_t *)sh_video->vfilter)->control(sh_video->vfilter, VFCTRL_SKIP_NEXT_FRAME, 0) != CONTROL_TRUE), MP_NOPTS_VALUE);
     blit_frame = decoded_frame && filter_video(sh_video, decoded_frame, MP_NOPTS_VALUE);}
+    if (!passcache_mark(sh_video->vfilter, PASSCACHE_MARK_DECODED, &blit_frame))
+      mencoder_exit(1, NULL);
 
     if (sh_video->vf_initialized < 0) mencoder_exit(1, NULL);
 
@@ -1565,6 +1854,23 @@ default:
 #endif
       }
     }
+
+    // frames handed to -vf pipeline are filtered/encoded in another thread,
+    // account for the ones its tail dropped since the last frame
+    {vf_pipeline_status_t pipe_st = {0, 0};
+    vf_instance_t *vf = sh_video->vfilter;
+    // keep the muxer single-threaded while it buffers the first chunks
+    if (!muxer->muxbuf_skip_buffer)
+        vf->control(vf, VFCTRL_PIPELINE_SYNC, 0);
+    if (vf->control(vf, VFCTRL_GET_PIPELINE_STATUS, &pipe_st) == CONTROL_TRUE) {
+      pipeline_queued = pipe_st.queued;
+      if (pipe_st.dropped) {
+        if (play_n_frames >= 0)
+          play_n_frames += pipe_st.dropped;
+        badframes += pipe_st.dropped;
+        v_timer_corr -= pipe_st.dropped*(float)mux_v->h.dwScale/mux_v->h.dwRate;
+      }
+    }}
 }
 
 videosamples++;
@@ -1575,8 +1881,7 @@ if(skip_flag<0){
 	if(!quiet) mp_msg(MSGT_MENCODER, MSGL_WARN, MSGTR_DuplicateFrames,-skip_flag);
     while(skip_flag<0){
 	duplicatedframes++;
-	if (!encode_duplicates || !sh_video->vfilter || ((vf_instance_t *)sh_video->vfilter)->control(sh_video->vfilter, VFCTRL_DUPLICATE_FRAME, 0) != CONTROL_TRUE)
-	    muxer_write_chunk(mux_v,0,0, MP_NOPTS_VALUE, MP_NOPTS_VALUE);
+	duplicate_frame(sh_video->vfilter, mux_v);
 	++skip_flag;
     }
 } else
@@ -1610,10 +1915,10 @@ if(sh_audio && !demuxer2){
     AV_delay=(a_pts-v_pts);
     AV_delay-=audio_delay;
     AV_delay /= playback_speed;
-    AV_delay-=mux_a->timer-(mux_v->timer-(v_timer_corr+v_pts_corr));
+    AV_delay-=muxer_stream_timer(mux_a)-(muxer_stream_timer(mux_v)-(v_timer_corr+v_pts_corr));
     // adjust for encoder delays
     AV_delay -= (float) mux_a->encoder_delay * mux_a->h.dwScale/mux_a->h.dwRate;
-    AV_delay += (float) mux_v->encoder_delay * mux_v->h.dwScale/mux_v->h.dwRate;
+    AV_delay += (float) (mux_v->encoder_delay + pipeline_queued) * mux_v->h.dwScale/mux_v->h.dwRate;
 	// compensate input video timer by av:
         x=AV_delay*0.1f;
         if(x<-max_pts_correction) x=-max_pts_correction; else
@@ -1632,6 +1937,9 @@ if(sh_audio && !demuxer2){
 	off_t pos = demuxer->filepos >= 0 ? demuxer->filepos : stream_tell(demuxer->stream);
 	float p=len>1000 ? (float)(pos-demuxer->movi_start) / len :
                 (demuxer_get_percent_pos(demuxer) / 100.0);
+	double v_timer=muxer_stream_timer(mux_v);
+	double a_timer=mux_a ? muxer_stream_timer(mux_a) : 0;
+	off_t v_size=muxer_stream_size(mux_v);
 #if 0
 	if(!len && sh_audio && sh_audio->audio.dwLength>100){
 	    p=(sh_audio->audio.dwSampleSize? ds_tell(sh_audio->ds)/sh_audio->audio.dwSampleSize : sh_audio->ds->block_no)
@@ -1641,25 +1949,25 @@ if(sh_audio && !demuxer2){
       if(!quiet) {
 	if( mp_msg_test(MSGT_STATUSLINE,MSGL_V) ) {
 		mp_msg(MSGT_STATUSLINE,MSGL_STATUS,"Pos:%6.1fs %6df (%2d%%) %3dfps Trem:%4dmin %3dmb  A-V:%5.3f [%d:%d] A/Vms %d/%d D/B/S %d/%d/%d \r",
-	    	mux_v->timer, decoded_frameno, (int)(p*100),
+	    	v_timer, decoded_frameno, (int)(p*100),
 	    	(t>1) ? (int)(decoded_frameno/t+0.5) : 0,
 	    	(p>0.001) ? (int)((t/p-t)/60) : 0,
 	    	(p>0.001) ? (int)(stream_tell(muxer->stream)/p/1024/1024) : 0,
 	    	v_pts_corr,
-	    	(mux_v->timer>1) ? (int)(mux_v->size/mux_v->timer/125) : 0,
-	    	(mux_a && mux_a->timer>1) ? (int)(mux_a->size/mux_a->timer/125) : 0,
+	    	(v_timer>1) ? (int)(v_size/v_timer/125) : 0,
+	    	(mux_a && a_timer>1) ? (int)(mux_a->size/a_timer/125) : 0,
 			audiorate/audiosamples, videorate/videosamples,
 			duplicatedframes, badframes, skippedframes
 		);
 	} else
 	mp_msg(MSGT_STATUSLINE,MSGL_STATUS,"Pos:%6.1fs %6df (%2d%%) %5.2ffps Trem:%4dmin %3dmb  A-V:%5.3f [%d:%d]\r",
-	    mux_v->timer, decoded_frameno, (int)(p*100),
+	    v_timer, decoded_frameno, (int)(p*100),
 	    (t>1) ? (float)(decoded_frameno/t) : 0,
 	    (p>0.001) ? (int)((t/p-t)/60) : 0,
 	    (p>0.001) ? (int)(stream_tell(muxer->stream)/p/1024/1024) : 0,
 	    v_pts_corr,
-	    (mux_v->timer>1) ? (int)(mux_v->size/mux_v->timer/125) : 0,
-	    (mux_a && mux_a->timer>1) ? (int)(mux_a->size/mux_a->timer/125) : 0
+	    (v_timer>1) ? (int)(v_size/v_timer/125) : 0,
+	    (mux_a && a_timer>1) ? (int)(mux_a->size/a_timer/125) : 0
 	);
       }
     }
@@ -1672,12 +1980,22 @@ if(sh_audio && !demuxer2){
      int len;
      while((len=ds_get_packet_sub(d_dvdsub,&packet))>0){
 	 mp_msg(MSGT_MENCODER,MSGL_V,"\rDVD sub: len=%d  v_pts=%5.3f  s_pts=%5.3f  \n",len,sh_video->pts,d_dvdsub->pts);
-	     vobsub_out_output(vobsub_writer,packet,len,mux_v->timer + d_dvdsub->pts - sh_video->pts);
+	     vobsub_out_output(vobsub_writer,packet,len,muxer_stream_timer(mux_v) + d_dvdsub->pts - sh_video->pts);
      }
  }
  else
 #endif
+ {
+    // -vf pipeline draws the subtitles on its thread, finish the frames
+    // queued so far before their state changes
+    if (subdata || vo_spudec || dvdsub_id >= 0
+#ifdef CONFIG_ASS
+        || ass_track
+#endif
+       )
+        ((vf_instance_t *)sh_video->vfilter)->control(sh_video->vfilter, VFCTRL_PIPELINE_SYNC, 0);
     update_subtitles(sh_video, sh_video->pts, d_dvdsub, 0);
+ }
 
  frame_data = (s_frame_data){ .start = NULL, .in_size = 0, .frame_time = 0., .already_read = 0 };
 
@@ -1693,6 +2011,8 @@ if(sh_audio && !demuxer2){
 if (!interrupted && filelist[++curfile].name != 0) {
 	if (sh_video && sh_video->vfilter) { // Before uniniting sh_video and the filter chain, break apart the VE.
  		vf_instance_t * ve; // this will be the filter right before the ve.
+		// no frames may be in flight when the chain is cut
+		((vf_instance_t *)sh_video->vfilter)->control(sh_video->vfilter, VFCTRL_PIPELINE_SYNC, 0);
 		for (ve = sh_video->vfilter; ve->next && ve->next->next; ve = ve->next);
 
 		if (ve->next) ve->next = NULL; // I'm telling the last filter, before the VE, there is nothing after it
@@ -1729,6 +2049,10 @@ if (muxer->cont_write_index) muxer_write_index(muxer);
 muxer_f_size=stream_tell(muxer->stream);
 stream_seek(muxer->stream,0);
 if (muxer->cont_write_header) muxer_write_header(muxer); // update header
+if (!stream_flush_write_cache(muxer->stream)) {
+    mp_msg(MSGT_MENCODER,MSGL_FATAL,MSGTR_ErrorWritingFile, out_filename);
+    mencoder_exit(1, NULL);
+}
 #if 0
 if(ferror(muxer_f) || fclose(muxer_f) != 0) {
     mp_msg(MSGT_MENCODER,MSGL_FATAL,MSGTR_ErrorWritingFile, out_filename);
@@ -1757,6 +2081,11 @@ if(sh_audio){ uninit_audio(sh_audio);sh_audio=NULL; }
 if(sh_video){ uninit_video(sh_video);sh_video=NULL; }
 if(demuxer) free_demuxer(demuxer);
 if(stream) free_stream(stream); // kill cache thread
+passcache_close(passcache);
+
+if (segment_files)
+    for (i = 0; segment_files[i]; i++)
+        unlink(segment_files[i]);
 
 return interrupted;
 }
@@ -0,0 +1,286 @@
+/*
+ * dct36() for SSE2
+ *
+ * The 9 point IDCTs of the even and of the odd input samples are done
+ * side by side in the two low lanes of the registers, the windowing and
+ * the overlap with the previous granule handle four samples at once.
+ * The arithmetic is done in the same order as in dct36.c (NEW_DCT9).
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "libavutil/mem.h"
+#include "mpg123.h"
+
+/*
+ * Filled by init_layer3(), each constant is repeated in all four lanes:
+ * COS6_2, cos9[0..2], cos18[0..2], COS6_1 and then { 1, tfcos36[k] } for
+ * k = 0..8, which scales the odd half only.
+ */
+extern real __attribute__((aligned(16))) dct36_sse_const[17][4];
+
+static const int odd_mask[4] __attribute__((aligned(16))) =
+{ 0, -1, 0, -1 };
+
+/*
+ * Window and overlap dct36 outputs v0..v0+3, in the notation of MACRO(v)
+ * in dct36.c:
+ *   sum0 +- sum1      tmp[v] +- tmp[17-v], built from r[v0..v0+3]
+ *   out2[9+v]         sum * w[27+v]
+ *   out2[8-v]         sum * w[26-v]
+ *   ts[SBLIMIT*(9+v)] out1[9+v] + diff * w[9+v]
+ *   ts[SBLIMIT*(8-v)] out1[8-v] + diff * w[8-v]
+ * The descending indices are handled by reversing sum and diff.
+ */
+#define DCT36_WINDOW(v0) \
+    __asm__ volatile( \
+        "movaps     %c[r0](%0), %%xmm0\n\t" \
+        "unpcklps   %c[r1](%0), %%xmm0\n\t" \
+        "movaps     %c[r2](%0), %%xmm1\n\t" \
+        "unpcklps   %c[r3](%0), %%xmm1\n\t" \
+        "movaps     %%xmm0, %%xmm2\n\t" \
+        "movlhps    %%xmm1, %%xmm0\n\t" \
+        "movhlps    %%xmm2, %%xmm1\n\t" \
+        "movaps     %%xmm0, %%xmm2\n\t" \
+        "addps      %%xmm1, %%xmm2\n\t" \
+        "subps      %%xmm1, %%xmm0\n\t" \
+        "movups     %c[w2hi](%3), %%xmm3\n\t" \
+        "mulps      %%xmm2, %%xmm3\n\t" \
+        "movups     %%xmm3, %c[hi](%2)\n\t" \
+        "shufps     $0x1b, %%xmm2, %%xmm2\n\t" \
+        "movups     %c[w2lo](%3), %%xmm3\n\t" \
+        "mulps      %%xmm2, %%xmm3\n\t" \
+        "movups     %%xmm3, %c[lo](%2)\n\t" \
+        "movups     %c[hi](%3), %%xmm3\n\t" \
+        "mulps      %%xmm0, %%xmm3\n\t" \
+        "movups     %c[hi](%1), %%xmm4\n\t" \
+        "addps      %%xmm4, %%xmm3\n\t" \
+        "shufps     $0x1b, %%xmm0, %%xmm0\n\t" \
+        "movups     %c[lo](%3), %%xmm5\n\t" \
+        "mulps      %%xmm0, %%xmm5\n\t" \
+        "movups     %c[lo](%1), %%xmm4\n\t" \
+        "addps      %%xmm4, %%xmm5\n\t" \
+        "movss      %%xmm3, %c[tshi](%4)\n\t" \
+        "movss      %%xmm5, %c[tslo](%4)\n\t" \
+        "shufps     $0x39, %%xmm3, %%xmm3\n\t" \
+        "shufps     $0x39, %%xmm5, %%xmm5\n\t" \
+        "movss      %%xmm3, %c[tshi]+128(%4)\n\t" \
+        "movss      %%xmm5, %c[tslo]+128(%4)\n\t" \
+        "shufps     $0x39, %%xmm3, %%xmm3\n\t" \
+        "shufps     $0x39, %%xmm5, %%xmm5\n\t" \
+        "movss      %%xmm3, %c[tshi]+256(%4)\n\t" \
+        "movss      %%xmm5, %c[tslo]+256(%4)\n\t" \
+        "shufps     $0x39, %%xmm3, %%xmm3\n\t" \
+        "shufps     $0x39, %%xmm5, %%xmm5\n\t" \
+        "movss      %%xmm3, %c[tshi]+384(%4)\n\t" \
+        "movss      %%xmm5, %c[tslo]+384(%4)\n\t" \
+        : \
+        : "r"(r), "r"(o1), "r"(o2), "r"(wintab), "r"(tsbuf), \
+          [r0]"i"(16 * (v0)), [r1]"i"(16 * (v0) + 16), \
+          [r2]"i"(16 * (v0) + 32), [r3]"i"(16 * (v0) + 48), \
+          [hi]"i"(4 * (9 + (v0))), [lo]"i"(4 * (5 - (v0))), \
+          [w2hi]"i"(4 * (27 + (v0))), [w2lo]"i"(4 * (23 - (v0))), \
+          [tshi]"i"(4 * SBLIMIT * (9 + (v0))), \
+          [tslo]"i"(4 * SBLIMIT * (5 - (v0))) \
+        : "memory", "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5")
+
+void dct36_sse(real *inbuf, real *o1, real *o2, real *wintab, real *tsbuf)
+{
+    DECLARE_ALIGNED(16, real, e[9][4]);
+    DECLARE_ALIGNED(16, real, r[9][4]);
+
+    /*
+     * in[i] += in[i-1], then in[i] += in[i-2] for the odd i. Both steps
+     * only read values of the previous step, so they are done on four
+     * samples at once. e[k] gets in[2k] and in[2k+1] in its low lanes.
+     */
+    __asm__ volatile(
+        "movaps     %2, %%xmm7\n\t"
+        "movups     (%1), %%xmm0\n\t"
+        "movaps     %%xmm0, %%xmm3\n\t"
+        "pslldq     $4, %%xmm3\n\t"
+        "addps      %%xmm3, %%xmm0\n\t"
+        "movaps     %%xmm0, %%xmm2\n\t"
+        "pslldq     $8, %%xmm2\n\t"
+        "andps      %%xmm7, %%xmm2\n\t"
+        "addps      %%xmm0, %%xmm2\n\t"
+        "movaps     %%xmm2, (%0)\n\t"
+        "movhlps    %%xmm2, %%xmm2\n\t"
+        "movaps     %%xmm2, 16(%0)\n\t"
+
+        "movups     16(%1), %%xmm1\n\t"
+        "movups     12(%1), %%xmm3\n\t"
+        "addps      %%xmm3, %%xmm1\n\t"
+        "movaps     %%xmm0, %%xmm2\n\t"
+        "shufps     $0x4e, %%xmm1, %%xmm2\n\t"
+        "andps      %%xmm7, %%xmm2\n\t"
+        "addps      %%xmm1, %%xmm2\n\t"
+        "movaps     %%xmm2, 32(%0)\n\t"
+        "movhlps    %%xmm2, %%xmm2\n\t"
+        "movaps     %%xmm2, 48(%0)\n\t"
+
+        "movups     32(%1), %%xmm0\n\t"
+        "movups     28(%1), %%xmm3\n\t"
+        "addps      %%xmm3, %%xmm0\n\t"
+        "movaps     %%xmm1, %%xmm2\n\t"
+        "shufps     $0x4e, %%xmm0, %%xmm2\n\t"
+        "andps      %%xmm7, %%xmm2\n\t"
+        "addps      %%xmm0, %%xmm2\n\t"
+        "movaps     %%xmm2, 64(%0)\n\t"
+        "movhlps    %%xmm2, %%xmm2\n\t"
+        "movaps     %%xmm2, 80(%0)\n\t"
+
+        "movups     48(%1), %%xmm1\n\t"
+        "movups     44(%1), %%xmm3\n\t"
+        "addps      %%xmm3, %%xmm1\n\t"
+        "movaps     %%xmm0, %%xmm2\n\t"
+        "shufps     $0x4e, %%xmm1, %%xmm2\n\t"
+        "andps      %%xmm7, %%xmm2\n\t"
+        "addps      %%xmm1, %%xmm2\n\t"
+        "movaps     %%xmm2, 96(%0)\n\t"
+        "movhlps    %%xmm2, %%xmm2\n\t"
+        "movaps     %%xmm2, 112(%0)\n\t"
+
+        "movsd      64(%1), %%xmm0\n\t"
+        "movsd      60(%1), %%xmm3\n\t"
+        "addps      %%xmm3, %%xmm0\n\t"
+        "movaps     %%xmm1, %%xmm2\n\t"
+        "shufps     $0x4e, %%xmm0, %%xmm2\n\t"
+        "andps      %%xmm7, %%xmm2\n\t"
+        "addps      %%xmm0, %%xmm2\n\t"
+        "movaps     %%xmm2, 128(%0)\n\t"
+        :
+        : "r"(e), "r"(inbuf), "m"(*odd_mask)
+        : "memory", "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7");
+
+    /*
+     * The two 9 point IDCTs, E(j) is e[j/2], K(n) is dct36_sse_const[n].
+     * r[k] gets tmp[k] and tmp[17-k] of dct36.c.
+     */
+#define E(j) #j "*8(%0)"
+#define K(n) #n "*16(%1)"
+#define R(k) #k "*16(%2)"
+    __asm__ volatile(
+        "movaps     "E(12)", %%xmm1\n\t"        /* t1 */
+        "mulps      "K(0)", %%xmm1\n\t"
+        "movaps     "E(8)", %%xmm2\n\t"         /* t2 */
+        "addps      "E(16)", %%xmm2\n\t"
+        "subps      "E(4)", %%xmm2\n\t"
+        "mulps      "K(0)", %%xmm2\n\t"
+        "movaps     "E(0)", %%xmm3\n\t"         /* t3 */
+        "addps      %%xmm1, %%xmm3\n\t"
+        "movaps     "E(0)", %%xmm4\n\t"         /* t4 */
+        "subps      %%xmm1, %%xmm4\n\t"
+        "subps      %%xmm1, %%xmm4\n\t"
+        "movaps     %%xmm4, %%xmm5\n\t"         /* t5 */
+        "subps      %%xmm2, %%xmm5\n\t"
+        "movaps     "E(4)", %%xmm0\n\t"         /* t0 */
+        "addps      "E(8)", %%xmm0\n\t"
+        "mulps      "K(1)", %%xmm0\n\t"
+        "movaps     "E(8)", %%xmm1\n\t"         /* t1 */
+        "subps      "E(16)", %%xmm1\n\t"
+        "mulps      "K(2)", %%xmm1\n\t"
+        "addps      %%xmm2, %%xmm4\n\t"         /* tmp[4] */
+        "addps      %%xmm2, %%xmm4\n\t"
+        "mulps      "K(12)", %%xmm4\n\t"
+        "movaps     %%xmm4, "R(4)"\n\t"
+        "movaps     "E(4)", %%xmm2\n\t"         /* t2 */
+        "addps      "E(16)", %%xmm2\n\t"
+        "mulps      "K(3)", %%xmm2\n\t"
+        "movaps     %%xmm3, %%xmm6\n\t"         /* t6 */
+        "subps      %%xmm0, %%xmm6\n\t"
+        "subps      %%xmm2, %%xmm6\n\t"
+        "movaps     %%xmm3, %%xmm4\n\t"         /* t0 += t3 + t1 */
+        "addps      %%xmm1, %%xmm4\n\t"
+        "addps      %%xmm4, %%xmm0\n\t"
+        "subps      %%xmm1, %%xmm2\n\t"         /* t3 += t2 - t1 */
+        "addps      %%xmm2, %%xmm3\n\t"
+
+        "movaps     "E(2)", %%xmm2\n\t"         /* t2 */
+        "addps      "E(10)", %%xmm2\n\t"
+        "mulps      "K(4)", %%xmm2\n\t"
+        "movaps     "E(10)", %%xmm4\n\t"        /* t4 */
+        "subps      "E(14)", %%xmm4\n\t"
+        "mulps      "K(5)", %%xmm4\n\t"
+        "movaps     "E(6)", %%xmm7\n\t"         /* t7 */
+        "mulps      "K(7)", %%xmm7\n\t"
+        "movaps     %%xmm2, %%xmm1\n\t"         /* t1 */
+        "addps      %%xmm4, %%xmm1\n\t"
+        "addps      %%xmm7, %%xmm1\n\t"
+        "movaps     %%xmm0, "R(8)"\n\t"         /* tmp[0], tmp[8] */
+        "addps      %%xmm1, %%xmm0\n\t"
+        "mulps      "K(8)", %%xmm0\n\t"
+        "movaps     %%xmm0, "R(0)"\n\t"
+        "movaps     "R(8)", %%xmm0\n\t"
+        "subps      %%xmm1, %%xmm0\n\t"
+        "mulps      "K(16)", %%xmm0\n\t"
+        "movaps     %%xmm0, "R(8)"\n\t"
+        "movaps     "E(2)", %%xmm1\n\t"         /* t1 */
+        "addps      "E(14)", %%xmm1\n\t"
+        "mulps      "K(6)", %%xmm1\n\t"
+        "movaps     %%xmm1, %%xmm0\n\t"         /* t2 += t1 - t7 */
+        "subps      %%xmm7, %%xmm0\n\t"
+        "addps      %%xmm0, %%xmm2\n\t"
+        "movaps     %%xmm3, %%xmm0\n\t"         /* tmp[3], tmp[5] */
+        "addps      %%xmm2, %%xmm0\n\t"
+        "mulps      "K(11)", %%xmm0\n\t"
+        "movaps     %%xmm0, "R(3)"\n\t"
+        "subps      %%xmm2, %%xmm3\n\t"
+        "mulps      "K(13)", %%xmm3\n\t"
+        "movaps     %%xmm3, "R(5)"\n\t"
+        "movaps     "E(10)", %%xmm0\n\t"        /* t0 */
+        "addps      "E(14)", %%xmm0\n\t"
+        "subps      "E(2)", %%xmm0\n\t"
+        "mulps      "K(7)", %%xmm0\n\t"
+        "addps      %%xmm7, %%xmm1\n\t"         /* t4 -= t1 + t7 */
+        "subps      %%xmm1, %%xmm4\n\t"
+        "movaps     %%xmm5, %%xmm2\n\t"         /* tmp[1], tmp[7] */
+        "subps      %%xmm0, %%xmm2\n\t"
+        "mulps      "K(9)", %%xmm2\n\t"
+        "movaps     %%xmm2, "R(1)"\n\t"
+        "addps      %%xmm0, %%xmm5\n\t"
+        "mulps      "K(15)", %%xmm5\n\t"
+        "movaps     %%xmm5, "R(7)"\n\t"
+        "movaps     %%xmm6, %%xmm2\n\t"         /* tmp[2], tmp[6] */
+        "addps      %%xmm4, %%xmm2\n\t"
+        "mulps      "K(10)", %%xmm2\n\t"
+        "movaps     %%xmm2, "R(2)"\n\t"
+        "subps      %%xmm4, %%xmm6\n\t"
+        "mulps      "K(14)", %%xmm6\n\t"
+        "movaps     %%xmm6, "R(6)"\n\t"
+        :
+        : "r"(e), "r"(dct36_sse_const), "r"(r)
+        : "memory", "%xmm0", "%xmm1", "%xmm2", "%xmm3",
+          "%xmm4", "%xmm5", "%xmm6", "%xmm7");
+#undef E
+#undef K
+#undef R
+
+    DCT36_WINDOW(0);
+    DCT36_WINDOW(4);
+
+    {
+        real sum0 = r[8][0], sum1 = r[8][1], tmpval;
+
+        o2[17] = (tmpval = sum0 + sum1) * wintab[35];
+        o2[0]  = tmpval * wintab[18];
+        sum0 -= sum1;
+        tsbuf[0]          = o1[0]  + sum0 * wintab[0];
+        tsbuf[SBLIMIT*17] = o1[17] + sum0 * wintab[17];
+    }
+}
@@ -367,3 +367,145 @@ ASMALIGN(4)
         :"memory", "%eax");
     return 0;
 }
+
+#if HAVE_SSE2
+/*
+ * Same as synth_1to1_MMX(), but with one pmaddwd for eight window taps.
+ * The products are summed in a different order, which does not change
+ * the result of the integer additions, so the output is identical.
+ */
+int synth_1to1_SSE2(real *bandPtr, int channel, short *samples)
+{
+    static short buffs[2][2][0x110] __attribute__((aligned(16)));
+    static int bo = 1;
+    short *b0, (*buf)[0x110], *a, *b;
+    const short* window;
+    int bo1, i = 8;
+
+    if (channel == 0) {
+        bo = (bo - 1) & 0xf;
+        buf = buffs[1];
+    } else {
+        samples++;
+        buf = buffs[0];
+    }
+
+    if (bo & 1) {
+        b0 = buf[1];
+        bo1 = bo + 1;
+        a = buf[0] + bo;
+        b = buf[1] + ((bo + 1) & 0xf);
+    } else {
+        b0 = buf[0];
+        bo1 = bo;
+        b = buf[0] + bo;
+        a = buf[1] + ((bo + 1) & 0xf);
+    }
+
+    dct64_MMX_func(a, b, bandPtr);
+    window = mp3lib_decwins + 16 - bo1;
+__asm__ volatile(
+ASMALIGN(4)
+"0:\n\t"
+        "movdqu  (%1),%%xmm0\n\t"
+        "movdqu  16(%1),%%xmm1\n\t"
+        "movdqu  64(%1),%%xmm2\n\t"
+        "movdqu  80(%1),%%xmm3\n\t"
+        "pmaddwd (%2),%%xmm0\n\t"
+        "pmaddwd 16(%2),%%xmm1\n\t"
+        "pmaddwd 32(%2),%%xmm2\n\t"
+        "pmaddwd 48(%2),%%xmm3\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "paddd   %%xmm3,%%xmm2\n\t"
+        "movdqa  %%xmm0,%%xmm1\n\t"
+        "punpckldq %%xmm2,%%xmm0\n\t"
+        "punpckhdq %%xmm2,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0x4e,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "psrad   $13,%%xmm0\n\t"
+        "packssdw %%xmm0,%%xmm0\n\t"
+        "movd    %%xmm0,%%eax\n\t"
+        "movw    %%ax,(%3)\n\t"
+        "shrl    $16,%%eax\n\t"
+        "movw    %%ax,4(%3)\n\t"
+
+        "add $128,%1\n\t"
+        "add $64,%2\n\t"
+        "add $8,%3\n\t"
+
+        "decl %0\n\t"
+        "jnz  0b\n\t"
+
+        "movdqu  (%1),%%xmm0\n\t"
+        "movdqu  16(%1),%%xmm1\n\t"
+        "pmaddwd (%2),%%xmm0\n\t"
+        "pmaddwd 16(%2),%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0x4e,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0xb1,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "psrad   $13,%%xmm0\n\t"
+        "packssdw %%xmm0,%%xmm0\n\t"
+        "movd    %%xmm0,%%eax\n\t"
+        "movw    %%ax,(%3)\n\t"
+        "add $64,%1\n\t"
+        "sub $32,%2\n\t"
+        "add $4,%3\n\t"
+
+        "movl $7,%0\n\t"
+ASMALIGN(4)
+"1:\n\t"
+        "movdqu  (%1),%%xmm0\n\t"
+        "movdqu  16(%1),%%xmm1\n\t"
+        "movdqu  64(%1),%%xmm2\n\t"
+        "movdqu  80(%1),%%xmm3\n\t"
+        "pmaddwd (%2),%%xmm0\n\t"
+        "pmaddwd 16(%2),%%xmm1\n\t"
+        "pmaddwd -32(%2),%%xmm2\n\t"
+        "pmaddwd -16(%2),%%xmm3\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "paddd   %%xmm3,%%xmm2\n\t"
+        "movdqa  %%xmm0,%%xmm1\n\t"
+        "punpckldq %%xmm2,%%xmm0\n\t"
+        "punpckhdq %%xmm2,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0x4e,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "psrad   $13,%%xmm0\n\t"
+        "packssdw %%xmm0,%%xmm0\n\t"
+        "pxor    %%xmm1,%%xmm1\n\t"
+        "psubsw  %%xmm0,%%xmm1\n\t"
+        "movd    %%xmm1,%%eax\n\t"
+        "movw    %%ax,(%3)\n\t"
+        "shrl    $16,%%eax\n\t"
+        "movw    %%ax,4(%3)\n\t"
+
+        "add $128,%1\n\t"
+        "sub $64,%2\n\t"
+        "add $8,%3\n\t"
+        "decl %0\n\t"
+        "jnz  1b\n\t"
+
+        "movdqu  (%1),%%xmm0\n\t"
+        "movdqu  16(%1),%%xmm1\n\t"
+        "pmaddwd (%2),%%xmm0\n\t"
+        "pmaddwd 16(%2),%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0x4e,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "pshufd  $0xb1,%%xmm0,%%xmm1\n\t"
+        "paddd   %%xmm1,%%xmm0\n\t"
+        "psrad   $13,%%xmm0\n\t"
+        "packssdw %%xmm0,%%xmm0\n\t"
+        "pxor    %%xmm1,%%xmm1\n\t"
+        "psubsw  %%xmm0,%%xmm1\n\t"
+        "movd    %%xmm1,%%eax\n\t"
+        "movw    %%ax,(%3)\n\t"
+        :"+r"(i), "+r"(window), "+r"(b0), "+r"(samples)
+        :
+        :"memory", "%eax", "%xmm0", "%xmm1", "%xmm2", "%xmm3");
+    return 0;
+}
+#endif
@@ -38,6 +38,10 @@ static real gainpow2[256+118+4];
 real   COS9[9];
 static real COS6_1,COS6_2;
 real   tfcos36[9];
+#if HAVE_SSE2
+/* repeated for all four lanes, see dct36_sse.c */
+real __attribute__((aligned(16))) dct36_sse_const[17][4];
+#endif
 
 static real tfcos12[3];
 #define NEW_DCT9
@@ -174,6 +178,19 @@ static void init_layer3(int down_sample_sblimit)
   cos18[2] = cos(13.0*M_PI/18.0);
 #endif
 
+#if HAVE_SSE2
+  for(j=0;j<4;j++) {
+    dct36_sse_const[0][j] = COS6_2;
+    for(i=0;i<3;i++) {
+      dct36_sse_const[1+i][j] = cos9[i];
+      dct36_sse_const[4+i][j] = cos18[i];
+    }
+    dct36_sse_const[7][j] = COS6_1;
+    for(i=0;i<9;i++)
+      dct36_sse_const[8+i][j] = j & 1 ? tfcos36[i] : 1.0;
+  }
+#endif
+
   for(i=0;i<12;i++)
   {
     win[2][i]  = 0.5 * sin( M_PI / 24.0 * (double) (2*i+1) ) / cos ( M_PI * (double) (2*i+7) / 24.0 );
@@ -4,6 +4,8 @@
 #define MPLAYER_MP3LIB_MP3_H
 
 /* decoder level: */
+/* maximum output of one frame: 1152 stereo samples */
+#define MP3_FRAME_MAXBYTES (1152*2*2)
 #ifdef CONFIG_FAKE_MONO
 void MP3_Init(int fakemono);
 #else
@@ -14,6 +16,7 @@ void MP3_SeekFrame(int num, int dir);
 void MP3_SeekForward(int num);
 int MP3_PrintTAG(void);
 int MP3_DecodeFrame(unsigned char *hova, short single);
+int MP3_DecodeFrames(unsigned char *hova, int minlen, int maxlen);
 int MP3_FillBuffers(void);
 void MP3_PrintHeader(void);
 void MP3_Close(void);
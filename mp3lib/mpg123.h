@@ -123,6 +123,7 @@ extern real *mp3lib_pnts[];
 
 int synth_1to1_pent( real *, int, short * );
 int synth_1to1_MMX( real *, int, short * );
+int synth_1to1_SSE2( real *, int, short * );
 int synth_1to1_MMX_s(real *, int, short *, short *, int *);
 
 void dct36_3dnow(real *, real *, real *, real *, real *);
@@ -438,6 +438,15 @@ void MP3_Init(void){
     if (gCpuCaps.hasSSE)
     {
         dct64_MMX_func = dct64_sse;
+#if HAVE_SSE2
+        if (gCpuCaps.hasSSE2)
+        {
+            synth_func = synth_1to1_SSE2;
+            dct36_func = dct36_sse;
+            mp_msg(MSGT_DECAUDIO,MSGL_V,"mp3lib: using SSE2 optimized decore!\n");
+        }
+        else
+#endif
         mp_msg(MSGT_DECAUDIO,MSGL_V,"mp3lib: using SSE optimized decore!\n");
     }
     else
@@ -540,6 +549,20 @@ int MP3_DecodeFrame(unsigned char *hova,short single){
    return pcm_point ? pcm_point : 2;
 }
 
+// Decode frames until at least minlen bytes are output, as long as the
+// next frame surely fits in maxlen bytes. The first frame is always
+// decoded. Returns the number of bytes, 0 on EOF.
+int MP3_DecodeFrames(unsigned char *hova,int minlen,int maxlen){
+   int len=0, ret;
+   do {
+     ret=MP3_DecodeFrame(hova+len,-1);
+     if(!ret) break;
+     len+=pcm_point;
+   } while(len<minlen && len+MP3_FRAME_MAXBYTES<=maxlen);
+   if(!len && ret) return 2; // like MP3_DecodeFrame() without output
+   return len;
+}
+
 // Prints last frame header in ascii.
 void MP3_PrintHeader(void){
         static char *modes[4] = { "Stereo", "Joint-Stereo", "Dual-Channel", "Single-Channel" };
@@ -245,6 +245,20 @@ static m_time_size_t end_at = { .type = END_AT_NONE, .pos = 0 };
 // A/V sync:
        int autosync=0; // 30 might be a good default value.
 
+// live streams:
+float live_latency=0;  // latency to keep, 0 disables the live mode
+float live_speedup=0;  // largest playback speed increase to catch up with
+float live_skip=1.0;   // skip ahead if this much later than live_latency
+
+static struct {
+    int active;
+    unsigned next_check;  // GetTimerMS() of the next latency estimate
+    off_t pos;            // start of the current byte rate measurement
+    double pts;
+    double byterate;      // stream bytes per second of playback
+    float speed;          // playback speed before catching up, 0 if not
+} live;
+
 // may be changed by GUI:  (FIXME!)
 float rel_seek_secs=0;
 int abs_seek_pos=0;
@@ -2113,7 +2127,9 @@ static int fill_audio_out_buffers(void)
 	// this is where mplayer sleeps during audio-only playback
 	// to avoid 100% CPU use
 	sleep_time = (ao_data.outburst - bytes_to_write) * 1000 / ao_data.bps;
-	if (sleep_time < 10) sleep_time = 10; // limit to 100 wakeups per second
+	// limit to 100 wakeups per second unless a low latency was requested
+	if (sleep_time < (ao_target_latency ? 1 : 10))
+	    sleep_time = ao_target_latency ? 1 : 10;
 	usec_sleep(sleep_time * 1000);
     }
 
@@ -2121,6 +2137,9 @@ static int fill_audio_out_buffers(void)
 	playsize = bytes_to_write;
 	if (playsize > MAX_OUTBURST)
 	    playsize = MAX_OUTBURST;
+	// in low latency mode decode and filter one ao period at a time
+	if (ao_target_latency && playsize > ao_data.outburst)
+	    playsize = ao_data.outburst;
 	bytes_to_write -= playsize;
 
 	// Fill buffer if needed:
@@ -2176,6 +2195,9 @@ static int sleep_until_update(float *time_frame, float *aq_sleep_time)
 
     if (mpctx->sh_audio && !mpctx->d_audio->eof) {
 	float delay = mpctx->audio_out->get_delay();
+	// a low target latency leaves less than 100 ms in the ao buffer
+	float min_delay = ao_target_latency && ao_target_latency < 100 ?
+			  ao_target_latency / 1000.0 : 0.10;
 	mp_dbg(MSGT_AVSYNC, MSGL_DBG2, "delay=%f\n", delay);
 
 	if (autosync) {
@@ -2197,7 +2219,7 @@ static int sleep_until_update(float *time_frame, float *aq_sleep_time)
 
 	// delay = amount of audio buffered in soundcard/driver
 	if (delay > 0.25) delay=0.25; else
-	if (delay < 0.10) delay=0.10;
+	if (delay < min_delay) delay=min_delay;
 	if (*time_frame > delay*0.6) {
 	    // sleep time too big - may cause audio drops (buffer underrun)
 	    frame_time_remaining = 1;
@@ -2540,15 +2562,9 @@ static void edl_update(MPContext *mpctx)
 }
 
 
-// style & SEEK_ABSOLUTE == 0 means seek relative to current position, == 1 means absolute
-// style & SEEK_FACTOR == 0 means amount in seconds, == 2 means fraction of file length
-// return -1 if seek failed (non-seekable stream?), 0 otherwise
-static int seek(MPContext *mpctx, double amount, int style)
+// Drop the decoded and buffered data after the demuxer changed position.
+static void reset_playback(MPContext *mpctx)
 {
-    current_module = "seek";
-    if (demux_seek(mpctx->demuxer, amount, audio_delay, style) == 0)
-	return -1;
-
     mpctx->startup_decode_retry = DEFAULT_STARTUP_DECODE_RETRY;
     if (mpctx->sh_video) {
 	current_module = "seek_video_reset";
@@ -2583,11 +2599,142 @@ static int seek(MPContext *mpctx, double amount, int style)
     max_pts_correction = 0.1;
     audio_time_usage = 0; video_time_usage = 0; vout_time_usage = 0;
     drop_frame_cnt = 0;
+}
+
+// style & SEEK_ABSOLUTE == 0 means seek relative to current position, == 1 means absolute
+// style & SEEK_FACTOR == 0 means amount in seconds, == 2 means fraction of file length
+// return -1 if seek failed (non-seekable stream?), 0 otherwise
+static int seek(MPContext *mpctx, double amount, int style)
+{
+    current_module = "seek";
+    if (demux_seek(mpctx->demuxer, amount, audio_delay, style) == 0)
+	return -1;
+
+    reset_playback(mpctx);
 
     current_module = NULL;
     return 0;
 }
 
+static void live_init(MPContext *mpctx)
+{
+    stream_t *stream = mpctx->stream;
+
+    if (live.speed) {
+        playback_speed = live.speed;
+        build_afilter_chain(mpctx->sh_audio, &ao_data);
+    }
+    memset(&live, 0, sizeof(live));
+    live.pts = MP_NOPTS_VALUE;
+    // only streams that can not be seeked are played live
+    live.active = live_latency > 0 &&
+                  (stream->type == STREAMTYPE_DVB ||
+                   (stream->type == STREAMTYPE_STREAM &&
+                    !(stream->flags & MP_STREAM_SEEK_FW)));
+}
+
+static void live_set_speed(MPContext *mpctx, float speed)
+{
+    // keep the pitch while catching up
+    if (mpctx->sh_audio && !af_get(mpctx->mixer.afilter, "scaletempo"))
+        af_add(mpctx->mixer.afilter, "scaletempo");
+    playback_speed = speed;
+    build_afilter_chain(mpctx->sh_audio, &ao_data);
+}
+
+/**
+ * \brief Keep the playback of a live stream close to the received data.
+ *
+ * The latency is estimated from the data buffered in the socket, the cache,
+ * the stream and the demuxer, using the byte rate of the stream, plus the
+ * audio buffered in the ao. If it is too large the buffered data is
+ * skipped, if it is a bit too large playback is sped up until it is not.
+ */
+static void live_update(MPContext *mpctx)
+{
+    stream_t *stream = mpctx->demuxer->stream;
+    unsigned now = GetTimerMS();
+    demux_stream_t *ds;
+    double pts, queued, behind, excess, delay = 0;
+    off_t pos, buffered;
+
+    if (!live.active || (int)(now - live.next_check) < 0)
+        return;
+    live.next_check = now + 500;
+
+    if (mpctx->sh_video)
+        pts = mpctx->sh_video->pts;
+    else if (mpctx->sh_audio)
+        pts = playing_audio_pts(mpctx->sh_audio, mpctx->d_audio,
+                                mpctx->audio_out);
+    else
+        return;
+    pos = stream_tell(stream);
+    if (live.pts == MP_NOPTS_VALUE || pts == MP_NOPTS_VALUE ||
+        pts < live.pts || pts > live.pts + 30 || pos < live.pos) {
+        // first call or a discontinuity, start over
+        live.pos = pos;
+        live.pts = pts;
+        return;
+    }
+    if (pts - live.pts >= 2) {
+        double rate = (pos - live.pos) / (pts - live.pts);
+        live.byterate = live.byterate ? 0.8 * live.byterate + 0.2 * rate : rate;
+        live.pos = pos;
+        live.pts = pts;
+    }
+    if (live.byterate <= 0)
+        return;
+
+    // what is demuxed already is counted from the timestamps, a stream
+    // which the other one lags behind in the file can hold a lot of data
+    ds = mpctx->sh_video ? mpctx->d_video : mpctx->d_audio;
+    queued = 0;
+    if (ds->first && ds->last->pts != MP_NOPTS_VALUE && ds->last->pts > pts)
+        queued = ds->last->pts - pts;
+    else if (ds->first)
+        queued = ds->bytes / live.byterate;
+    buffered = stream->buf_len - stream->buf_pos;
+    if (stream->cache_data)
+        buffered += (off_t)cache_fill_status * stream_cache_size * 1024 / 100;
+    stream_control(stream, STREAM_CTRL_GET_RECV_DELAY, &delay);
+    behind = queued + buffered / live.byterate + delay;
+    if (mpctx->sh_audio)
+        behind += mpctx->audio_out->get_delay();
+    excess = behind - live_latency;
+    mp_msg(MSGT_CPLAYER, MSGL_DBG2, "live: %.2f s behind, %.0f bytes/s\n",
+           behind, live.byterate);
+
+    if (excess > live_skip) {
+        // the demuxed packets are dropped, the rest is skipped in the stream
+        off_t len = (excess - queued) * live.byterate;
+        off_t avail = buffered + delay * live.byterate;
+        if (len > avail)
+            len = avail;
+        if (len < 0)
+            len = 0;
+        mp_msg(MSGT_CPLAYER, MSGL_V, "live: %.2f s behind, skipping %.2f s\n",
+               behind, queued + len / live.byterate);
+        if (demux_skip_bytes(mpctx->demuxer, len))
+            reset_playback(mpctx);
+        live.pts = MP_NOPTS_VALUE;
+        if (live.speed) {
+            live_set_speed(mpctx, live.speed);
+            live.speed = 0;
+        }
+    } else if (live_speedup > 0) {
+        if (!live.speed && excess > 0.1) {
+            mp_msg(MSGT_CPLAYER, MSGL_V, "live: %.2f s behind, speeding up\n",
+                   behind);
+            live.speed = playback_speed;
+            live_set_speed(mpctx, playback_speed * (1 + live_speedup));
+        } else if (live.speed && excess <= 0) {
+            live_set_speed(mpctx, live.speed);
+            live.speed = 0;
+        }
+    }
+}
+
 /* This preprocessor directive is a hack to generate a mplayer-nomain.o object
  * file for some tools to link against. */
 #ifndef DISABLE_MAIN
@@ -3549,6 +3696,8 @@ if(1 || mpctx->sh_video) {
 
 if (mpctx->global_sub_size) {
   select_subtitle(mpctx);
+  if(subdata && stream_dump_type)
+    sub_wait(subdata);
   if(subdata)
     switch (stream_dump_type) {
         case 3: list_sub_file(subdata); break;
@@ -3723,6 +3872,8 @@ if (seek_to_sec) {
     end_at.pos += seek_to_sec;
 }
 
+live_init(mpctx);
+
 if (end_at.type == END_AT_SIZE) {
     mp_msg(MSGT_CPLAYER, MSGL_WARN, MSGTR_MPEndposNoSizeBased);
     end_at.type = END_AT_NONE;
@@ -3964,6 +4115,8 @@ if(rel_seek_secs || abs_seek_pos){
   edl_decision = 0;
 }
 
+  live_update(mpctx);
+
 #ifdef CONFIG_GUI
       if(use_gui){
         guiEventHandling();
@@ -37,12 +37,17 @@
 #include <unistd.h>
 #include <string.h>
 #include <math.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "libvo/video_out.h"
+#include "libvo/osd.h"
 #include "spudec.h"
 #include "vobsub.h"
 #include "libavutil/avutil.h"
 #include "libavutil/intreadwrite.h"
 #include "libswscale/swscale.h"
+#include "libmpcodecs/vf_scale.h"
 
 /* Valid values for spu_aamode:
    0: none (fastest, most ugly)
@@ -55,6 +60,7 @@
 int spu_aamode = 3;
 int spu_alignment = -1;
 float spu_gaussvar = 1.0;
+int spu_aa_threads = 1;
 extern int sub_pos;
 
 typedef struct packet_t packet_t;
@@ -96,12 +102,18 @@ typedef struct {
   size_t image_size;		/* Size of the image buffer */
   unsigned char *image;		/* Grayscale value */
   unsigned char *aimage;	/* Alpha value */
+  int num_rects;		/* Non-transparent parts of image */
+  vo_alpha_rect_t rects[VO_ALPHA_MAX_RECTS];
   unsigned int scaled_frame_width, scaled_frame_height;
+  int scaled_aamode;		/* spu_aamode the scaled image was made with */
+  float scaled_gaussvar;	/* spu_gaussvar the scaled image was made with */
   unsigned int scaled_start_col, scaled_start_row;
   unsigned int scaled_width, scaled_height, scaled_stride;
   size_t scaled_image_size;
   unsigned char *scaled_image;
   unsigned char *scaled_aimage;
+  int scaled_num_rects;		/* Non-transparent parts of scaled_image */
+  vo_alpha_rect_t scaled_rects[VO_ALPHA_MAX_RECTS];
   int auto_palette; /* 1 if we lack a palette and must use an heuristic. */
   int font_start_level;  /* Darkest value used for the computed font */
   const vo_functions_t *hw_spu;
@@ -313,6 +325,8 @@ static void spudec_process_data(spudec_handle_t *this, packet_t *packet)
     }
   }
   spudec_cut_image(this);
+  this->num_rects = vo_alpha_find_rects(this->width, this->height, this->aimage,
+                                        this->stride, this->rects, VO_ALPHA_MAX_RECTS);
 }
 
 
@@ -761,18 +775,312 @@ static void scale_image(int x, int y, scale_pixel* table_x, scale_pixel* table_y
   }
 }
 
+/* Intermediate antialiasing. */
+static void scale_rows_approx(spudec_handle_t *spu, unsigned int dxs, unsigned int dys,
+                              unsigned int y0, unsigned int y1)
+{
+  unsigned int x, y;
+  for (y = y0; y < y1; ++y) {
+    const unsigned int unscaled_top = y * spu->orig_frame_height / dys;
+    unsigned int unscaled_bottom = (y + 1) * spu->orig_frame_height / dys;
+    if (unscaled_bottom >= spu->height)
+      unscaled_bottom = spu->height - 1;
+    for (x = 0; x < spu->scaled_width; ++x) {
+      const unsigned int unscaled_left = x * spu->orig_frame_width / dxs;
+      unsigned int unscaled_right = (x + 1) * spu->orig_frame_width / dxs;
+      unsigned int color = 0;
+      unsigned int alpha = 0;
+      unsigned int walkx, walky;
+      unsigned int base, tmp;
+      if (unscaled_right >= spu->width)
+	unscaled_right = spu->width - 1;
+      for (walky = unscaled_top; walky <= unscaled_bottom; ++walky)
+	for (walkx = unscaled_left; walkx <= unscaled_right; ++walkx) {
+	  base = walky * spu->stride + walkx;
+	  tmp = canon_alpha(spu->aimage[base]);
+	  alpha += tmp;
+	  color += tmp * spu->image[base];
+	}
+      base = y * spu->scaled_stride + x;
+      spu->scaled_image[base] = alpha ? color / alpha : 0;
+      spu->scaled_aimage[base] =
+	alpha * (1 + unscaled_bottom - unscaled_top) * (1 + unscaled_right - unscaled_left);
+      /* spu->scaled_aimage[base] =
+	alpha * dxs * dys / spu->orig_frame_width / spu->orig_frame_height; */
+      if (spu->scaled_aimage[base]) {
+	spu->scaled_aimage[base] = 256 - spu->scaled_aimage[base];
+	if (spu->scaled_aimage[base] + spu->scaled_image[base] > 255)
+	  spu->scaled_image[base] = 256 - spu->scaled_aimage[base];
+      }
+    }
+  }
+}
+
+static void scale_rows_full(spudec_handle_t *spu, unsigned int scalex, unsigned int scaley,
+                            unsigned int y0, unsigned int y1)
+{
+  unsigned int x, y;
+  /* Best antialiasing.  Very slow. */
+  /* Any pixel (x, y) represents pixels from the original
+     rectangular region comprised between the columns
+     unscaled_y and unscaled_y + 0x100 / scaley and the rows
+     unscaled_x and unscaled_x + 0x100 / scalex
+
+     The original rectangular region that the scaled pixel
+     represents is cut in 9 rectangular areas like this:
+
+     +---+-----------------+---+
+     | 1 |        2        | 3 |
+     +---+-----------------+---+
+     |   |                 |   |
+     | 4 |        5        | 6 |
+     |   |                 |   |
+     +---+-----------------+---+
+     | 7 |        8        | 9 |
+     +---+-----------------+---+
+
+     The width of the left column is at most one pixel and
+     it is never null and its right column is at a pixel
+     boundary.  The height of the top row is at most one
+     pixel it is never null and its bottom row is at a
+     pixel boundary. The width and height of region 5 are
+     integral values.  The width of the right column is
+     what remains and is less than one pixel.  The height
+     of the bottom row is what remains and is less than
+     one pixel.
+
+     The row above 1, 2, 3 is unscaled_y.  The row between
+     1, 2, 3 and 4, 5, 6 is top_low_row.  The row between 4,
+     5, 6 and 7, 8, 9 is (unsigned int)unscaled_y_bottom.
+     The row beneath 7, 8, 9 is unscaled_y_bottom.
+
+     The column left of 1, 4, 7 is unscaled_x.  The column
+     between 1, 4, 7 and 2, 5, 8 is left_right_column.  The
+     column between 2, 5, 8 and 3, 6, 9 is (unsigned
+     int)unscaled_x_right.  The column right of 3, 6, 9 is
+     unscaled_x_right. */
+  const double inv_scalex = (double) 0x100 / scalex;
+  const double inv_scaley = (double) 0x100 / scaley;
+  for (y = y0; y < y1; ++y) {
+    const double unscaled_y = y * inv_scaley;
+    const double unscaled_y_bottom = unscaled_y + inv_scaley;
+    const unsigned int top_low_row = FFMIN(unscaled_y_bottom, unscaled_y + 1.0);
+    const double top = top_low_row - unscaled_y;
+    const unsigned int height = unscaled_y_bottom > top_low_row
+      ? (unsigned int) unscaled_y_bottom - top_low_row
+      : 0;
+    const double bottom = unscaled_y_bottom > top_low_row
+      ? unscaled_y_bottom - floor(unscaled_y_bottom)
+      : 0.0;
+    for (x = 0; x < spu->scaled_width; ++x) {
+      const double unscaled_x = x * inv_scalex;
+      const double unscaled_x_right = unscaled_x + inv_scalex;
+      const unsigned int left_right_column = FFMIN(unscaled_x_right, unscaled_x + 1.0);
+      const double left = left_right_column - unscaled_x;
+      const unsigned int width = unscaled_x_right > left_right_column
+	? (unsigned int) unscaled_x_right - left_right_column
+	: 0;
+      const double right = unscaled_x_right > left_right_column
+	? unscaled_x_right - floor(unscaled_x_right)
+	: 0.0;
+      double color = 0.0;
+      double alpha = 0.0;
+      double tmp;
+      unsigned int base;
+      /* Now use these informations to compute a good alpha,
+	 and lightness.  The sum is on each of the 9
+	 region's surface and alpha and lightness.
+
+	transformed alpha = sum(surface * alpha) / sum(surface)
+	transformed color = sum(surface * alpha * color) / sum(surface * alpha)
+      */
+      /* 1: top left part */
+      base = spu->stride * (unsigned int) unscaled_y;
+      tmp = left * top * canon_alpha(spu->aimage[base + (unsigned int) unscaled_x]);
+      alpha += tmp;
+      color += tmp * spu->image[base + (unsigned int) unscaled_x];
+      /* 2: top center part */
+      if (width > 0) {
+	unsigned int walkx;
+	for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
+	  base = spu->stride * (unsigned int) unscaled_y + walkx;
+	  tmp = /* 1.0 * */ top * canon_alpha(spu->aimage[base]);
+	  alpha += tmp;
+	  color += tmp * spu->image[base];
+	}
+      }
+      /* 3: top right part */
+      if (right > 0.0) {
+	base = spu->stride * (unsigned int) unscaled_y + (unsigned int) unscaled_x_right;
+	tmp = right * top * canon_alpha(spu->aimage[base]);
+	alpha += tmp;
+	color += tmp * spu->image[base];
+      }
+      /* 4: center left part */
+      if (height > 0) {
+	unsigned int walky;
+	for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
+	  base = spu->stride * walky + (unsigned int) unscaled_x;
+	  tmp = left /* * 1.0 */ * canon_alpha(spu->aimage[base]);
+	  alpha += tmp;
+	  color += tmp * spu->image[base];
+	}
+      }
+      /* 5: center part */
+      if (width > 0 && height > 0) {
+	unsigned int walky;
+	for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
+	  unsigned int walkx;
+	  base = spu->stride * walky;
+	  for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
+	    tmp = /* 1.0 * 1.0 * */ canon_alpha(spu->aimage[base + walkx]);
+	    alpha += tmp;
+	    color += tmp * spu->image[base + walkx];
+	  }
+	}
+      }
+      /* 6: center right part */
+      if (right > 0.0 && height > 0) {
+	unsigned int walky;
+	for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
+	  base = spu->stride * walky + (unsigned int) unscaled_x_right;
+	  tmp = right /* * 1.0 */ * canon_alpha(spu->aimage[base]);
+	  alpha += tmp;
+	  color += tmp * spu->image[base];
+	}
+      }
+      /* 7: bottom left part */
+      if (bottom > 0.0) {
+	base = spu->stride * (unsigned int) unscaled_y_bottom + (unsigned int) unscaled_x;
+	tmp = left * bottom * canon_alpha(spu->aimage[base]);
+	alpha += tmp;
+	color += tmp * spu->image[base];
+      }
+      /* 8: bottom center part */
+      if (width > 0 && bottom > 0.0) {
+	unsigned int walkx;
+	base = spu->stride * (unsigned int) unscaled_y_bottom;
+	for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
+	  tmp = /* 1.0 * */ bottom * canon_alpha(spu->aimage[base + walkx]);
+	  alpha += tmp;
+	  color += tmp * spu->image[base + walkx];
+	}
+      }
+      /* 9: bottom right part */
+      if (right > 0.0 && bottom > 0.0) {
+	base = spu->stride * (unsigned int) unscaled_y_bottom + (unsigned int) unscaled_x_right;
+	tmp = right * bottom * canon_alpha(spu->aimage[base]);
+	alpha += tmp;
+	color += tmp * spu->image[base];
+      }
+      /* Finally mix these transparency and brightness information suitably */
+      base = spu->scaled_stride * y + x;
+      spu->scaled_image[base] = alpha > 0 ? color / alpha : 0;
+      spu->scaled_aimage[base] = alpha * scalex * scaley / 0x10000;
+      if (spu->scaled_aimage[base]) {
+	spu->scaled_aimage[base] = 256 - spu->scaled_aimage[base];
+	if (spu->scaled_aimage[base] + spu->scaled_image[base] > 255)
+	  spu->scaled_image[base] = 256 - spu->scaled_aimage[base];
+      }
+    }
+  }
+}
+
+static void scale_rows_bilinear(spudec_handle_t *spu, scale_pixel *table_x, scale_pixel *table_y,
+                                unsigned int y0, unsigned int y1)
+{
+  unsigned int x, y;
+  for (y = y0; y < y1; y++)
+    for (x = 0; x < spu->scaled_width; x++)
+      scale_image(x, y, table_x, table_y, spu);
+}
+
+typedef struct {
+  spudec_handle_t *spu;
+  int mode;
+  unsigned int dxs, dys, scalex, scaley;
+  scale_pixel *table_x, *table_y;
+  unsigned int y0, y1;
+} scale_job_t;
+
+static void *scale_rows(void *arg)
+{
+  scale_job_t *job = arg;
+  switch (job->mode) {
+  case 1:
+    scale_rows_approx(job->spu, job->dxs, job->dys, job->y0, job->y1);
+    break;
+  case 2:
+    scale_rows_full(job->spu, job->scalex, job->scaley, job->y0, job->y1);
+    break;
+  case 3:
+    scale_rows_bilinear(job->spu, job->table_x, job->table_y, job->y0, job->y1);
+    break;
+  }
+  return NULL;
+}
+
+#define MAX_SPU_AA_THREADS 16
+
+/* Every scaled row only depends on the source image, so with -spuaathreads
+   the rows are split into bands that are scaled concurrently. */
+static void scale_rows_threaded(spudec_handle_t *spu, int mode,
+                                unsigned int dxs, unsigned int dys,
+                                unsigned int scalex, unsigned int scaley,
+                                scale_pixel *table_x, scale_pixel *table_y)
+{
+  scale_job_t jobs[MAX_SPU_AA_THREADS];
+  int threads = av_clip(spu_aa_threads, 1, MAX_SPU_AA_THREADS);
+  int i;
+#if HAVE_PTHREADS
+  pthread_t tid[MAX_SPU_AA_THREADS];
+  int started[MAX_SPU_AA_THREADS];
+#endif
+
+  if (threads > spu->scaled_height)
+    threads = spu->scaled_height;
+  for (i = 0; i < threads; i++) {
+    jobs[i].spu = spu;
+    jobs[i].mode = mode;
+    jobs[i].dxs = dxs;
+    jobs[i].dys = dys;
+    jobs[i].scalex = scalex;
+    jobs[i].scaley = scaley;
+    jobs[i].table_x = table_x;
+    jobs[i].table_y = table_y;
+    jobs[i].y0 = spu->scaled_height *  i      / threads;
+    jobs[i].y1 = spu->scaled_height * (i + 1) / threads;
+  }
+#if HAVE_PTHREADS
+  for (i = 1; i < threads; i++)
+    started[i] = !pthread_create(&tid[i], NULL, scale_rows, &jobs[i]);
+  scale_rows(&jobs[0]);
+  for (i = 1; i < threads; i++) {
+    if (started[i])
+      pthread_join(tid[i], NULL);
+    else
+      scale_rows(&jobs[i]);
+  }
+#else
+  for (i = 0; i < threads; i++)
+    scale_rows(&jobs[i]);
+#endif
+}
+
 static void sws_spu_image(unsigned char *d1, unsigned char *d2, int dw, int dh,
                           int ds, unsigned char *s1, unsigned char *s2, int sw,
                           int sh, int ss)
 {
 	struct SwsContext *ctx;
+	const uint8_t *src[1];
 	static SwsFilter filter;
 	static int firsttime = 1;
 	static float oldvar;
+	unsigned char *alpha;
 	int i;
 
-	if (!firsttime && oldvar != spu_gaussvar) sws_freeVec(filter.lumH);
-	if (firsttime) {
+	if (firsttime || oldvar != spu_gaussvar) {
+		if (!firsttime) sws_freeVec(filter.lumH);
 		filter.lumH = filter.lumV =
 			filter.chrH = filter.chrV = sws_getGaussianVec(spu_gaussvar, 3.0);
 		sws_normalizeVec(filter.lumH, 1.0);
@@ -780,12 +1088,21 @@ static void sws_spu_image(unsigned char *d1, unsigned char *d2, int dw, int dh,
 		oldvar = spu_gaussvar;
 	}
 
-	ctx=sws_getContext(sw, sh, PIX_FMT_GRAY8, dw, dh, PIX_FMT_GRAY8, SWS_GAUSS, &filter, NULL, NULL);
-	sws_scale(ctx,&s1,&ss,0,sh,&d1,&ds);
-	for (i=ss*sh-1; i>=0; i--) if (!s2[i]) s2[i] = 255; //else s2[i] = 1;
-	sws_scale(ctx,&s2,&ss,0,sh,&d2,&ds);
+	/* the source alpha must stay intact, the image may be rescaled later */
+	alpha = malloc(ss*sh);
+	if (!alpha) {
+		mp_msg(MSGT_SPUDEC, MSGL_FATAL, "Fatal: sws_spu_image: malloc failed\n");
+		return;
+	}
+	ctx=sws_acquireContext(sw, sh, PIX_FMT_GRAY8, dw, dh, PIX_FMT_GRAY8, SWS_GAUSS, &filter, NULL, NULL);
+	src[0] = s1;
+	sws_scale(ctx,src,&ss,0,sh,&d1,&ds);
+	for (i=ss*sh-1; i>=0; i--) alpha[i] = s2[i] ? s2[i] : 255;
+	src[0] = alpha;
+	sws_scale(ctx,src,&ss,0,sh,&d2,&ds);
 	for (i=ds*dh-1; i>=0; i--) if (d2[i]==0) d2[i] = 1; else if (d2[i]==255) d2[i] = 0;
-	sws_freeContext(ctx);
+	sws_releaseContext(ctx);
+	free(alpha);
 }
 
 void spudec_draw_scaled(void *me, unsigned int dxs, unsigned int dys, void (*draw_alpha)(int x0,int y0, int w,int h, unsigned char* src, unsigned char *srca, int stride))
@@ -805,13 +1122,17 @@ void spudec_draw_scaled(void *me, unsigned int dxs, unsigned int dys, void (*dra
 	|| (spu->orig_frame_width == dxs && spu->orig_frame_height == dys))) {
       if (spu->image)
       {
-	draw_alpha(spu->start_col, spu->start_row, spu->width, spu->height,
-		   spu->image, spu->aimage, spu->stride);
+	vo_draw_alpha_rects(spu->start_col, spu->start_row, spu->image, spu->aimage,
+			    spu->stride, spu->rects, spu->num_rects, draw_alpha);
 	spu->spu_changed = 0;
       }
     }
     else {
-      if (spu->scaled_frame_width != dxs || spu->scaled_frame_height != dys) {	/* Resizing is needed */
+      /* The scaled image is kept until the next packet is decoded or the
+         target size or scaling parameters change. */
+      if (spu->scaled_frame_width != dxs || spu->scaled_frame_height != dys
+          || spu->scaled_aamode != spu_aamode
+          || ((spu_aamode&15) == 4 && spu->scaled_gaussvar != spu_gaussvar)) {	/* Resizing is needed */
 	/* scaled_x = scalex * x / 0x100
 	   scaled_y = scaley * y / 0x100
 	   order of operations is important because of rounding. */
@@ -850,12 +1171,11 @@ void spudec_draw_scaled(void *me, unsigned int dxs, unsigned int dys, void (*dra
 	  table_y = calloc(spu->scaled_height, sizeof(scale_pixel));
 	  if (!table_x || !table_y) {
 	    mp_msg(MSGT_SPUDEC, MSGL_FATAL, "Fatal: spudec_draw_scaled: calloc failed\n");
+	  } else {
+	    scale_table(0, 0, spu->width - 1, spu->scaled_width - 1, table_x);
+	    scale_table(0, 0, spu->height - 1, spu->scaled_height - 1, table_y);
+	    scale_rows_threaded(spu, 3, dxs, dys, scalex, scaley, table_x, table_y);
 	  }
-	  scale_table(0, 0, spu->width - 1, spu->scaled_width - 1, table_x);
-	  scale_table(0, 0, spu->height - 1, spu->scaled_height - 1, table_y);
-	  for (y = 0; y < spu->scaled_height; y++)
-	    for (x = 0; x < spu->scaled_width; x++)
-	      scale_image(x, y, table_x, table_y, spu);
 	  free(table_x);
 	  free(table_y);
 	  break;
@@ -873,211 +1193,9 @@ void spudec_draw_scaled(void *me, unsigned int dxs, unsigned int dys, void (*dra
 	  }
 	  break;
 	  case 1:
-	  {
-	    /* Intermediate antialiasing. */
-	    for (y = 0; y < spu->scaled_height; ++y) {
-	      const unsigned int unscaled_top = y * spu->orig_frame_height / dys;
-	      unsigned int unscaled_bottom = (y + 1) * spu->orig_frame_height / dys;
-	      if (unscaled_bottom >= spu->height)
-		unscaled_bottom = spu->height - 1;
-	      for (x = 0; x < spu->scaled_width; ++x) {
-		const unsigned int unscaled_left = x * spu->orig_frame_width / dxs;
-		unsigned int unscaled_right = (x + 1) * spu->orig_frame_width / dxs;
-		unsigned int color = 0;
-		unsigned int alpha = 0;
-		unsigned int walkx, walky;
-		unsigned int base, tmp;
-		if (unscaled_right >= spu->width)
-		  unscaled_right = spu->width - 1;
-		for (walky = unscaled_top; walky <= unscaled_bottom; ++walky)
-		  for (walkx = unscaled_left; walkx <= unscaled_right; ++walkx) {
-		    base = walky * spu->stride + walkx;
-		    tmp = canon_alpha(spu->aimage[base]);
-		    alpha += tmp;
-		    color += tmp * spu->image[base];
-		  }
-		base = y * spu->scaled_stride + x;
-		spu->scaled_image[base] = alpha ? color / alpha : 0;
-		spu->scaled_aimage[base] =
-		  alpha * (1 + unscaled_bottom - unscaled_top) * (1 + unscaled_right - unscaled_left);
-		/* spu->scaled_aimage[base] =
-		  alpha * dxs * dys / spu->orig_frame_width / spu->orig_frame_height; */
-		if (spu->scaled_aimage[base]) {
-		  spu->scaled_aimage[base] = 256 - spu->scaled_aimage[base];
-		  if (spu->scaled_aimage[base] + spu->scaled_image[base] > 255)
-		    spu->scaled_image[base] = 256 - spu->scaled_aimage[base];
-		}
-	      }
-	    }
-	  }
-	  break;
 	  case 2:
-	  {
-	    /* Best antialiasing.  Very slow. */
-	    /* Any pixel (x, y) represents pixels from the original
-	       rectangular region comprised between the columns
-	       unscaled_y and unscaled_y + 0x100 / scaley and the rows
-	       unscaled_x and unscaled_x + 0x100 / scalex
-
-	       The original rectangular region that the scaled pixel
-	       represents is cut in 9 rectangular areas like this:
-
-	       +---+-----------------+---+
-	       | 1 |        2        | 3 |
-	       +---+-----------------+---+
-	       |   |                 |   |
-	       | 4 |        5        | 6 |
-	       |   |                 |   |
-	       +---+-----------------+---+
-	       | 7 |        8        | 9 |
-	       +---+-----------------+---+
-
-	       The width of the left column is at most one pixel and
-	       it is never null and its right column is at a pixel
-	       boundary.  The height of the top row is at most one
-	       pixel it is never null and its bottom row is at a
-	       pixel boundary. The width and height of region 5 are
-	       integral values.  The width of the right column is
-	       what remains and is less than one pixel.  The height
-	       of the bottom row is what remains and is less than
-	       one pixel.
-
-	       The row above 1, 2, 3 is unscaled_y.  The row between
-	       1, 2, 3 and 4, 5, 6 is top_low_row.  The row between 4,
-	       5, 6 and 7, 8, 9 is (unsigned int)unscaled_y_bottom.
-	       The row beneath 7, 8, 9 is unscaled_y_bottom.
-
-	       The column left of 1, 4, 7 is unscaled_x.  The column
-	       between 1, 4, 7 and 2, 5, 8 is left_right_column.  The
-	       column between 2, 5, 8 and 3, 6, 9 is (unsigned
-	       int)unscaled_x_right.  The column right of 3, 6, 9 is
-	       unscaled_x_right. */
-	    const double inv_scalex = (double) 0x100 / scalex;
-	    const double inv_scaley = (double) 0x100 / scaley;
-	    for (y = 0; y < spu->scaled_height; ++y) {
-	      const double unscaled_y = y * inv_scaley;
-	      const double unscaled_y_bottom = unscaled_y + inv_scaley;
-	      const unsigned int top_low_row = FFMIN(unscaled_y_bottom, unscaled_y + 1.0);
-	      const double top = top_low_row - unscaled_y;
-	      const unsigned int height = unscaled_y_bottom > top_low_row
-		? (unsigned int) unscaled_y_bottom - top_low_row
-		: 0;
-	      const double bottom = unscaled_y_bottom > top_low_row
-		? unscaled_y_bottom - floor(unscaled_y_bottom)
-		: 0.0;
-	      for (x = 0; x < spu->scaled_width; ++x) {
-		const double unscaled_x = x * inv_scalex;
-		const double unscaled_x_right = unscaled_x + inv_scalex;
-		const unsigned int left_right_column = FFMIN(unscaled_x_right, unscaled_x + 1.0);
-		const double left = left_right_column - unscaled_x;
-		const unsigned int width = unscaled_x_right > left_right_column
-		  ? (unsigned int) unscaled_x_right - left_right_column
-		  : 0;
-		const double right = unscaled_x_right > left_right_column
-		  ? unscaled_x_right - floor(unscaled_x_right)
-		  : 0.0;
-		double color = 0.0;
-		double alpha = 0.0;
-		double tmp;
-		unsigned int base;
-		/* Now use these informations to compute a good alpha,
-                   and lightness.  The sum is on each of the 9
-                   region's surface and alpha and lightness.
-
-		  transformed alpha = sum(surface * alpha) / sum(surface)
-		  transformed color = sum(surface * alpha * color) / sum(surface * alpha)
-		*/
-		/* 1: top left part */
-		base = spu->stride * (unsigned int) unscaled_y;
-		tmp = left * top * canon_alpha(spu->aimage[base + (unsigned int) unscaled_x]);
-		alpha += tmp;
-		color += tmp * spu->image[base + (unsigned int) unscaled_x];
-		/* 2: top center part */
-		if (width > 0) {
-		  unsigned int walkx;
-		  for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
-		    base = spu->stride * (unsigned int) unscaled_y + walkx;
-		    tmp = /* 1.0 * */ top * canon_alpha(spu->aimage[base]);
-		    alpha += tmp;
-		    color += tmp * spu->image[base];
-		  }
-		}
-		/* 3: top right part */
-		if (right > 0.0) {
-		  base = spu->stride * (unsigned int) unscaled_y + (unsigned int) unscaled_x_right;
-		  tmp = right * top * canon_alpha(spu->aimage[base]);
-		  alpha += tmp;
-		  color += tmp * spu->image[base];
-		}
-		/* 4: center left part */
-		if (height > 0) {
-		  unsigned int walky;
-		  for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
-		    base = spu->stride * walky + (unsigned int) unscaled_x;
-		    tmp = left /* * 1.0 */ * canon_alpha(spu->aimage[base]);
-		    alpha += tmp;
-		    color += tmp * spu->image[base];
-		  }
-		}
-		/* 5: center part */
-		if (width > 0 && height > 0) {
-		  unsigned int walky;
-		  for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
-		    unsigned int walkx;
-		    base = spu->stride * walky;
-		    for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
-		      tmp = /* 1.0 * 1.0 * */ canon_alpha(spu->aimage[base + walkx]);
-		      alpha += tmp;
-		      color += tmp * spu->image[base + walkx];
-		    }
-		  }
-		}
-		/* 6: center right part */
-		if (right > 0.0 && height > 0) {
-		  unsigned int walky;
-		  for (walky = top_low_row; walky < (unsigned int) unscaled_y_bottom; ++walky) {
-		    base = spu->stride * walky + (unsigned int) unscaled_x_right;
-		    tmp = right /* * 1.0 */ * canon_alpha(spu->aimage[base]);
-		    alpha += tmp;
-		    color += tmp * spu->image[base];
-		  }
-		}
-		/* 7: bottom left part */
-		if (bottom > 0.0) {
-		  base = spu->stride * (unsigned int) unscaled_y_bottom + (unsigned int) unscaled_x;
-		  tmp = left * bottom * canon_alpha(spu->aimage[base]);
-		  alpha += tmp;
-		  color += tmp * spu->image[base];
-		}
-		/* 8: bottom center part */
-		if (width > 0 && bottom > 0.0) {
-		  unsigned int walkx;
-		  base = spu->stride * (unsigned int) unscaled_y_bottom;
-		  for (walkx = left_right_column; walkx < (unsigned int) unscaled_x_right; ++walkx) {
-		    tmp = /* 1.0 * */ bottom * canon_alpha(spu->aimage[base + walkx]);
-		    alpha += tmp;
-		    color += tmp * spu->image[base + walkx];
-		  }
-		}
-		/* 9: bottom right part */
-		if (right > 0.0 && bottom > 0.0) {
-		  base = spu->stride * (unsigned int) unscaled_y_bottom + (unsigned int) unscaled_x_right;
-		  tmp = right * bottom * canon_alpha(spu->aimage[base]);
-		  alpha += tmp;
-		  color += tmp * spu->image[base];
-		}
-		/* Finally mix these transparency and brightness information suitably */
-		base = spu->scaled_stride * y + x;
-		spu->scaled_image[base] = alpha > 0 ? color / alpha : 0;
-		spu->scaled_aimage[base] = alpha * scalex * scaley / 0x10000;
-		if (spu->scaled_aimage[base]) {
-		  spu->scaled_aimage[base] = 256 - spu->scaled_aimage[base];
-		  if (spu->scaled_aimage[base] + spu->scaled_image[base] > 255)
-		    spu->scaled_image[base] = 256 - spu->scaled_aimage[base];
-		}
-	      }
-	    }
-	  }
+	  scale_rows_threaded(spu, spu_aamode&15, dxs, dys, scalex, scaley, NULL, NULL);
+	  break;
 	  }
 nothing_to_do:
 	  /* Kludge: draw_alpha needs width multiple of 8. */
@@ -1086,8 +1204,13 @@ nothing_to_do:
 	      memset(spu->scaled_aimage + y * spu->scaled_stride + spu->scaled_width, 0,
 		     spu->scaled_stride - spu->scaled_width);
 	    }
+	  spu->scaled_num_rects = vo_alpha_find_rects(spu->scaled_width, spu->scaled_height,
+						      spu->scaled_aimage, spu->scaled_stride,
+						      spu->scaled_rects, VO_ALPHA_MAX_RECTS);
 	  spu->scaled_frame_width = dxs;
 	  spu->scaled_frame_height = dys;
+	  spu->scaled_aamode = spu_aamode;
+	  spu->scaled_gaussvar = spu_gaussvar;
 	}
       }
       if (spu->scaled_image){
@@ -1106,8 +1229,9 @@ nothing_to_do:
           spu->scaled_start_row = dys*sub_pos/100 - spu->scaled_height;
 	  break;
 	}
-	draw_alpha(spu->scaled_start_col, spu->scaled_start_row, spu->scaled_width, spu->scaled_height,
-		   spu->scaled_image, spu->scaled_aimage, spu->scaled_stride);
+	vo_draw_alpha_rects(spu->scaled_start_col, spu->scaled_start_row,
+			    spu->scaled_image, spu->scaled_aimage, spu->scaled_stride,
+			    spu->scaled_rects, spu->scaled_num_rects, draw_alpha);
 	spu->spu_changed = 0;
       }
     }
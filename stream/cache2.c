@@ -260,6 +260,8 @@ static int cache_execute_control(cache_vars_t *s) {
     case STREAM_CTRL_GET_CURRENT_TIME:
     case STREAM_CTRL_SEEK_TO_TIME:
     case STREAM_CTRL_GET_ASPECT_RATIO:
+    case STREAM_CTRL_GET_JITTER:
+    case STREAM_CTRL_GET_RECV_DELAY:
       s->control_res = s->stream->control(s->stream, s->control, &s->control_double_arg);
       break;
     case STREAM_CTRL_SEEK_TO_CHAPTER:
@@ -268,8 +270,12 @@ static int cache_execute_control(cache_vars_t *s) {
     case STREAM_CTRL_GET_NUM_ANGLES:
     case STREAM_CTRL_GET_ANGLE:
     case STREAM_CTRL_SET_ANGLE:
+    case STREAM_CTRL_GET_PACKETS_LOST:
       s->control_res = s->stream->control(s->stream, s->control, &s->control_uint_arg);
       break;
+    case STREAM_CTRL_PRINT_STATS:
+      s->control_res = s->stream->control(s->stream, s->control, NULL);
+      break;
     default:
       s->control_res = STREAM_UNSUPPORTED;
       break;
@@ -325,6 +331,13 @@ void cache_uninit(stream_t *s) {
 #if !FORKED_CACHE
     cache_do_control(s, -2, NULL);
 #else
+    // The counters of the stream are in the child, let it print them.
+    // It may be waiting for data that never comes, so do not wait long.
+    unsigned t = GetTimerMS();
+    c->control = STREAM_CTRL_PRINT_STATS;
+    cache_wakeup(s);
+    while (c->control != -1 && GetTimerMS() - t < 100)
+      usec_sleep(1000);
     kill(s->cache_pid,SIGKILL);
     waitpid(s->cache_pid,NULL,0);
 #endif
@@ -548,6 +561,9 @@ int cache_do_control(stream_t *stream, int cmd, void *arg) {
     case STREAM_CTRL_GET_ASPECT_RATIO:
     case STREAM_CTRL_GET_NUM_ANGLES:
     case STREAM_CTRL_GET_ANGLE:
+    case STREAM_CTRL_GET_PACKETS_LOST:
+    case STREAM_CTRL_GET_JITTER:
+    case STREAM_CTRL_GET_RECV_DELAY:
     case -2:
       s->control = cmd;
       break;
@@ -561,12 +577,15 @@ int cache_do_control(stream_t *stream, int cmd, void *arg) {
     case STREAM_CTRL_GET_TIME_LENGTH:
     case STREAM_CTRL_GET_CURRENT_TIME:
     case STREAM_CTRL_GET_ASPECT_RATIO:
+    case STREAM_CTRL_GET_JITTER:
+    case STREAM_CTRL_GET_RECV_DELAY:
       *(double *)arg = s->control_double_arg;
       break;
     case STREAM_CTRL_GET_NUM_CHAPTERS:
     case STREAM_CTRL_GET_CURRENT_CHAPTER:
     case STREAM_CTRL_GET_NUM_ANGLES:
     case STREAM_CTRL_GET_ANGLE:
+    case STREAM_CTRL_GET_PACKETS_LOST:
       *(unsigned *)arg = s->control_uint_arg;
       break;
     case STREAM_CTRL_SEEK_TO_CHAPTER:
@@ -0,0 +1,204 @@
+/*
+ * Write-behind cache for output streams: data is copied into a ring buffer
+ * and written out by a separate thread, so slow or stalling storage does
+ * not block the encoder.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "config.h"
+#include "mp_msg.h"
+#include "libavutil/common.h"
+#include "stream.h"
+
+typedef struct {
+  unsigned char *buffer;
+  int size;
+  int read_pos;  // start of the data not yet written, used by the thread
+  int fill;      // bytes waiting to be written
+  int error;     // a write failed, everything after it is dropped
+  int quit;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake_writer;
+  pthread_cond_t wake_stream;
+  // the callbacks of the stream we are sitting in front of
+  int (*write_buffer)(stream_t *s, char *buffer, int len);
+  int (*seek)(stream_t *s, off_t pos);
+  void (*close)(stream_t *s);
+} write_cache_t;
+
+static void *writer_thread(void *arg)
+{
+  stream_t *s = arg;
+  write_cache_t *c = s->write_cache;
+
+  pthread_mutex_lock(&c->lock);
+  while (1) {
+    int len, done = 0;
+    while (!c->fill && !c->quit)
+      pthread_cond_wait(&c->wake_writer, &c->lock);
+    if (!c->fill)
+      break;
+    // the region [read_pos, read_pos+len) is not touched by the stream side
+    len = FFMIN(c->fill, c->size - c->read_pos);
+    pthread_mutex_unlock(&c->lock);
+
+    // only this thread sets error, so it may read it without the lock
+    while (done < len && !c->error) {
+      int r = c->write_buffer(s, c->buffer + c->read_pos + done, len - done);
+      if (r <= 0) {
+        mp_msg(MSGT_STREAM, MSGL_ERR, "Write error in output stream cache.\n");
+        pthread_mutex_lock(&c->lock);
+        c->error = 1;
+        pthread_cond_signal(&c->wake_stream);
+        pthread_mutex_unlock(&c->lock);
+      } else
+        done += r;
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->read_pos = (c->read_pos + len) % c->size;
+    c->fill -= len;
+    pthread_cond_signal(&c->wake_stream);
+  }
+  pthread_mutex_unlock(&c->lock);
+  return NULL;
+}
+
+static int flush(write_cache_t *c)
+{
+  int ok;
+  pthread_mutex_lock(&c->lock);
+  while (c->fill)
+    pthread_cond_wait(&c->wake_stream, &c->lock);
+  ok = !c->error;
+  pthread_mutex_unlock(&c->lock);
+  return ok;
+}
+
+static int cache_write_buffer(stream_t *s, char *buffer, int len)
+{
+  write_cache_t *c = s->write_cache;
+  int left = len;
+
+  while (left > 0) {
+    int write_pos, n, error;
+    pthread_mutex_lock(&c->lock);
+    while (c->fill == c->size && !c->error)
+      pthread_cond_wait(&c->wake_stream, &c->lock);
+    write_pos = (c->read_pos + c->fill) % c->size;
+    n = FFMIN(left, c->size - c->fill);
+    error = c->error;
+    pthread_mutex_unlock(&c->lock);
+    if (error)
+      return -1;
+
+    // free space may wrap around the end of the buffer
+    n = FFMIN(n, c->size - write_pos);
+    memcpy(c->buffer + write_pos, buffer, n);
+    buffer += n;
+    left -= n;
+
+    pthread_mutex_lock(&c->lock);
+    c->fill += n;
+    pthread_cond_signal(&c->wake_writer);
+    pthread_mutex_unlock(&c->lock);
+  }
+  return len;
+}
+
+static int cache_seek(stream_t *s, off_t pos)
+{
+  write_cache_t *c = s->write_cache;
+  // muxers seek back to update headers, the data before has to be there
+  if (!flush(c))
+    return 0;
+  return c->seek ? c->seek(s, pos) : 0;
+}
+
+static void cache_close(stream_t *s)
+{
+  write_cache_t *c = s->write_cache;
+
+  pthread_mutex_lock(&c->lock);
+  c->quit = 1;
+  pthread_cond_signal(&c->wake_writer);
+  pthread_mutex_unlock(&c->lock);
+  pthread_join(c->thread, NULL);
+
+  s->write_buffer = c->write_buffer;
+  s->seek = c->seek;
+  s->close = c->close;
+  s->write_cache = NULL;
+  pthread_mutex_destroy(&c->lock);
+  pthread_cond_destroy(&c->wake_writer);
+  pthread_cond_destroy(&c->wake_stream);
+  free(c->buffer);
+  free(c);
+  if (s->close)
+    s->close(s);
+}
+
+int stream_enable_write_cache(stream_t *s, int size)
+{
+  write_cache_t *c;
+
+  if (s->mode != STREAM_WRITE || !s->write_buffer || s->write_cache)
+    return 0;
+  c = calloc(1, sizeof(write_cache_t));
+  if (!c)
+    return 0;
+  c->size = size;
+  c->buffer = malloc(size);
+  if (!c->buffer) {
+    free(c);
+    return 0;
+  }
+  c->write_buffer = s->write_buffer;
+  c->seek = s->seek;
+  c->close = s->close;
+  pthread_mutex_init(&c->lock, NULL);
+  pthread_cond_init(&c->wake_writer, NULL);
+  pthread_cond_init(&c->wake_stream, NULL);
+  s->write_cache = c;
+  if (pthread_create(&c->thread, NULL, writer_thread, s)) {
+    s->write_cache = NULL;
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->wake_writer);
+    pthread_cond_destroy(&c->wake_stream);
+    free(c->buffer);
+    free(c);
+    return 0;
+  }
+  s->write_buffer = cache_write_buffer;
+  s->seek = cache_seek;
+  s->close = cache_close;
+  mp_msg(MSGT_STREAM, MSGL_V, "Output cache size set to %d KiB\n", size / 1024);
+  return 1;
+}
+
+int stream_flush_write_cache(stream_t *s)
+{
+  if (!s->write_cache)
+    return 1;
+  return flush(s->write_cache);
+}
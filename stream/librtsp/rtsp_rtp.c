@@ -43,6 +43,7 @@
 #include "rtsp_rtp.h"
 #include "rtsp_session.h"
 #include "stream/network.h"
+#include "stream/rtp.h"
 #include "stream/freesdp/common.h"
 #include "stream/freesdp/parser.h"
 
@@ -115,6 +116,12 @@ rtp_session_new (void)
   st->rtcp_socket = -1;
   st->control_url = NULL;
   st->count = 0;
+  st->rtp = rtp_state_new ();
+  if (!st->rtp)
+  {
+    free (st);
+    return NULL;
+  }
 
   return st;
 }
@@ -132,6 +139,7 @@ rtp_session_free (struct rtp_rtsp_session_t *st)
 
   if (st->control_url)
     free (st->control_url);
+  rtp_state_free (st->rtp);
   free (st);
 }
 
@@ -31,6 +31,7 @@ struct rtp_rtsp_session_t {
   int rtcp_socket;
   char *control_url;
   int count;
+  struct rtp_state *rtp;
 };
 
 struct rtp_rtsp_session_t *rtp_setup_and_play (rtsp_t* rtsp_session);
@@ -294,7 +294,8 @@ int rtsp_session_read (rtsp_session_t *this, char *data, int len) {
   {
     int l = 0;
 
-    l = read_rtp_from_server (this->rtp_session->rtp_socket, data, len);
+    l = read_rtp_from_server (this->rtp_session->rtp_socket, data, len,
+                              this->rtp_session->rtp);
     /* send RTSP and RTCP keepalive  */
     rtcp_send_rr (this->s, this->rtp_session);
 
@@ -194,12 +194,19 @@ check4proxies( URL_t *url ) {
 	return url_out;
 }
 
-int
-http_send_request( URL_t *url, off_t pos ) {
+/*
+ * Send a request for the bytes pos to end (inclusive) of the url, or from pos
+ * to the end of the file if end is negative. A bounded request is made with
+ * HTTP/1.1 and asks for the connection to be kept open. The request is sent
+ * on fd if it is a connection to the server already, otherwise a new one is
+ * made.
+ */
+static int
+http_send_range_request( int fd, URL_t *url, off_t pos, off_t end ) {
 	HTTP_header_t *http_hdr;
 	URL_t *server_url;
 	char str[256];
-	int fd = -1;
+	int connected = fd >= 0;
 	int ret;
 	int proxy = 0;		// Boolean
 
@@ -229,7 +236,10 @@ http_send_request( URL_t *url, off_t pos ) {
 	if( strcasecmp(url->protocol, "noicyx") )
 	    http_set_field(http_hdr, "Icy-MetaData: 1");
 
-	if(pos>0) {
+	if(end>=0) {
+	    snprintf(str, 256, "Range: bytes=%"PRId64"-%"PRId64, (int64_t)pos, (int64_t)end);
+	    http_set_field(http_hdr, str);
+	} else if(pos>0) {
 	// Extend http_send_request with possibility to do partial content retrieval
 	    snprintf(str, 256, "Range: bytes=%"PRId64"-", (int64_t)pos);
 	    http_set_field(http_hdr, str);
@@ -237,7 +247,12 @@ http_send_request( URL_t *url, off_t pos ) {
 
 	if (network_cookies_enabled) cookies_set( http_hdr, server_url->hostname, server_url->url );
 
-	http_set_field( http_hdr, "Connection: close");
+	if (end>=0) {
+		// HTTP/1.0 servers need not honor keep-alive
+		http_hdr->http_minor_version = 1;
+		http_set_field( http_hdr, "Connection: keep-alive");
+	} else
+		http_set_field( http_hdr, "Connection: close");
 	http_add_basic_authentication( http_hdr, url->username, url->password );
 	if( http_build_request( http_hdr )==NULL ) {
 		goto err_out;
@@ -245,12 +260,12 @@ http_send_request( URL_t *url, off_t pos ) {
 
 	if( proxy ) {
 		if( url->port==0 ) url->port = 8080;			// Default port for the proxy server
-		fd = connect2Server( url->hostname, url->port,1 );
+		if( !connected ) fd = connect2Server( url->hostname, url->port,1 );
 		url_free( server_url );
 		server_url = NULL;
 	} else {
 		if( server_url->port==0 ) server_url->port = 80;	// Default port for the web server
-		fd = connect2Server( server_url->hostname, server_url->port,1 );
+		if( !connected ) fd = connect2Server( server_url->hostname, server_url->port,1 );
 	}
 	if( fd<0 ) {
 		goto err_out;
@@ -267,13 +282,19 @@ http_send_request( URL_t *url, off_t pos ) {
 
 	return fd;
 err_out:
-	if (fd > 0) closesocket(fd);
+	// a connection we were given is the caller's to close
+	if (fd > 0 && !connected) closesocket(fd);
 	http_free(http_hdr);
 	if (proxy && server_url)
 		url_free(server_url);
 	return -1;
 }
 
+int
+http_send_request( URL_t *url, off_t pos ) {
+	return http_send_range_request( -1, url, pos, -1 );
+}
+
 HTTP_header_t *
 http_read_response( int fd ) {
 	HTTP_header_t *http_hdr;
@@ -357,8 +378,8 @@ http_authenticate(HTTP_header_t *http_hdr, URL_t *url, int *auth_retry) {
 	return 0;
 }
 
-int
-http_seek( stream_t *stream, off_t pos ) {
+static int
+http_reconnect( stream_t *stream, off_t pos ) {
 	HTTP_header_t *http_hdr = NULL;
 	int fd;
 	if( stream==NULL ) return 0;
@@ -404,6 +425,259 @@ http_seek( stream_t *stream, off_t pos ) {
 }
 
 
+/*
+ * Once a seekable http stream with a known size has been seeked, it is read
+ * with bounded range requests on a connection that is kept open, so that a
+ * seek does not need a new connection to the server. The request for the
+ * next range is sent before the current one has been received, so that
+ * sequential reading does not wait for its answer either.
+ */
+
+#define HTTP_RANGE_SIZE (256*1024) // bytes asked for by one request
+#define HTTP_SKIP_LIMIT (64*1024)  // read and drop this much rather than make a new request
+
+typedef struct {
+	off_t pos;        // file position of the next body byte on the connection
+	off_t remaining;  // body bytes of the current response not received yet
+	off_t requested;  // end of the ranges asked for so far
+	int close;        // the server closes the connection after this response
+	int buf_pos, buf_len;
+	char buf[BUFFER_SIZE]; // data received after a response header
+} http_range_t;
+
+// Forget the connection and whatever was asked for on it.
+static void
+http_range_reset( stream_t *stream, http_range_t *r ) {
+	if( stream->fd>0 ) closesocket( stream->fd );
+	stream->fd = -1;
+	r->requested = r->pos;
+	r->remaining = 0;
+	r->close = 0;
+	r->buf_pos = r->buf_len = 0;
+}
+
+static int
+http_range_request( stream_t *stream, http_range_t *r ) {
+	off_t end = r->requested+HTTP_RANGE_SIZE;
+	int fd;
+	if( end>stream->end_pos ) end = stream->end_pos;
+	fd = http_send_range_request( stream->fd, stream->streaming_ctrl->url, r->requested, end-1 );
+	if( fd<0 ) return 0;
+	stream->fd = fd;
+	r->requested = end;
+	return 1;
+}
+
+// Receive body bytes of the current response.
+static int
+http_range_recv( stream_t *stream, http_range_t *r, char *buffer, int size ) {
+	int len = size<r->remaining ? size : r->remaining;
+	if( r->buf_pos<r->buf_len ) {
+		if( len>r->buf_len-r->buf_pos ) len = r->buf_len-r->buf_pos;
+		memcpy( buffer, r->buf+r->buf_pos, len );
+		r->buf_pos += len;
+	} else {
+		len = recv( stream->fd, buffer, len, 0 );
+		if( len<=0 ) {
+			http_range_reset( stream, r );
+			return 0;
+		}
+	}
+	r->pos += len;
+	r->remaining -= len;
+	return len;
+}
+
+// Read the header of the next response, returns 0 at the end of the file.
+static int
+http_range_response( stream_t *stream, http_range_t *r ) {
+	HTTP_header_t *http_hdr;
+	const char *field;
+	int64_t start;
+	int ret = -1;
+
+	http_hdr = http_new_header();
+	if( http_hdr==NULL ) return -1;
+	do {
+		if( r->buf_pos>=r->buf_len ) {
+			int len = recv( stream->fd, r->buf, BUFFER_SIZE, 0 );
+			if( len<=0 ) goto out;
+			r->buf_pos = 0;
+			r->buf_len = len;
+		}
+		if( http_response_append( http_hdr, r->buf+r->buf_pos, r->buf_len-r->buf_pos )<0 )
+			goto out;
+		r->buf_pos = r->buf_len;
+	} while( !http_is_header_entire( http_hdr ) );
+	if( http_response_parse( http_hdr )<0 ) goto out;
+	// what follows the header is the start of the body
+	r->buf_pos -= http_hdr->body_size;
+
+	if( mp_msg_test(MSGT_NETWORK,MSGL_DBG2) )
+		http_debug_hdr( http_hdr );
+
+	switch( http_hdr->status_code ) {
+		case 206: // Partial Content
+			field = http_get_field( http_hdr, "Content-Range" );
+			if( field==NULL || sscanf( field, "bytes %"SCNd64"-", &start )!=1 || start!=r->pos ) {
+				mp_msg(MSGT_NETWORK,MSGL_ERR,MSGTR_MPDEMUX_NW_BadContentRange, field ? field : "");
+				break;
+			}
+			field = http_get_field( http_hdr, "Content-Length" );
+			if( field==NULL || (r->remaining = atoll( field ))<=0 ) {
+				r->remaining = 0;
+				break;
+			}
+			field = http_get_field( http_hdr, "Connection" );
+			if( field )
+				r->close = !strcasecmp( field, "close" );
+			else
+				r->close = http_hdr->http_minor_version==0;
+			ret = 1;
+			break;
+		case 200: // OK, the server ignored the range
+			mp_msg(MSGT_NETWORK,MSGL_V,"Server does not support ranges, skipping to %"PRId64".\n", (int64_t)r->pos);
+			start = r->pos;
+			r->pos = 0;
+			r->remaining = stream->end_pos;
+			// the whole file comes on this connection, ask for nothing more
+			r->requested = stream->end_pos;
+			r->close = 1;
+			ret = 1;
+			while( r->pos<start ) {
+				char buf[BUFFER_SIZE];
+				int len = start-r->pos<BUFFER_SIZE ? start-r->pos : BUFFER_SIZE;
+				if( !http_range_recv( stream, r, buf, len ) ) {
+					r->pos = r->requested = start;
+					ret = -1;
+					break;
+				}
+			}
+			break;
+		case 416: // Requested Range Not Satisfiable
+			ret = 0;
+			break;
+		default:
+			mp_msg(MSGT_NETWORK,MSGL_ERR,MSGTR_MPDEMUX_NW_ErrServerReturned, http_hdr->status_code, http_hdr->reason_phrase );
+	}
+out:
+	http_free( http_hdr );
+	return ret;
+}
+
+// Start receiving the next response, asking for it first if needed.
+static int
+http_range_next( stream_t *stream, http_range_t *r ) {
+	while( 1 ) {
+		int reused, ret;
+		if( r->pos>=stream->end_pos ) return 0;
+		if( r->close ) http_range_reset( stream, r );
+		reused = stream->fd>=0;
+		if( r->requested==r->pos && !http_range_request( stream, r ) )
+			ret = -1;
+		else
+			ret = http_range_response( stream, r );
+		if( ret<0 ) http_range_reset( stream, r );
+		// the server may have closed a connection that was idle for too long
+		if( ret>=0 || !reused ) return ret;
+	}
+}
+
+static int
+http_range_fill_buffer( stream_t *stream, char *buffer, int size ) {
+	http_range_t *r = stream->streaming_ctrl->data;
+	int retry;
+	for( retry=0; retry<2; retry++ ) {
+		int len;
+		if( !r->remaining && http_range_next( stream, r )<=0 ) return 0;
+		// readahead: the answer to the next request follows this one directly
+		if( !r->close && r->requested==r->pos+r->remaining &&
+		    r->remaining<=HTTP_RANGE_SIZE/4 && r->requested<stream->end_pos )
+			http_range_request( stream, r );
+		len = http_range_recv( stream, r, buffer, size );
+		if( len>0 ) return len;
+		// A server closing the connection with a request pending resets
+		// it, which may drop data received already. Continue from the
+		// last byte we got.
+	}
+	mp_msg(MSGT_NETWORK,MSGL_ERR,MSGTR_MPDEMUX_NW_ReadFailed);
+	return 0;
+}
+
+// Read and drop everything asked for, leaving the connection idle.
+static int
+http_range_drain( stream_t *stream, http_range_t *r ) {
+	char buf[BUFFER_SIZE];
+	while( r->pos<r->requested ) {
+		if( !r->remaining && (r->close || http_range_response( stream, r )<=0) )
+			return 0;
+		if( !http_range_recv( stream, r, buf, BUFFER_SIZE ) ) return 0;
+	}
+	return 1;
+}
+
+// Seek forward by reading from the current connection.
+static int
+http_skip( stream_t *stream, off_t pos ) {
+	streaming_ctrl_t *ctrl = stream->streaming_ctrl;
+	char buf[BUFFER_SIZE];
+	while( stream->pos<pos ) {
+		int len = pos-stream->pos<BUFFER_SIZE ? pos-stream->pos : BUFFER_SIZE;
+		if( ctrl->streaming_read )
+			len = ctrl->streaming_read( stream->fd, buf, len, ctrl );
+		else
+			len = stream->fill_buffer( stream, buf, len );
+		if( len<=0 ) return 0;
+		stream->pos += len;
+	}
+	return 1;
+}
+
+int
+http_seek( stream_t *stream, off_t pos ) {
+	streaming_ctrl_t *ctrl;
+	http_range_t *r;
+	off_t cur;
+	if( stream==NULL ) return 0;
+	ctrl = stream->streaming_ctrl;
+	r = ctrl->streaming_read ? NULL : ctrl->data;
+
+	// the data may be on its way already, stream->pos is reset at EOF and
+	// only r->pos tells where the connection is
+	cur = r ? r->pos : stream->pos;
+	if( stream->fd>=0 && pos>=cur && pos-cur<=HTTP_SKIP_LIMIT &&
+	    (!r || pos<=r->requested) ) {
+		stream->pos = cur;
+		if( http_skip( stream, pos ) ) return 1;
+	}
+
+	if( !r ) {
+		if( stream->end_pos<=0 ) return http_reconnect( stream, pos );
+		r = calloc( 1, sizeof(http_range_t) );
+		if( r==NULL ) {
+			mp_msg(MSGT_NETWORK,MSGL_FATAL,MSGTR_MemAllocFailed);
+			return http_reconnect( stream, pos );
+		}
+		// the connection that was opened for the whole file is not reused
+		if( stream->fd>0 ) closesocket( stream->fd );
+		stream->fd = -1;
+		free( ctrl->buffer );
+		ctrl->buffer = NULL;
+		ctrl->buffer_size = ctrl->buffer_pos = 0;
+		ctrl->data = r;
+		ctrl->streaming_read = NULL;
+		ctrl->streaming_seek = NULL;
+		stream->fill_buffer = http_range_fill_buffer;
+	} else if( r->requested-r->pos>HTTP_SKIP_LIMIT || !http_range_drain( stream, r ) ) {
+		http_range_reset( stream, r );
+	}
+
+	r->pos = r->requested = pos;
+	r->remaining = 0;
+	stream->pos = pos;
+	return http_range_next( stream, r )>=0;
+}
+
 int
 streaming_bufferize( streaming_ctrl_t *streaming_ctrl, char *buffer, int size) {
 //printf("streaming_bufferize\n");
@@ -10,6 +10,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <ctype.h>
 #include "config.h"
@@ -29,6 +30,7 @@
 
 #define DEBUG        1
 #include "mp_msg.h"
+#include "udp.h"
 #include "rtp.h"
 
 // RTP reorder routines
@@ -39,217 +41,232 @@
 
 #define MAXRTPPACKETSIN 32   // The number of max packets being reordered
 
-struct rtpbits {
-  unsigned int v:2;           /* version: 2 */
-  unsigned int p:1;           /* is there padding appended: 0 */
-  unsigned int x:1;           /* number of extension headers: 0 */
-  unsigned int cc:4;          /* number of CSRC identifiers: 0 */
-  unsigned int m:1;           /* marker: 0 */
-  unsigned int pt:7;          /* payload type: 33 for MPEG2 TS - RFC 1890 */
-  unsigned int sequence:16;   /* sequence number: random */
-};
-
-struct rtpheader {	/* in network byte order */
-  struct rtpbits b;
-  int timestamp;	/* start: random */
-  int ssrc;		/* random */
-};
+#define RTP_CLOCK 90000      // timestamp units per second, RFC 2250
 
-struct rtpbuffer
-{
-	unsigned char  data[MAXRTPPACKETSIN][STREAM_BUFFER_SIZE];
-	unsigned short  seq[MAXRTPPACKETSIN];
-	unsigned short  len[MAXRTPPACKETSIN];
-	unsigned short first;
+struct rtp_state {
+	udp_batch_t batch;
+	// Reordering window, slot first holds the packet with sequence number
+	// seq, the following slots the ones after it. Empty slots have len 0.
+	unsigned char *data[MAXRTPPACKETSIN];
+	unsigned short offset[MAXRTPPACKETSIN]; // of the payload
+	unsigned short len[MAXRTPPACKETSIN];    // of the payload
+	unsigned short seq;
+	unsigned short highest;   // highest sequence number received
+	int first;
+	int waited;               // packets queued while waiting for slot first
+	int started;
+	// statistics
+	unsigned received, lost, reordered, duplicates;
+	unsigned late;            // behind the window, dropped
+	int64_t transit;          // arrival time - RTP timestamp of the last packet
+	double jitter;            // in timestamp units, RFC 3550 A.8
+	// the packets are received into these and then swapped into the window
+	unsigned char buffers[UDP_BATCH+MAXRTPPACKETSIN][UDP_PACKET_SIZE];
 };
-static struct rtpbuffer rtpbuf;
-
-static int getrtp2(int fd, struct rtpheader *rh, char** data, int* lengthData);
 
 // RTP Reordering functions
 // Algorithm works as follows:
-// If next packet is in sequence just copy it to buffer
-// Otherwise copy it in cache according to its sequence number
-// Cache is a circular array where "rtpbuf.first" points to next sequence slot
-// and keeps track of expected sequence
+// If next packet is in sequence just hand it out
+// Otherwise keep it in the window according to its sequence number
+// The window is a circular array where "first" points to the next sequence slot
+// and keeps track of expected sequence. Packets are not copied into it, the
+// buffers they were received in are exchanged for empty ones.
 
-// Initialize rtp cache
-static void rtp_cache_reset(unsigned short seq)
+struct rtp_state *rtp_state_new(void)
 {
+	struct rtp_state *rs = calloc(1, sizeof(struct rtp_state));
 	int i;
 
-	rtpbuf.first = 0;
-	rtpbuf.seq[0] = ++seq;
+	if (!rs)
+		return NULL;
+	udp_batch_init(&rs->batch, rs->buffers[0]);
+	for (i=0; i<MAXRTPPACKETSIN; i++)
+		rs->data[i] = rs->buffers[UDP_BATCH+i];
+	return rs;
+}
 
-	for (i=0; i<MAXRTPPACKETSIN; i++) {
-		rtpbuf.len[i] = 0;
+// Once, by whoever has read the stream, which is a forked cache if there is one.
+static void rtp_print_stats(struct rtp_state *rs)
+{
+	if (rs->received)
+		mp_msg(MSGT_NETWORK, MSGL_INFO, "RTP: %u packets received, %u lost, %u out of order, %u duplicates, %u too late, jitter %.1f ms\n",
+		       rs->received, rs->lost, rs->reordered, rs->duplicates, rs->late, rs->jitter * 1000 / RTP_CLOCK);
+	rs->received = 0;
+}
+
+void rtp_state_free(struct rtp_state *rs)
+{
+	if (!rs)
+		return;
+	rtp_print_stats(rs);
+	free(rs);
+}
+
+int rtp_state_control(struct rtp_state *rs, int cmd, void *arg)
+{
+	switch (cmd) {
+	case STREAM_CTRL_GET_PACKETS_LOST:
+		*(unsigned *)arg = rs->lost;
+		return STREAM_OK;
+	case STREAM_CTRL_GET_JITTER:
+		*(double *)arg = rs->jitter / RTP_CLOCK;
+		return STREAM_OK;
+	case STREAM_CTRL_GET_RECV_DELAY:
+		*(double *)arg = rs->batch.delay;
+		return STREAM_OK;
+	case STREAM_CTRL_PRINT_STATS:
+		rtp_print_stats(rs);
+		return STREAM_OK;
 	}
+	return STREAM_UNSUPPORTED;
 }
 
-// Write in a cache the rtp packet in right rtp sequence order
-static int rtp_cache(int fd, char *buffer, int length)
+// Initialize rtp window
+static void rtp_cache_reset(struct rtp_state *rs, unsigned short seq)
 {
-	struct rtpheader rh;
-	int newseq;
-	char *data;
-	unsigned short seq;
-	static int is_first = 1;
+	int i;
 
-	getrtp2(fd, &rh, &data, &length);
-	if(!length)
-		return 0;
-	seq = rh.b.sequence;
+	rs->first = 0;
+	rs->seq = seq;
+	rs->waited = 0;
 
-	newseq = seq - rtpbuf.seq[rtpbuf.first];
+	for (i=0; i<MAXRTPPACKETSIN; i++) {
+		rs->len[i] = 0;
+	}
+}
 
-	if ((newseq == 0) || is_first)
-	{
-		is_first = 0;
+static void rtp_jitter(struct rtp_state *rs, uint32_t timestamp, struct timeval *tv)
+{
+	int64_t arrival = (int64_t)tv->tv_sec * RTP_CLOCK + (int64_t)tv->tv_usec * RTP_CLOCK / 1000000;
+	int64_t transit = (uint32_t)(arrival - timestamp);
+	int64_t d = transit - rs->transit;
+
+	if (rs->received) {
+		// the difference of two wrapped 32 bit values
+		if (d > INT32_MAX)
+			d -= (int64_t)1 << 32;
+		else if (d < INT32_MIN)
+			d += (int64_t)1 << 32;
+		rs->jitter += (llabs(d) - rs->jitter) / 16;
+	}
+	rs->transit = transit;
+}
+
+// Put the next received packet in the window, in right rtp sequence order
+static void rtp_cache(struct rtp_state *rs)
+{
+	udp_batch_t *b = &rs->batch;
+	unsigned char *buf = b->data[b->next];
+	int length = b->len[b->next];
+	struct timeval *stamp = &b->stamp[b->next];
+	int headerSize, newseq, slot;
+	unsigned short seq;
 
-		//mp_msg(MSGT_NETWORK, MSGL_DBG4, "RTP (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-		rtpbuf.first = ( 1 + rtpbuf.first ) % MAXRTPPACKETSIN;
-		rtpbuf.seq[rtpbuf.first] = ++seq;
-		goto feed;
+	b->next++;
+	if (length<12) {
+		mp_msg(MSGT_NETWORK,MSGL_ERR,"rtp: packet too small (%d) to be an rtp frame (>12bytes)\n", length);
+		return;
+	}
+	headerSize = 12 + 4*(buf[0] & 0x0f); /* in bytes */
+	if (length <= headerSize) {
+		mp_msg(MSGT_NETWORK, MSGL_ERR, "Got empty packet from RTP cache!?\n");
+		return;
+	}
+	seq = buf[2] << 8 | buf[3];
+
+	rtp_jitter(rs, (uint32_t)buf[4] << 24 | buf[5] << 16 | buf[6] << 8 | buf[7], stamp);
+	rs->received++;
+	if (!rs->started) {
+		rs->started = 1;
+		rs->highest = seq;
+		rtp_cache_reset(rs, seq);
 	}
+	if ((short)(seq - rs->highest) < 0)
+		rs->reordered++;
+	else
+		rs->highest = seq;
 
-	if (newseq > MAXRTPPACKETSIN)
+	newseq = (short)(seq - rs->seq);
+
+	if (newseq >= MAXRTPPACKETSIN)
 	{
-		mp_msg(MSGT_NETWORK, MSGL_DBG2, "Overrun(seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-		rtp_cache_reset(seq);
-		goto feed;
+		mp_msg(MSGT_NETWORK, MSGL_DBG2, "Overrun(seq[%d]=%d seq=%d, newseq=%d)\n", rs->first, rs->seq, seq, newseq);
+		rs->lost += newseq;
+		rtp_cache_reset(rs, seq);
+		newseq = 0;
 	}
 
 	if (newseq < 0)
 	{
-		int i;
-
 		// Is it a stray packet re-sent to network?
-		for (i=0; i<MAXRTPPACKETSIN; i++) {
-			if (rtpbuf.seq[i] == seq) {
-				mp_msg(MSGT_NETWORK, MSGL_ERR, "Stray packet (seq[%d]=%d seq=%d, newseq=%d found at %d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq, i);
-				return  0; // Yes, it is!
-			}
-		}
 		// Some heuristic to decide when to drop packet or to restart everything
 		if (newseq > -(3 * MAXRTPPACKETSIN)) {
-			mp_msg(MSGT_NETWORK, MSGL_ERR, "Too Old packet (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-			return  0; // Yes, it is!
+			mp_msg(MSGT_NETWORK, MSGL_ERR, "Too Old packet (seq[%d]=%d seq=%d, newseq=%d)\n", rs->first, rs->seq, seq, newseq);
+			rs->late++;
+			return; // Yes, it is!
 		}
 
-		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Underrun(seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-
-		rtp_cache_reset(seq);
-		goto feed;
-	}
-
-	mp_msg(MSGT_NETWORK, MSGL_DBG4, "Out of Seq (seq[%d]=%d seq=%d, newseq=%d)\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first], seq, newseq);
-	newseq = ( newseq + rtpbuf.first ) % MAXRTPPACKETSIN;
-	memcpy (rtpbuf.data[newseq], data, length);
-	rtpbuf.len[newseq] = length;
-	rtpbuf.seq[newseq] = seq;
-
-	return 0;
-
-feed:
-	memcpy (buffer, data, length);
-	return length;
-}
-
-// Get next packet in cache
-// Look in cache to get first packet in sequence
-static int rtp_get_next(int fd, char *buffer, int length)
-{
-	int i;
-	unsigned short nextseq;
-
-	// If we have empty buffer we loop to fill it
-	for (i=0; i < MAXRTPPACKETSIN -3; i++) {
-		if (rtpbuf.len[rtpbuf.first] != 0) break;
-
-		length = rtp_cache(fd, buffer, length) ;
+		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Underrun(seq[%d]=%d seq=%d, newseq=%d)\n", rs->first, rs->seq, seq, newseq);
 
-		// returns on first packet in sequence
-		if (length > 0) {
-			//mp_msg(MSGT_NETWORK, MSGL_DBG4, "Getting rtp [%d] %hu\n", i, rtpbuf.first);
-			return length;
-		} else if (length < 0) break;
-
-		// Only if length == 0 loop continues!
+		rtp_cache_reset(rs, seq);
+		newseq = 0;
 	}
 
-	i = rtpbuf.first;
-	while (rtpbuf.len[i] == 0) {
-		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Lost packet %hu\n", rtpbuf.seq[i]);
-		i = ( 1 + i ) % MAXRTPPACKETSIN;
-		if (rtpbuf.first == i) break;
+	slot = (rs->first + newseq) % MAXRTPPACKETSIN;
+	if (rs->len[slot]) {
+		mp_msg(MSGT_NETWORK, MSGL_ERR, "Stray packet (seq[%d]=%d seq=%d, newseq=%d)\n", rs->first, rs->seq, seq, newseq);
+		rs->duplicates++;
+		return;
 	}
-	rtpbuf.first = i;
-
-	// Copy next non empty packet from cache
-	mp_msg(MSGT_NETWORK, MSGL_DBG4, "Getting rtp from cache [%d] %hu\n", rtpbuf.first, rtpbuf.seq[rtpbuf.first]);
-	memcpy (buffer, rtpbuf.data[rtpbuf.first], rtpbuf.len[rtpbuf.first]);
-	length = rtpbuf.len[rtpbuf.first]; // can be zero?
-
-	// Reset fisrt slot and go next in cache
-	rtpbuf.len[rtpbuf.first] = 0;
-	nextseq = rtpbuf.seq[rtpbuf.first];
-	rtpbuf.first = ( 1 + rtpbuf.first ) % MAXRTPPACKETSIN;
-	rtpbuf.seq[rtpbuf.first] = nextseq + 1;
-
-	return length;
+	if (newseq)
+		mp_msg(MSGT_NETWORK, MSGL_DBG4, "Out of Seq (seq[%d]=%d seq=%d, newseq=%d)\n", rs->first, rs->seq, seq, newseq);
+
+	// exchange buffers, the batch gets the empty one of the slot
+	b->data[b->next-1] = rs->data[slot];
+	rs->data[slot] = buf;
+	rs->offset[slot] = headerSize;
+	rs->len[slot] = length - headerSize;
+	if (slot != rs->first)
+		rs->waited++;
 }
 
+// Read next rtp packet using the window
+int read_rtp_from_server(int fd, char *buffer, int length, struct rtp_state *rs) {
+	int i;
 
-// Read next rtp packet using cache
-int read_rtp_from_server(int fd, char *buffer, int length) {
 	// Following test is ASSERT (i.e. uneuseful if code is correct)
 	if(buffer==NULL || length<STREAM_BUFFER_SIZE) {
 		mp_msg(MSGT_NETWORK, MSGL_ERR, "RTP buffer invalid; no data return from network\n");
 		return 0;
 	}
 
-	// loop just to skip empty packets
-	while ((length = rtp_get_next(fd, buffer, length)) == 0) {
-		mp_msg(MSGT_NETWORK, MSGL_ERR, "Got empty packet from RTP cache!?\n");
+	// If the next packet is missing we receive more to fill the window
+	while (rs->len[rs->first] == 0 && rs->waited < MAXRTPPACKETSIN - 3) {
+		if (rs->batch.next >= rs->batch.count &&
+		    udp_batch_recv(fd, &rs->batch) <= 0)
+			return 0;
+		rtp_cache(rs);
 	}
 
-	return length;
-}
+	i = rs->first;
+	while (rs->len[i] == 0) {
+		mp_msg(MSGT_NETWORK, MSGL_ERR,  "Lost packet %hu\n", rs->seq);
+		rs->lost++;
+		rs->seq++;
+		i = ( 1 + i ) % MAXRTPPACKETSIN;
+	}
+	rs->first = i;
 
-static int getrtp2(int fd, struct rtpheader *rh, char** data, int* lengthData) {
-  static char buf[1600];
-  unsigned int intP;
-  char* charP = (char*) &intP;
-  int headerSize;
-  int lengthPacket;
-  lengthPacket=recv(fd,buf,1590,0);
-  if (lengthPacket<0)
-    mp_msg(MSGT_NETWORK,MSGL_ERR,"rtp: socket read error\n");
-  else if (lengthPacket<12)
-    mp_msg(MSGT_NETWORK,MSGL_ERR,"rtp: packet too small (%d) to be an rtp frame (>12bytes)\n", lengthPacket);
-  if(lengthPacket<12) {
-    *lengthData = 0;
-    return 0;
-  }
-  rh->b.v  = (unsigned int) ((buf[0]>>6)&0x03);
-  rh->b.p  = (unsigned int) ((buf[0]>>5)&0x01);
-  rh->b.x  = (unsigned int) ((buf[0]>>4)&0x01);
-  rh->b.cc = (unsigned int) ((buf[0]>>0)&0x0f);
-  rh->b.m  = (unsigned int) ((buf[1]>>7)&0x01);
-  rh->b.pt = (unsigned int) ((buf[1]>>0)&0x7f);
-  intP = 0;
-  memcpy(charP+2,&buf[2],2);
-  rh->b.sequence = ntohl(intP);
-  intP = 0;
-  memcpy(charP,&buf[4],4);
-  rh->timestamp = ntohl(intP);
-
-  headerSize = 12 + 4*rh->b.cc; /* in bytes */
-
-  *lengthData = lengthPacket - headerSize;
-  *data = (char*) buf + headerSize;
-
-  //  mp_msg(MSGT_NETWORK,MSGL_DBG2,"Reading rtp: v=%x p=%x x=%x cc=%x m=%x pt=%x seq=%x ts=%x lgth=%d\n",rh->b.v,rh->b.p,rh->b.x,rh->b.cc,rh->b.m,rh->b.pt,rh->b.sequence,rh->timestamp,lengthPacket);
-
-  return 0;
+	// Copy next non empty packet from the window
+	mp_msg(MSGT_NETWORK, MSGL_DBG4, "Getting rtp from cache [%d] %hu\n", rs->first, rs->seq);
+	length = rs->len[rs->first];
+	memcpy (buffer, rs->data[rs->first] + rs->offset[rs->first], length);
+
+	// Reset first slot and go next in window
+	rs->len[rs->first] = 0;
+	rs->seq++;
+	rs->first = ( 1 + rs->first ) % MAXRTPPACKETSIN;
+	rs->waited = 0;
+
+	return length;
 }
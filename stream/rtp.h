@@ -19,6 +19,12 @@
 #ifndef MPLAYER_RTP_H
 #define MPLAYER_RTP_H
 
-int read_rtp_from_server(int fd, char *buffer, int length);
+struct rtp_state;
+
+struct rtp_state *rtp_state_new(void);
+/// Print the reception statistics and free the state.
+void rtp_state_free(struct rtp_state *rs);
+int rtp_state_control(struct rtp_state *rs, int cmd, void *arg);
+int read_rtp_from_server(int fd, char *buffer, int length, struct rtp_state *rs);
 
 #endif /* MPLAYER_RTP_H */
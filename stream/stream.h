@@ -93,6 +93,10 @@
 #define STREAM_CTRL_GET_NUM_ANGLES 9
 #define STREAM_CTRL_GET_ANGLE 10
 #define STREAM_CTRL_SET_ANGLE 11
+#define STREAM_CTRL_GET_PACKETS_LOST 12
+#define STREAM_CTRL_GET_JITTER 13
+#define STREAM_CTRL_GET_RECV_DELAY 14
+#define STREAM_CTRL_PRINT_STATS 15
 
 
 typedef enum {
@@ -155,6 +159,7 @@ typedef struct stream_st {
   int mode; //STREAM_READ or STREAM_WRITE
   unsigned int cache_pid;
   void* cache_data;
+  void* write_cache; // see stream_enable_write_cache()
   void* priv; // used for DVD, TV, RTSP etc
   char* url;  // strdup() of filename/url
 #ifdef CONFIG_NETWORK
@@ -181,6 +186,13 @@ int cache_stream_seek_long(stream_t *s,off_t pos);
 #define stream_enable_cache(x,y,z,w) 1
 #endif
 int stream_write_buffer(stream_t *s, unsigned char *buf, int len);
+#if HAVE_PTHREADS
+int stream_enable_write_cache(stream_t *s, int size);
+int stream_flush_write_cache(stream_t *s);
+#else
+#define stream_enable_write_cache(x,y) 0
+#define stream_flush_write_cache(x) 1
+#endif
 
 inline static int stream_read_char(stream_t *s){
   return (s->buf_pos<s->buf_len)?s->buffer[s->buf_pos++]:
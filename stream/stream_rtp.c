@@ -34,7 +34,20 @@ static int
 rtp_streaming_read (int fd, char *buffer,
                     int size, streaming_ctrl_t *streaming_ctrl)
 {
-  return read_rtp_from_server (fd, buffer, size);
+  return read_rtp_from_server (fd, buffer, size, streaming_ctrl->data);
+}
+
+static int
+rtp_stream_control (stream_t *stream, int cmd, void *arg)
+{
+  return rtp_state_control (stream->streaming_ctrl->data, cmd, arg);
+}
+
+static void
+rtp_stream_close (stream_t *stream)
+{
+  rtp_state_free (stream->streaming_ctrl->data);
+  stream->streaming_ctrl->data = NULL;
 }
 
 static int
@@ -57,6 +70,9 @@ rtp_streaming_start (stream_t *stream)
     stream->fd = fd;
   }
 
+  streaming_ctrl->data = rtp_state_new ();
+  if (!streaming_ctrl->data)
+    return -1;
   streaming_ctrl->streaming_read = rtp_streaming_read;
   streaming_ctrl->streaming_seek = nop_streaming_seek;
   streaming_ctrl->prebuffer_size = 64 * 1024; /* 64 KBytes */
@@ -101,6 +117,8 @@ rtp_stream_open (stream_t *stream, int mode, void *opts, int *file_format)
   }
 
   stream->type = STREAMTYPE_STREAM;
+  stream->control = rtp_stream_control;
+  stream->close = rtp_stream_close;
   fixup_network_stream_cache (stream);
 
   return STREAM_OK;
@@ -29,10 +29,64 @@
 #include "url.h"
 #include "udp.h"
 
+typedef struct {
+  udp_batch_t batch;
+  unsigned char buffers[UDP_BATCH][UDP_PACKET_SIZE];
+} udp_priv_t;
+
+/* The datagrams are handed out as a byte stream, a read may end in the
+ * middle of one and it is continued by the next read. */
+static int
+udp_streaming_read (int fd, char *buffer,
+                    int size, streaming_ctrl_t *streaming_ctrl)
+{
+  udp_batch_t *b = &((udp_priv_t *) streaming_ctrl->data)->batch;
+  int len = 0;
+
+  while (len < size)
+  {
+    int n;
+
+    if (b->next >= b->count)
+    {
+      /* do not wait for more when there is something to return */
+      if (len > 0 || udp_batch_recv (fd, b) <= 0)
+        break;
+    }
+    n = b->len[b->next] - b->pos;
+    if (n > size - len)
+      n = size - len;
+    memcpy (buffer + len, b->data[b->next] + b->pos, n);
+    len += n;
+    b->pos += n;
+    if (b->pos >= b->len[b->next])
+    {
+      b->next++;
+      b->pos = 0;
+    }
+  }
+
+  return len;
+}
+
+static int
+udp_stream_control (stream_t *stream, int cmd, void *arg)
+{
+  udp_priv_t *priv = stream->streaming_ctrl->data;
+
+  if (cmd == STREAM_CTRL_GET_RECV_DELAY)
+  {
+    *(double *) arg = priv->batch.delay;
+    return STREAM_OK;
+  }
+  return STREAM_UNSUPPORTED;
+}
+
 static int
 udp_streaming_start (stream_t *stream)
 {
   streaming_ctrl_t *streaming_ctrl;
+  udp_priv_t *priv;
   int fd;
 
   if (!stream)
@@ -49,7 +103,12 @@ udp_streaming_start (stream_t *stream)
     stream->fd = fd;
   }
 
-  streaming_ctrl->streaming_read = nop_streaming_read;
+  priv = malloc (sizeof (udp_priv_t));
+  if (!priv)
+    return -1;
+  udp_batch_init (&priv->batch, priv->buffers[0]);
+  streaming_ctrl->data = priv;
+  streaming_ctrl->streaming_read = udp_streaming_read;
   streaming_ctrl->streaming_seek = nop_streaming_seek;
   streaming_ctrl->prebuffer_size = 64 * 1024; /* 64 KBytes */
   streaming_ctrl->buffering = 0;
@@ -93,6 +152,7 @@ udp_stream_open (stream_t *stream, int mode, void *opts, int *file_format)
   }
 
   stream->type = STREAMTYPE_STREAM;
+  stream->control = udp_stream_control;
   fixup_network_stream_cache (stream);
 
   return STREAM_OK;
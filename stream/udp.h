@@ -23,8 +23,27 @@
 #ifndef MPLAYER_UDP_H
 #define MPLAYER_UDP_H
 
+#include <sys/time.h>
 #include "url.h"
 
+#define UDP_BATCH       32   /* most datagrams received by one call */
+#define UDP_PACKET_SIZE 2048 /* longer datagrams are truncated */
+
+/* Datagrams received by udp_batch_recv(). The buffers are the caller's, it
+ * may exchange data[i] for another buffer of the same size before the next
+ * call instead of copying the datagram out. */
+typedef struct {
+  unsigned char *data[UDP_BATCH];
+  int len[UDP_BATCH];
+  struct timeval stamp[UDP_BATCH]; /* time of arrival */
+  int count;                       /* datagrams received */
+  int next;                        /* first one not used yet */
+  int pos;                         /* bytes of it used already */
+  double delay;                    /* seconds the first one was queued */
+} udp_batch_t;
+
 int udp_open_socket (URL_t *url);
+void udp_batch_init (udp_batch_t *b, unsigned char *buffers);
+int udp_batch_recv (int fd, udp_batch_t *b);
 
 #endif /* MPLAYER_UDP_H */
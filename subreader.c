@@ -25,15 +25,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
+#include <time.h>
 
 #include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "mp_msg.h"
 #include "subreader.h"
 #include "stream/stream.h"
 #include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
 
 #ifdef CONFIG_ENCA
@@ -1022,37 +1029,119 @@ static subtitle *sub_read_line_jacosub(stream_t* st, subtitle * current, int utf
     return current;
 }
 
-static int sub_autodetect (stream_t* st, int *uses_time, int utf16) {
+/*
+ * The beginning of a subtitle file, read once and shared by the format
+ * probes for all the encodings tried.
+ */
+typedef struct sub_sniff {
+    stream_t *st;
+    unsigned char *buf;
+    int len, size;
+    int eof;
+} sub_sniff;
+
+/// Make n bytes from pos on available if possible, return how many are.
+static int sniff_avail(sub_sniff *sn, int pos, int n)
+{
+    while (sn->len - pos < n && !sn->eof) {
+        int r;
+        if (sn->len + STREAM_BUFFER_SIZE > sn->size) {
+            unsigned char *buf = realloc(sn->buf, sn->size + 16 * STREAM_BUFFER_SIZE);
+            if (!buf) {
+                sn->eof = 1;
+                break;
+            }
+            sn->buf = buf;
+            sn->size += 16 * STREAM_BUFFER_SIZE;
+        }
+        r = stream_read(sn->st, sn->buf + sn->len, STREAM_BUFFER_SIZE);
+        if (r <= 0)
+            sn->eof = 1;
+        else
+            sn->len += r;
+    }
+    return FFMIN(sn->len - pos, n);
+}
+
+static unsigned sniff_get16(sub_sniff *sn, int *pos, int utf16)
+{
+    const uint8_t *p;
+
+    if (sniff_avail(sn, *pos, 2) < 2)
+        return 0;
+    p = sn->buf + *pos;
+    *pos += 2;
+    return utf16 == 1 ? AV_RL16(p) : AV_RB16(p);
+}
+
+/**
+ * \brief read a line from the buffer like stream_read_line() does
+ * \param pos position in the buffer, updated
+ * \param utf16 0 = UTF-8/ASCII/other, 1 = UTF-16-LE, 2 = UTF-16-BE
+ */
+static char *sniff_read_line(sub_sniff *sn, int *pos, char *line, int utf16)
+{
+    char *d = line, *end = line + LINE_LEN - (utf16 ? 8 : 0);
+    int start = *pos, unit = utf16 ? 2 : 1;
+    uint32_t c;
+
+    while (sniff_avail(sn, *pos, unit) == unit) {
+        if (utf16) {
+            uint8_t tmp;
+            GET_UTF16(c, sniff_get16(sn, pos, utf16), ;)
+            if (d < end)
+                PUT_UTF8(c, tmp, *d++ = tmp;)
+        } else {
+            c = sn->buf[(*pos)++];
+            if (d < end)
+                *d++ = c;
+        }
+        if (c == '\n')
+            break;
+    }
+    if (*pos == start)
+        return NULL;
+    *d = 0;
+    return line;
+}
+
+static int sub_autodetect (sub_sniff *sn, int *uses_time, int utf16) {
     char line[LINE_LEN+1];
-    int i,j=0;
-    char p;
+    int i,j=0,pos=0;
+    char p, c;
+    int num;
 
     while (j < 100) {
 	j++;
-	if (!stream_read_line (st, line, LINE_LEN, utf16))
+	if (!sniff_read_line (sn, &pos, line, utf16))
 	    return SUB_INVALID;
 
-	if (sscanf (line, "{%d}{%d}", &i, &i)==2)
+	// most probes can only match lines starting with c or with a number
+	c = *line;
+	num = strspn(line, " \t\n\v\f\r");
+	num = isdigit(line[num]) || line[num] == '-' || line[num] == '+';
+
+	if (c == '{' && sscanf (line, "{%d}{%d}", &i, &i)==2)
 		{*uses_time=0;return SUB_MICRODVD;}
-	if (sscanf (line, "{%d}{}", &i)==1)
+	if (c == '{' && sscanf (line, "{%d}{}", &i)==1)
 		{*uses_time=0;return SUB_MICRODVD;}
-	if (sscanf (line, "[%d][%d]", &i, &i)==2)
+	if (c == '[' && sscanf (line, "[%d][%d]", &i, &i)==2)
 		{*uses_time=1;return SUB_MPL2;}
-	if (sscanf (line, "%d:%d:%d.%d,%d:%d:%d.%d",     &i, &i, &i, &i, &i, &i, &i, &i)==8)
+	if (num && sscanf (line, "%d:%d:%d.%d,%d:%d:%d.%d",     &i, &i, &i, &i, &i, &i, &i, &i)==8)
 		{*uses_time=1;return SUB_SUBRIP;}
-	if (sscanf (line, "%d:%d:%d%[,.:]%d --> %d:%d:%d%[,.:]%d", &i, &i, &i, (char *)&i, &i, &i, &i, &i, (char *)&i, &i)==10)
+	if (num && sscanf (line, "%d:%d:%d%[,.:]%d --> %d:%d:%d%[,.:]%d", &i, &i, &i, (char *)&i, &i, &i, &i, &i, (char *)&i, &i)==10)
 		{*uses_time=1;return SUB_SUBVIEWER;}
-	if (sscanf (line, "{T %d:%d:%d:%d",&i, &i, &i, &i)==4)
+	if (c == '{' && sscanf (line, "{T %d:%d:%d:%d",&i, &i, &i, &i)==4)
 		{*uses_time=1;return SUB_SUBVIEWER2;}
 	if (strstr (line, "<SAMI>"))
 		{*uses_time=1; return SUB_SAMI;}
-	if (sscanf(line, "%d:%d:%d.%d %d:%d:%d.%d", &i, &i, &i, &i, &i, &i, &i, &i) == 8)
+	if (num && sscanf(line, "%d:%d:%d.%d %d:%d:%d.%d", &i, &i, &i, &i, &i, &i, &i, &i) == 8)
 		{*uses_time = 1; return SUB_JACOSUB;}
-	if (sscanf(line, "@%d @%d", &i, &i) == 2)
+	if (c == '@' && sscanf(line, "@%d @%d", &i, &i) == 2)
 		{*uses_time = 1; return SUB_JACOSUB;}
-	if (sscanf (line, "%d:%d:%d:",     &i, &i, &i )==3)
+	if (num && sscanf (line, "%d:%d:%d:",     &i, &i, &i )==3)
 		{*uses_time=1;return SUB_VPLAYER;}
-	if (sscanf (line, "%d:%d:%d ",     &i, &i, &i )==3)
+	if (num && sscanf (line, "%d:%d:%d ",     &i, &i, &i )==3)
 		{*uses_time=1;return SUB_VPLAYER;}
 	//TODO: just checking if first line of sub starts with "<" is WAY
 	// too weak test for RT
@@ -1065,15 +1154,15 @@ static int sub_autodetect (stream_t* st, int *uses_time, int utf16) {
 		{*uses_time=1; return SUB_SSA;}
 	if (!memcmp(line, "Dialogue: ", 10))
 		{*uses_time=1; return SUB_SSA;}
-	if (sscanf (line, "%d,%d,\"%c", &i, &i, (char *) &i) == 3)
+	if (num && sscanf (line, "%d,%d,\"%c", &i, &i, (char *) &i) == 3)
 		{*uses_time=1;return SUB_PJS;}
-	if (sscanf (line, "FORMAT=%d", &i) == 1)
+	if (c == 'F' && sscanf (line, "FORMAT=%d", &i) == 1)
 		{*uses_time=0; return SUB_MPSUB;}
-	if (sscanf (line, "FORMAT=TIM%c", &p)==1 && p=='E')
+	if (c == 'F' && sscanf (line, "FORMAT=TIM%c", &p)==1 && p=='E')
 		{*uses_time=1; return SUB_MPSUB;}
 	if (strstr (line, "-->>"))
 		{*uses_time=0; return SUB_AQTITLE;}
-	if (sscanf (line, "[%d:%d:%d]", &i, &i, &i)==3)
+	if (c == '[' && sscanf (line, "[%d:%d:%d]", &i, &i, &i)==3)
 		{*uses_time=1;return SUB_SUBRIP09;}
     }
 
@@ -1087,11 +1176,13 @@ extern float sub_delay;
 extern float sub_fps;
 
 #ifdef CONFIG_ICONV
+// used by demux_ogg.c, a file parsed by sub_read_file() has its own
 static iconv_t icdsc = (iconv_t)(-1);
 
-void	subcp_open (stream_t *st)
+static iconv_t subcp_open_cd (stream_t *st)
 {
 	char *tocp = "UTF-8";
+	iconv_t cd = (iconv_t)(-1);
 
 	if (sub_cp){
 		const char *cp_tmp = sub_cp;
@@ -1108,29 +1199,30 @@ void	subcp_open (stream_t *st)
 		  }
 		}
 #endif
-		if ((icdsc = iconv_open (tocp, cp_tmp)) != (iconv_t)(-1)){
+		if ((cd = iconv_open (tocp, cp_tmp)) != (iconv_t)(-1)){
 			mp_msg(MSGT_SUBREADER,MSGL_V,"SUB: opened iconv descriptor.\n");
 			sub_utf8 = 2;
 		} else
 			mp_msg(MSGT_SUBREADER,MSGL_ERR,"SUB: error opening iconv descriptor.\n");
 	}
+	return cd;
 }
 
-void	subcp_close (void)
+static void subcp_close_cd (iconv_t *cd)
 {
-	if (icdsc != (iconv_t)(-1)){
-		(void) iconv_close (icdsc);
-		icdsc = (iconv_t)(-1);
+	if (*cd != (iconv_t)(-1)){
+		(void) iconv_close (*cd);
+		*cd = (iconv_t)(-1);
 	   	mp_msg(MSGT_SUBREADER,MSGL_V,"SUB: closed iconv descriptor.\n");
 	}
 }
 
-subtitle* subcp_recode (subtitle *sub)
+static subtitle* subcp_recode_cd (iconv_t cd, subtitle *sub)
 {
 	int l=sub->lines;
 	size_t ileft, oleft;
 	char *op, *ip, *ot;
-	if(icdsc == (iconv_t)(-1)) return sub;
+	if(cd == (iconv_t)(-1)) return sub;
 
 	while (l){
 		ip = sub->text[--l];
@@ -1142,14 +1234,14 @@ subtitle* subcp_recode (subtitle *sub)
 		   	continue;
 		}
 		op = ot;
-		if (iconv(icdsc, &ip, &ileft,
+		if (iconv(cd, &ip, &ileft,
 			  &op, &oleft) == (size_t)(-1)) {
 			mp_msg(MSGT_SUBREADER,MSGL_WARN,"SUB: error recoding line.\n");
 			free(ot);
 			continue;
 		}
 		// In some stateful encodings, we must clear the state to handle the last character
-		if (iconv(icdsc, NULL, NULL,
+		if (iconv(cd, NULL, NULL,
 			  &op, &oleft) == (size_t)(-1)) {
 			mp_msg(MSGT_SUBREADER,MSGL_WARN,"SUB: error recoding line, can't clear encoding state.\n");
 		}
@@ -1159,6 +1251,21 @@ subtitle* subcp_recode (subtitle *sub)
 	}
 	return sub;
 }
+
+void	subcp_open (stream_t *st)
+{
+	icdsc = subcp_open_cd(st);
+}
+
+void	subcp_close (void)
+{
+	subcp_close_cd(&icdsc);
+}
+
+subtitle* subcp_recode (subtitle *sub)
+{
+	return subcp_recode_cd(icdsc, sub);
+}
 #endif
 
 #ifdef CONFIG_FRIBIDI
@@ -1288,6 +1395,32 @@ struct subreader {
     const char *name;
 };
 
+// subtitles read before sub_read_file() returns if the file is bigger
+#define SUB_FIRST_CHUNK 256
+
+struct sub_loader {
+    // parser state, used by the background thread once it runs
+    stream_t *fd;
+    const struct subreader *srp;
+    char *filename;
+    float fps;
+    int utf16, uses_time;
+    subtitle *first;            // subtitles read so far
+    subtitle *alloced_sub;
+    int sub_num, n_max, sub_errs;
+    volatile int quit;
+#ifdef CONFIG_ICONV
+    iconv_t icdsc;
+#endif
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;
+    int done;                   // the thread has finished
+    sub_data *ready;            // newest subtitles, see sub_update()
+#endif
+};
+
 #ifdef CONFIG_ENCA
 const char* guess_buffer_cp(unsigned char* buffer, int buflen, const char *preferred_language, const char *fallback)
 {
@@ -1349,84 +1482,24 @@ const char* guess_cp(stream_t *st, const char *preferred_language, const char *f
 #undef MAX_GUESS_BUFFER_SIZE
 #endif
 
-sub_data* sub_read_file (char *filename, float fps) {
-    int utf16;
-    stream_t* fd;
-    int n_max, n_first, i, j, sub_first, sub_orig;
-    subtitle *first, *second, *sub, *return_sub, *alloced_sub = NULL;
-    sub_data *subt_data;
-    int uses_time = 0, sub_num = 0, sub_errs = 0;
-    static const struct subreader sr[]=
-    {
-	    { sub_read_line_microdvd, NULL, "microdvd" },
-	    { sub_read_line_subrip, NULL, "subrip" },
-	    { sub_read_line_subviewer, NULL, "subviewer" },
-	    { sub_read_line_sami, NULL, "sami" },
-	    { sub_read_line_vplayer, NULL, "vplayer" },
-	    { sub_read_line_rt, NULL, "rt" },
-	    { sub_read_line_ssa, sub_pp_ssa, "ssa" },
-	    { sub_read_line_pjs, NULL, "pjs" },
-	    { sub_read_line_mpsub, NULL, "mpsub" },
-	    { sub_read_line_aqt, NULL, "aqt" },
-	    { sub_read_line_subviewer2, NULL, "subviewer 2.0" },
-	    { sub_read_line_subrip09, NULL, "subrip 0.9" },
-	    { sub_read_line_jacosub, NULL, "jacosub" },
-	    { sub_read_line_mpl2, NULL, "mpl2" }
-    };
-    const struct subreader *srp;
-
-    if(filename==NULL) return NULL; //qnx segfault
-    i = 0;
-    fd=open_stream (filename, NULL, &i); if (!fd) return NULL;
-
-    sub_format = SUB_INVALID;
-    for (utf16 = 0; sub_format == SUB_INVALID && utf16 < 3; utf16++) {
-        sub_format=sub_autodetect (fd, &uses_time, utf16);
-        stream_reset(fd);
-        stream_seek(fd,0);
-    }
-    utf16--;
-
-    mpsub_multiplier = (uses_time ? 100.0 : 1.0);
-    if (sub_format==SUB_INVALID) {mp_msg(MSGT_SUBREADER,MSGL_WARN,"SUB: Could not determine file format\n");return NULL;}
-    srp=sr+sub_format;
-    mp_msg(MSGT_SUBREADER, MSGL_V, "SUB: Detected subtitle file format: %s\n", srp->name);
-
-#ifdef CONFIG_ICONV
-    sub_utf8_prev=sub_utf8;
-    {
-	    int l,k;
-	    k = -1;
-	    if ((l=strlen(filename))>4){
-		    char *exts[] = {".utf", ".utf8", ".utf-8" };
-		    for (k=3;--k>=0;)
-			if (l >= strlen(exts[k]) && !strcasecmp(filename+(l - strlen(exts[k])), exts[k])){
-			    sub_utf8 = 1;
-			    break;
-			}
-	    }
-	    if (k<0) subcp_open(fd);
-    }
-#endif
-
-    sub_num=0;n_max=32;
-    first=malloc(n_max*sizeof(subtitle));
-    if(!first){
-#ifdef CONFIG_ICONV
-	  subcp_close();
-          sub_utf8=sub_utf8_prev;
-#endif
-	    return NULL;
-    }
+/**
+ * \brief read subtitles until there are limit of them or the file ends
+ * \return 1 if the limit was reached, 0 at the end of the file, -1 on error
+ */
+static int sub_parse(struct sub_loader *l, int limit)
+{
+    stream_t *fd = l->fd;
+    const struct subreader *srp = l->srp;
+    int utf16 = l->utf16;
+    int n_max = l->n_max, sub_num = l->sub_num, sub_errs = l->sub_errs;
+    subtitle *first = l->first, *sub = l->alloced_sub;
+    int i, j, ret = 0;
 
-#ifdef CONFIG_SORTSUB
-    alloced_sub =
-    sub = malloc(sizeof(subtitle));
-    //This is to deal with those formats (AQT & Subrip) which define the end of a subtitle
-    //as the beginning of the following
-    previous_sub_end = 0;
-#endif
     while(1){
+        if (sub_num >= limit || l->quit) {
+            ret = l->quit ? -1 : 1;
+            break;
+        }
         if(sub_num>=n_max){
             n_max+=16;
             first=realloc(first,n_max*sizeof(subtitle));
@@ -1438,19 +1511,15 @@ sub_data* sub_read_file (char *filename, float fps) {
         sub=srp->read(fd,sub,utf16);
         if(!sub) break;   // EOF
 #ifdef CONFIG_ICONV
-	if ((sub!=ERR) && sub_utf8 == 2) sub=subcp_recode(sub);
+	if ((sub!=ERR) && sub_utf8 == 2) sub=subcp_recode_cd(l->icdsc, sub);
 #endif
 #ifdef CONFIG_FRIBIDI
 	if (sub!=ERR) sub=sub_fribidi(sub,sub_utf8,0);
 #endif
 	if ( sub == ERR )
 	 {
-#ifdef CONFIG_ICONV
-          subcp_close();
-#endif
-    	  if ( first ) free(first);
-	  free(alloced_sub);
-	  return NULL;
+	  ret = -1;
+	  break;
 	 }
         // Apply any post processing that needs recoding first
         if ((sub!=ERR) && !sub_no_text_pp && srp->post) srp->post(sub);
@@ -1497,21 +1566,24 @@ sub_data* sub_read_file (char *filename, float fps) {
         if(sub==ERR) ++sub_errs; else ++sub_num; // Error vs. Valid
     }
 
-    free_stream(fd);
-
-#ifdef CONFIG_ICONV
-    subcp_close();
-#endif
-    free(alloced_sub);
 
-//    printf ("SUB: Subtitle format %s time.\n", uses_time?"uses":"doesn't use");
-    mp_msg(MSGT_SUBREADER, MSGL_V,"SUB: Read %i subtitles, %i bad line(s).\n",
-           sub_num, sub_errs);
+    l->first = first;
+    l->n_max = n_max;
+    l->sub_num = sub_num;
+    l->sub_errs = sub_errs;
+    return ret;
+}
 
-    if(sub_num<=0){
-	free(first);
-	return NULL;
-    }
+/**
+ * \brief fix the timing of the subtitles read and merge overlapping ones
+ * \param num number of subtitles, updated
+ * \return the subtitles, first or a new array if first was freed
+ */
+static subtitle *sub_process(subtitle *first, int *num, float fps, int uses_time)
+{
+    subtitle *second;
+    int n_max, n_first, i, j, sub_first, sub_orig;
+    int sub_num = *num;
 
     // we do overlap if the user forced it (suboverlap_enable == 2) or
     // the user didn't forced no-overlapsub and the format is Jacosub or Ssa.
@@ -1719,21 +1791,373 @@ if ((suboverlap_enabled == 2) ||
     }
     free(first);
 
-    return_sub = second;
+    *num = sub_num;
+    return second;
 } else { //if(suboverlap_enabled)
     adjust_subs_time(first, 6.0, fps, 1, sub_num, uses_time);/*~6 secs AST*/
-    return_sub = first;
 }
-    if (return_sub == NULL) return NULL;
+    return first;
+}
+
+/// Free the subtitles still owned by the parser.
+static void sub_parse_free(struct sub_loader *l)
+{
+    int i, j;
+
+    for (i = 0; i < l->sub_num; i++)
+        for (j = 0; j < l->first[i].lines; j++)
+            free(l->first[i].text[j]);
+    free(l->first);
+    l->first = NULL;
+    l->sub_num = 0;
+}
+
+/// Close the file once it has been read, or reading was abandoned.
+static void sub_parse_end(struct sub_loader *l)
+{
+    free_stream(l->fd);
+    l->fd = NULL;
+#ifdef CONFIG_ICONV
+    subcp_close_cd(&l->icdsc);
+#endif
+    free(l->alloced_sub);
+    l->alloced_sub = NULL;
+
+//    printf ("SUB: Subtitle format %s time.\n", uses_time?"uses":"doesn't use");
+    mp_msg(MSGT_SUBREADER, MSGL_V,"SUB: Read %i subtitles, %i bad line(s).\n",
+           l->sub_num, l->sub_errs);
+}
+
+/// Deep copy of the subtitles read so far, for a preview of the file.
+static subtitle *sub_copy(const subtitle *subs, int num)
+{
+    subtitle *copy = malloc(num * sizeof(subtitle));
+    int i, j;
+
+    if (!copy)
+        return NULL;
+    memcpy(copy, subs, num * sizeof(subtitle));
+    for (i = 0; i < num; i++)
+        for (j = 0; j < copy[i].lines; j++)
+            copy[i].text[j] = strdup(subs[i].text[j]);
+    return copy;
+}
+
+/**
+ * \brief make the sub_data for playback out of the parsed subtitles
+ * \param subs subtitles, now owned by the returned sub_data
+ */
+static sub_data *sub_make_data(struct sub_loader *l, subtitle *subs, int sub_num)
+{
+    sub_data *subt_data;
+
+    if (!subs || sub_num <= 0) {
+        free(subs);
+        return NULL;
+    }
+    subs = sub_process(subs, &sub_num, l->fps, l->uses_time);
+    if (subs == NULL) return NULL;
     subt_data = malloc(sizeof(sub_data));
-    subt_data->filename = strdup(filename);
-    subt_data->sub_uses_time = uses_time;
+    subt_data->filename = strdup(l->filename);
+    subt_data->sub_uses_time = l->uses_time;
     subt_data->sub_num = sub_num;
-    subt_data->sub_errs = sub_errs;
-    subt_data->subtitles = return_sub;
+    subt_data->sub_errs = l->sub_errs;
+    subt_data->subtitles = subs;
+    subt_data->sub_order = NULL;
+    subt_data->sub_end_tree = NULL;
+    subt_data->loader = NULL;
+    sub_index_build(subt_data);
     return subt_data;
 }
 
+#if HAVE_PTHREADS
+/*
+ * The readers keep their state in globals, so only one file is parsed at
+ * a time. A file whose reading goes on in the background holds the parser
+ * until it is done. Opening another file waits for that, so with several
+ * subtitle files only the first one becomes available early, the others
+ * are read one after the other as before.
+ */
+static pthread_mutex_t parser_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parser_idle = PTHREAD_COND_INITIALIZER;
+static int parser_busy;
+
+static void parser_acquire(void)
+{
+    pthread_mutex_lock(&parser_lock);
+    while (parser_busy)
+        pthread_cond_wait(&parser_idle, &parser_lock);
+    parser_busy = 1;
+    pthread_mutex_unlock(&parser_lock);
+}
+
+static void parser_release(void)
+{
+    pthread_mutex_lock(&parser_lock);
+    parser_busy = 0;
+    pthread_cond_signal(&parser_idle);
+    pthread_mutex_unlock(&parser_lock);
+}
+
+/*
+ * Reads the rest of the file. Every time the number of subtitles read
+ * doubles, a processed copy is handed to the main thread, which picks it
+ * up in sub_update(), so a file of any size costs O(n) to publish.
+ */
+static void *sub_loader_thread(void *arg)
+{
+    struct sub_loader *l = arg;
+    int limit = l->sub_num, r;
+
+    do {
+        sub_data *subd;
+
+        limit = limit > INT_MAX / 2 ? INT_MAX : 2 * limit;
+        r = sub_parse(l, limit);
+        if (r > 0)
+            subd = sub_make_data(l, sub_copy(l->first, l->sub_num), l->sub_num);
+        else {
+            sub_parse_end(l);
+            if (r < 0) {
+                if (!l->quit)
+                    mp_msg(MSGT_SUBREADER, MSGL_WARN, "SUB: Error after subtitle "
+                           "%d, ignoring the rest of the file.\n", l->sub_num);
+                sub_parse_free(l);
+                subd = NULL;
+            } else {
+                subd = sub_make_data(l, l->first, l->sub_num);
+                l->first = NULL;
+            }
+            parser_release();
+        }
+
+        pthread_mutex_lock(&l->lock);
+        if (subd) {
+            sub_free(l->ready);
+            l->ready = subd;
+        }
+        if (r <= 0) {
+            l->done = 1;
+            pthread_cond_broadcast(&l->done_cond);
+        }
+        pthread_mutex_unlock(&l->lock);
+    } while (r > 0);
+    return NULL;
+}
+
+static int sub_loader_start(struct sub_loader *l)
+{
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->done_cond, NULL);
+    if (pthread_create(&l->thread, NULL, sub_loader_thread, l)) {
+        pthread_mutex_destroy(&l->lock);
+        pthread_cond_destroy(&l->done_cond);
+        return 0;
+    }
+    return 1;
+}
+
+static void sub_loader_free(struct sub_loader *l)
+{
+    pthread_join(l->thread, NULL);
+    pthread_mutex_destroy(&l->lock);
+    pthread_cond_destroy(&l->done_cond);
+    sub_free(l->ready);
+    free(l->filename);
+    free(l);
+}
+#else
+#define parser_acquire()
+#define parser_release()
+#endif
+
+sub_data* sub_read_file (char *filename, float fps) {
+    int utf16;
+    stream_t* fd;
+    int i, r;
+    sub_data *subt_data;
+    int uses_time = 0;
+    struct sub_loader *l;
+    sub_sniff sniff;
+#ifdef CONFIG_ICONV
+    iconv_t cd = (iconv_t)(-1);
+#endif
+    static const struct subreader sr[]=
+    {
+	    { sub_read_line_microdvd, NULL, "microdvd" },
+	    { sub_read_line_subrip, NULL, "subrip" },
+	    { sub_read_line_subviewer, NULL, "subviewer" },
+	    { sub_read_line_sami, NULL, "sami" },
+	    { sub_read_line_vplayer, NULL, "vplayer" },
+	    { sub_read_line_rt, NULL, "rt" },
+	    { sub_read_line_ssa, sub_pp_ssa, "ssa" },
+	    { sub_read_line_pjs, NULL, "pjs" },
+	    { sub_read_line_mpsub, NULL, "mpsub" },
+	    { sub_read_line_aqt, NULL, "aqt" },
+	    { sub_read_line_subviewer2, NULL, "subviewer 2.0" },
+	    { sub_read_line_subrip09, NULL, "subrip 0.9" },
+	    { sub_read_line_jacosub, NULL, "jacosub" },
+	    { sub_read_line_mpl2, NULL, "mpl2" }
+    };
+    const struct subreader *srp;
+
+    if(filename==NULL) return NULL; //qnx segfault
+    i = 0;
+    fd=open_stream (filename, NULL, &i); if (!fd) return NULL;
+
+    // waits until the background reading of an earlier file is done
+    parser_acquire();
+
+    sub_format = SUB_INVALID;
+    memset(&sniff, 0, sizeof(sniff));
+    sniff.st = fd;
+    for (utf16 = 0; sub_format == SUB_INVALID && utf16 < 3; utf16++)
+        sub_format=sub_autodetect (&sniff, &uses_time, utf16);
+    utf16--;
+    free(sniff.buf);
+    stream_reset(fd);
+    stream_seek(fd,0);
+
+    mpsub_multiplier = (uses_time ? 100.0 : 1.0);
+    if (sub_format==SUB_INVALID) {
+        mp_msg(MSGT_SUBREADER,MSGL_WARN,"SUB: Could not determine file format\n");
+        free_stream(fd);
+        parser_release();
+        return NULL;
+    }
+    srp=sr+sub_format;
+    mp_msg(MSGT_SUBREADER, MSGL_V, "SUB: Detected subtitle file format: %s\n", srp->name);
+
+#ifdef CONFIG_ICONV
+    sub_utf8_prev=sub_utf8;
+    {
+	    int l,k;
+	    k = -1;
+	    if ((l=strlen(filename))>4){
+		    char *exts[] = {".utf", ".utf8", ".utf-8" };
+		    for (k=3;--k>=0;)
+			if (l >= strlen(exts[k]) && !strcasecmp(filename+(l - strlen(exts[k])), exts[k])){
+			    sub_utf8 = 1;
+			    break;
+			}
+	    }
+	    if (k<0) cd = subcp_open_cd(fd);
+    }
+#endif
+
+    l = calloc(1, sizeof(struct sub_loader));
+    if (l) {
+        l->n_max = 32;
+        l->first = malloc(l->n_max * sizeof(subtitle));
+    }
+    if(!l || !l->first){
+#ifdef CONFIG_ICONV
+	  subcp_close_cd(&cd);
+          sub_utf8=sub_utf8_prev;
+#endif
+	    free(l);
+	    free_stream(fd);
+	    parser_release();
+	    return NULL;
+    }
+    l->fd = fd;
+    l->srp = srp;
+#ifdef CONFIG_ICONV
+    l->icdsc = cd;
+#endif
+    l->utf16 = utf16;
+    l->uses_time = uses_time;
+    l->fps = fps;
+    l->filename = strdup(filename);
+
+#ifdef CONFIG_SORTSUB
+    l->alloced_sub = malloc(sizeof(subtitle));
+    //This is to deal with those formats (AQT & Subrip) which define the end of a subtitle
+    //as the beginning of the following
+    previous_sub_end = 0;
+#endif
+
+    // start playback with the beginning of big files and read the rest later
+    r = sub_parse(l, SUB_FIRST_CHUNK);
+#if HAVE_PTHREADS
+    if (r > 0) {
+        subt_data = sub_make_data(l, sub_copy(l->first, l->sub_num), l->sub_num);
+        if (subt_data && sub_loader_start(l)) {
+            mp_msg(MSGT_SUBREADER, MSGL_V, "SUB: Reading the rest of %s in the background.\n", filename);
+            subt_data->loader = l;
+            return subt_data;
+        }
+        sub_free(subt_data);
+    }
+#endif
+    if (r > 0)
+        r = sub_parse(l, INT_MAX);
+    sub_parse_end(l);
+    parser_release();
+
+    subt_data = NULL;
+    if (r < 0)
+        sub_parse_free(l);
+    else
+        subt_data = sub_make_data(l, l->first, l->sub_num);
+    free(l->filename);
+    free(l);
+    return subt_data;
+}
+
+/**
+ * \brief pick up the subtitles read in the background since the last call
+ * \return 1 if subd->subtitles changed, pointers into it are invalid then
+ */
+int sub_update(sub_data *subd)
+{
+#if HAVE_PTHREADS
+    struct sub_loader *l = subd->loader;
+    sub_data *ready;
+    int done;
+
+    if (!l)
+        return 0;
+    pthread_mutex_lock(&l->lock);
+    ready = l->ready;
+    l->ready = NULL;
+    done = l->done;
+    pthread_mutex_unlock(&l->lock);
+    if (done) {
+        sub_loader_free(l);
+        subd->loader = NULL;
+    }
+    if (!ready)
+        return 0;
+
+    FFSWAP(subtitle *, subd->subtitles, ready->subtitles);
+    FFSWAP(int, subd->sub_num, ready->sub_num);
+    FFSWAP(int *, subd->sub_order, ready->sub_order);
+    FFSWAP(unsigned long *, subd->sub_end_tree, ready->sub_end_tree);
+    subd->sub_errs = ready->sub_errs;
+    sub_free(ready);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/// Wait until the whole file has been read.
+void sub_wait(sub_data *subd)
+{
+#if HAVE_PTHREADS
+    struct sub_loader *l;
+
+    if (!subd || !(l = subd->loader))
+        return;
+    pthread_mutex_lock(&l->lock);
+    while (!l->done)
+        pthread_cond_wait(&l->done_cond, &l->lock);
+    pthread_mutex_unlock(&l->lock);
+    sub_update(subd);
+#endif
+}
+
 #if 0
 char * strreplace( char * in,char * what,char * whereof )
 {
@@ -1787,17 +2211,6 @@ static void strcpy_strip_ext(char *d, char *s)
     }
 }
 
-static void strcpy_get_ext(char *d, char *s)
-{
-    char *tmp = strrchr(s,'.');
-    if (!tmp) {
-	strcpy(d, "");
-	return;
-    } else {
-	strcpy(d, tmp+1);
-   }
-}
-
 static int whiteonly(char *s)
 {
     while (*s) {
@@ -1824,13 +2237,134 @@ static int compare_sub_priority(const void *a, const void *b)
     }
 }
 
+static const char * const sub_exts[] = {  "utf", "utf8", "utf-8", "sub", "srt", "smi", "rt", "txt", "ssa", "aqt", "jss", "js", "ass", NULL};
+
+/*
+ * Subtitle files found in a directory. Directories are scanned again only
+ * when their modification time changes, which helps with big directories
+ * on network filesystems that are looked at for every file played.
+ */
+#define SUB_DIR_CACHE 8
+
+typedef struct sub_dir_entry {
+    char *name;
+    char *trim;     // name without extension in lower case, whitespace trimmed
+    int ext;        // index in sub_exts
+} sub_dir_entry;
+
+typedef struct sub_dir {
+    char *path;
+    time_t mtime;
+    int trusted;    // not modified within the second it was scanned
+    sub_dir_entry *entries;
+    int count;
+} sub_dir;
+
+static sub_dir sub_dirs[SUB_DIR_CACHE];
+static int sub_dirs_next;
+
+static void sub_dir_clear(sub_dir *dir)
+{
+    int i;
+
+    for (i = 0; i < dir->count; i++) {
+        free(dir->entries[i].name);
+        free(dir->entries[i].trim);
+    }
+    free(dir->entries);
+    free(dir->path);
+    memset(dir, 0, sizeof(sub_dir));
+}
+
+static int sub_dir_scan(sub_dir *dir, const char *path)
+{
+    char tmp[2 * 256 + 2];
+    int max = 0;
+    DIR *d;
+    struct dirent *de;
+
+    if (!(d = opendir(path)))
+        return 0;
+    dir->path = strdup(path);
+    while ((de = readdir(d))) {
+        const char *ext = strrchr(de->d_name, '.');
+        sub_dir_entry *e;
+        int i;
+
+        // only keep names with a subtitle extension
+        if (!ext || strlen(de->d_name) >= sizeof(tmp) / 2)
+            continue;
+        for (i = 0; sub_exts[i]; i++)
+            if (strcasecmp(sub_exts[i], ext + 1) == 0)
+                break;
+        if (!sub_exts[i])
+            continue;
+
+        if (dir->count >= max) {
+            sub_dir_entry *entries;
+            max = max ? 2 * max : 16;
+            entries = realloc(dir->entries, max * sizeof(sub_dir_entry));
+            if (!entries)
+                break;
+            dir->entries = entries;
+        }
+        e = &dir->entries[dir->count];
+        strcpy_strip_ext(tmp, de->d_name);
+        strcpy_trim(tmp + sizeof(tmp) / 2, tmp);
+        e->name = strdup(de->d_name);
+        e->trim = strdup(tmp + sizeof(tmp) / 2);
+        e->ext = i;
+        if (!e->name || !e->trim) {
+            free(e->name);
+            free(e->trim);
+            break;
+        }
+        dir->count++;
+    }
+    closedir(d);
+    return 1;
+}
+
+/// Return the subtitle files in path, from the cache if it is up to date.
+static sub_dir *sub_dir_index(const char *path)
+{
+    struct stat st;
+    time_t now = time(NULL);
+    sub_dir *dir = NULL;
+    int i;
+
+    if (stat(path, &st) < 0)
+        return NULL;
+    for (i = 0; i < SUB_DIR_CACHE; i++)
+        if (sub_dirs[i].path && !strcmp(sub_dirs[i].path, path)) {
+            dir = &sub_dirs[i];
+            break;
+        }
+    if (dir && dir->trusted && dir->mtime == st.st_mtime) {
+        mp_msg(MSGT_SUBREADER, MSGL_DBG2, "SUB: Using the cached index of directory %s\n", path);
+        return dir;
+    }
+    if (!dir) {
+        dir = &sub_dirs[sub_dirs_next];
+        sub_dirs_next = (sub_dirs_next + 1) % SUB_DIR_CACHE;
+    }
+    sub_dir_clear(dir);
+    if (!sub_dir_scan(dir, path)) {
+        sub_dir_clear(dir);
+        return NULL;
+    }
+    // changes in the same second would not change the modification time
+    dir->mtime = st.st_mtime;
+    dir->trusted = st.st_mtime < now - 1;
+    return dir;
+}
+
 char** sub_filenames(const char* path, char *fname)
 {
     char *f_dir, *f_fname, *f_fname_noext, *f_fname_trim, *tmp, *tmp_sub_id;
-    char *tmp_fname_noext, *tmp_fname_trim, *tmp_fname_ext, *tmpresult;
+    char *tmpresult;
 
-    int len, pos, found, i, j;
-    char * sub_exts[] = {  "utf", "utf8", "utf-8", "sub", "srt", "smi", "rt", "txt", "ssa", "aqt", "jss", "js", "ass", NULL};
+    int len, pos, i, j, k, first_ext;
     subfn *result;
     char **result2;
 
@@ -1838,8 +2372,7 @@ char** sub_filenames(const char* path, char *fname)
 
     FILE *f;
 
-    DIR *d;
-    struct dirent *de;
+    sub_dir *dir;
 
     len = (strlen(fname) > 256 ? strlen(fname) : 256)
 	+(strlen(path) > 256 ? strlen(path) : 256)+2;
@@ -1849,10 +2382,6 @@ char** sub_filenames(const char* path, char *fname)
     f_fname_noext = malloc(len);
     f_fname_trim = malloc(len);
 
-    tmp_fname_noext = malloc(len);
-    tmp_fname_trim = malloc(len);
-    tmp_fname_ext = malloc(len);
-
     tmpresult = malloc(len);
 
     result = malloc(sizeof(subfn)*MAX_SUBTITLE_FILES);
@@ -1886,95 +2415,86 @@ char** sub_filenames(const char* path, char *fname)
 	strcpy_trim(tmp_sub_id, dvdsub_lang);
     }
 
+    // the first three extensions are for UTF-8 files
+#ifdef CONFIG_ICONV
+#ifdef CONFIG_ENCA
+    first_ext = (sub_cp && strncasecmp(sub_cp, "enca", 4) != 0) ? 3 : 0;
+#else
+    first_ext = sub_cp ? 3 : 0;
+#endif
+#else
+    first_ext = 0;
+#endif
+
     // 0 = nothing
     // 1 = any subtitle file
     // 2 = any sub file containing movie name
     // 3 = sub file containing movie name and the lang extension
     for (j = 0; j <= 1; j++) {
-	d = opendir(j == 0 ? f_dir : path);
-	if (d) {
-	    while ((de = readdir(d))) {
-		// retrieve various parts of the filename
-		strcpy_strip_ext(tmp_fname_noext, de->d_name);
-		strcpy_get_ext(tmp_fname_ext, de->d_name);
-		strcpy_trim(tmp_fname_trim, tmp_fname_noext);
+	dir = sub_dir_index(j == 0 ? f_dir : path);
+	if (dir) {
+	    for (k = 0; k < dir->count && subcnt < MAX_SUBTITLE_FILES; k++) {
+		const char *tmp_fname_trim = dir->entries[k].trim;
+		int prio = 0;
 
 		// does it end with a subtitle extension?
-		found = 0;
-#ifdef CONFIG_ICONV
-#ifdef CONFIG_ENCA
-		for (i = ((sub_cp && strncasecmp(sub_cp, "enca", 4) != 0) ? 3 : 0); sub_exts[i]; i++) {
-#else
-		for (i = (sub_cp ? 3 : 0); sub_exts[i]; i++) {
-#endif
-#else
-		for (i = 0; sub_exts[i]; i++) {
-#endif
-		    if (strcasecmp(sub_exts[i], tmp_fname_ext) == 0) {
-			found = 1;
-			break;
-		    }
-		}
+		i = dir->entries[k].ext;
+		if (i < first_ext)
+		    continue;
 
 		// we have a (likely) subtitle file
-		if (found) {
-		    int prio = 0;
-		    if (!prio && tmp_sub_id)
-		    {
-			sprintf(tmpresult, "%s %s", f_fname_trim, tmp_sub_id);
-			mp_msg(MSGT_SUBREADER, MSGL_DBG2,"Potential sub: %s\n", tmp_fname_trim);
-			if (strcmp(tmp_fname_trim, tmpresult) == 0 && sub_match_fuzziness >= 1) {
-			    // matches the movie name + lang extension
-			    prio = 5;
-			}
-		    }
-		    if (!prio && strcmp(tmp_fname_trim, f_fname_trim) == 0) {
-			// matches the movie name
-			prio = 4;
+		if (!prio && tmp_sub_id)
+		{
+		    sprintf(tmpresult, "%s %s", f_fname_trim, tmp_sub_id);
+		    mp_msg(MSGT_SUBREADER, MSGL_DBG2,"Potential sub: %s\n", tmp_fname_trim);
+		    if (strcmp(tmp_fname_trim, tmpresult) == 0 && sub_match_fuzziness >= 1) {
+			// matches the movie name + lang extension
+			prio = 5;
 		    }
-		    if (!prio && (tmp = strstr(tmp_fname_trim, f_fname_trim)) && (sub_match_fuzziness >= 1)) {
-			// contains the movie name
-			tmp += strlen(f_fname_trim);
-			if (tmp_sub_id && strstr(tmp, tmp_sub_id)) {
-			    // with sub_id specified prefer localized subtitles
-			    prio = 3;
-			} else if ((tmp_sub_id == NULL) && whiteonly(tmp)) {
-			    // without sub_id prefer "plain" name
-			    prio = 3;
-			} else {
-			    // with no localized subs found, try any else instead
-			    prio = 2;
-			}
+		}
+		if (!prio && strcmp(tmp_fname_trim, f_fname_trim) == 0) {
+		    // matches the movie name
+		    prio = 4;
+		}
+		if (!prio && (tmp = strstr(tmp_fname_trim, f_fname_trim)) && (sub_match_fuzziness >= 1)) {
+		    // contains the movie name
+		    tmp += strlen(f_fname_trim);
+		    if (tmp_sub_id && strstr(tmp, tmp_sub_id)) {
+			// with sub_id specified prefer localized subtitles
+			prio = 3;
+		    } else if ((tmp_sub_id == NULL) && whiteonly(tmp)) {
+			// without sub_id prefer "plain" name
+			prio = 3;
+		    } else {
+			// with no localized subs found, try any else instead
+			prio = 2;
 		    }
-		    if (!prio) {
-			// doesn't contain the movie name
-			// don't try in the mplayer subtitle directory
-			if ((j == 0) && (sub_match_fuzziness >= 2)) {
-			    prio = 1;
-			}
+		}
+		if (!prio) {
+		    // doesn't contain the movie name
+		    // don't try in the mplayer subtitle directory
+		    if ((j == 0) && (sub_match_fuzziness >= 2)) {
+			prio = 1;
 		    }
+		}
 
-		    if (prio) {
-			prio += prio;
+		if (prio) {
+		    prio += prio;
 #ifdef CONFIG_ICONV
-			if (i<3){ // prefer UTF-8 coded
-			    prio++;
-			}
+		    if (i<3){ // prefer UTF-8 coded
+			prio++;
+		    }
 #endif
-			sprintf(tmpresult, "%s%s", j == 0 ? f_dir : path, de->d_name);
+		    sprintf(tmpresult, "%s%s", j == 0 ? f_dir : path, dir->entries[k].name);
 //			fprintf(stderr, "%s priority %d\n", tmpresult, prio);
-			if ((f = fopen(tmpresult, "rt"))) {
-			    fclose(f);
-			    result[subcnt].priority = prio;
-			    result[subcnt].fname = strdup(tmpresult);
-			    subcnt++;
-			}
+		    if ((f = fopen(tmpresult, "rt"))) {
+			fclose(f);
+			result[subcnt].priority = prio;
+			result[subcnt].fname = strdup(tmpresult);
+			subcnt++;
 		    }
-
 		}
-		if (subcnt >= MAX_SUBTITLE_FILES) break;
 	    }
-	    closedir(d);
 	}
 
     }
@@ -1986,10 +2506,6 @@ char** sub_filenames(const char* path, char *fname)
     free(f_fname_noext);
     free(f_fname_trim);
 
-    free(tmp_fname_noext);
-    free(tmp_fname_trim);
-    free(tmp_fname_ext);
-
     free(tmpresult);
 
     qsort(result, subcnt, sizeof(subfn), compare_sub_priority);
@@ -2272,14 +2788,170 @@ void sub_free( sub_data * subd )
 
     if ( !subd ) return;
 
+#if HAVE_PTHREADS
+    if (subd->loader) {
+        subd->loader->quit = 1;
+        sub_loader_free(subd->loader);
+    }
+#endif
     for (i = 0; i < subd->sub_num; i++)
         for (j = 0; j < subd->subtitles[i].lines; j++)
             free( subd->subtitles[i].text[j] );
     free( subd->subtitles );
     free( subd->filename );
+    free( subd->sub_order );
+    free( subd->sub_end_tree );
     free( subd );
 }
 
+typedef struct {
+    unsigned long start;
+    int idx;
+} sub_start_t;
+
+static int compare_sub_start(const void *a, const void *b)
+{
+    const sub_start_t *x = a, *y = b;
+    if (x->start != y->start)
+        return x->start < y->start ? -1 : 1;
+    return x->idx - y->idx;
+}
+
+/// number of leaves of the end time tree for n subtitles
+static int sub_tree_leaves(int n)
+{
+    int leaves = 1;
+    while (leaves < n)
+        leaves <<= 1;
+    return leaves;
+}
+
+/**
+ * \brief build the index used by sub_index_find()
+ *
+ * The subtitles are ordered by start time, the array itself is usually
+ * sorted already. A binary search finds the ones that started before some
+ * time. A tree holding the latest end time of each range of them then finds
+ * the last one still shown in O(log n) as well, even if a long subtitle
+ * overlaps many later ones.
+ * \return 0 if out of memory
+ */
+int sub_index_build(sub_data *subd)
+{
+    subtitle *subs = subd->subtitles;
+    int n = subd->sub_num;
+    int i, leaves, sorted = 1;
+
+    free(subd->sub_order);
+    free(subd->sub_end_tree);
+    subd->sub_order = NULL;
+    subd->sub_end_tree = NULL;
+    if (n <= 0)
+        return 0;
+    leaves = sub_tree_leaves(n);
+    subd->sub_order = malloc(n * sizeof(int));
+    subd->sub_end_tree = calloc(2 * leaves, sizeof(unsigned long));
+    if (!subd->sub_order || !subd->sub_end_tree) {
+        free(subd->sub_order);
+        free(subd->sub_end_tree);
+        subd->sub_order = NULL;
+        subd->sub_end_tree = NULL;
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        subd->sub_order[i] = i;
+        if (i && subs[i].start < subs[i - 1].start)
+            sorted = 0;
+    }
+    if (!sorted) {
+        sub_start_t *tmp = malloc(n * sizeof(sub_start_t));
+        if (tmp) {
+            for (i = 0; i < n; i++) {
+                tmp[i].start = subs[i].start;
+                tmp[i].idx = i;
+            }
+            qsort(tmp, n, sizeof(sub_start_t), compare_sub_start);
+            for (i = 0; i < n; i++)
+                subd->sub_order[i] = tmp[i].idx;
+            free(tmp);
+        }
+    }
+    // node k covers nodes 2k and 2k+1, the leaves follow the inner nodes
+    for (i = 0; i < n; i++)
+        subd->sub_end_tree[leaves + i] = subs[subd->sub_order[i]].end;
+    for (i = leaves - 1; i >= 1; i--)
+        subd->sub_end_tree[i] = FFMAX(subd->sub_end_tree[2 * i],
+                                      subd->sub_end_tree[2 * i + 1]);
+    return 1;
+}
+
+/// last position before lo in sub_order of a subtitle ending at or after key
+static int sub_tree_last(const unsigned long *tree, int leaves, int lo,
+                         unsigned long key)
+{
+    int k;
+
+    if (lo <= 0)
+        return -1;
+    k = leaves + lo - 1;
+    // move left to the nearest subtree with a match
+    while (tree[k] < key) {
+        while (!(k & 1))
+            k >>= 1;
+        if (k == 1)
+            return -1;
+        k--;
+    }
+    // and down to its rightmost match
+    while (k < leaves)
+        k = tree[2 * k + 1] >= key ? 2 * k + 1 : 2 * k;
+    return k - leaves;
+}
+
+/**
+ * \brief find the subtitle shown at key
+ *
+ * Of overlapping subtitles the one that started last is shown.
+ * \param last set to the subtitle that started last at or before key,
+ *             -1 if there is none
+ * \param next set to the first key after key for which the result may
+ *             be different
+ * \return index of the subtitle or -1 if there is none
+ */
+int sub_index_find(sub_data *subd, unsigned long key, int *last,
+                   unsigned long *next)
+{
+    subtitle *subs = subd->subtitles;
+    int *order = subd->sub_order;
+    int lo = 0, hi = subd->sub_num, i;
+
+    if (!order && !sub_index_build(subd)) {
+        // empty or out of memory
+        *last = -1;
+        *next = ULONG_MAX;
+        return -1;
+    }
+    order = subd->sub_order;
+    // lo = number of subtitles that started at or before key
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (subs[order[mid]].start <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *last = lo ? order[lo - 1] : -1;
+    *next = lo < subd->sub_num ? subs[order[lo]].start : ULONG_MAX;
+    i = sub_tree_last(subd->sub_end_tree, sub_tree_leaves(subd->sub_num),
+                      lo, key);
+    if (i < 0)
+        return -1;
+    // when it ends an earlier one may still be shown
+    if (subs[order[i]].end < *next)
+        *next = subs[order[i]].end + 1;
+    return order[i];
+}
+
 #define MAX_SUBLINE 512
 /**
  * \brief parse text and append it to subtitle in sub
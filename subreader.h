@@ -78,6 +78,11 @@ typedef struct {
     int sub_uses_time;
     int sub_num;          // number of subtitle structs
     int sub_errs;
+    // index for sub_index_find(), built by sub_index_build()
+    int *sub_order;              // subtitles sorted by start time
+    unsigned long *sub_end_tree; // max-end segment tree over sub_order
+    // set while the rest of the file is read in the background
+    struct sub_loader *loader;
 } sub_data;
 
 extern char *fribidi_charset;
@@ -103,6 +108,11 @@ void dump_microdvd(sub_data* subd, float fps);
 void dump_jacosub(sub_data* subd, float fps);
 void dump_sami(sub_data* subd, float fps);
 void sub_free( sub_data * subd );
+int sub_update(sub_data *subd);
+void sub_wait(sub_data *subd);
+int sub_index_build(sub_data *subd);
+int sub_index_find(sub_data *subd, unsigned long key, int *last,
+                   unsigned long *next);
 void find_sub(sub_data* subd,int key);
 void step_sub(sub_data *subd, float pts, int movement);
 void sub_add_text(subtitle *sub, const char *txt, int len, double endpts);
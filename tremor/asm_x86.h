@@ -0,0 +1,110 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis 'TREMOR' CODEC SOURCE CODE.   *
+ *                                                                  *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis 'TREMOR' SOURCE CODE IS (C) COPYRIGHT 1994-2002    *
+ * BY THE Xiph.Org FOUNDATION http://www.xiph.org/                  *
+ *                                                                  *
+ ********************************************************************
+
+ function: x86-64 SSE2 vector math
+
+ ********************************************************************/
+
+#include "config.h"
+
+#if ARCH_X86_64 && HAVE_SSE2 && !defined(_LOW_ACCURACY_)
+
+#ifndef _V_SSE2_MATH
+#define _V_SSE2_MATH
+
+/*
+ * SSE2 has no signed 32x32->64 multiply, only the unsigned pmuludq on
+ * lanes 0 and 2.  Every vectorized product in tremor has a lookup table
+ * value (window, sin/cos, floor dB) as second factor, and those are never
+ * negative.  The signed product is then the unsigned one minus y<<32
+ * where x is negative, which only touches the high word.  The results are
+ * identical to MULT31() and MULT31_SHIFT15() in misc.h.
+ */
+
+static const ogg_int32_t __attribute__((aligned(16)))
+  sse2_hi_mask[4]={0,-1,0,-1};
+
+/* a=MULT31(a,b) on four lanes, b>=0; clobbers t0 and t1 */
+#define SSE2_MULT31(a,b,t0,t1)			\
+	"pshufd  $0xf5, %%" a ", %%" t0 "\n\t"	\
+	"pshufd  $0xf5, %%" b ", %%" t1 "\n\t"	\
+	"pmuludq %%" t1 ", %%" t0 "\n\t"	\
+	"movdqa  %%" a ", %%" t1 "\n\t"		\
+	"psrad   $31, %%" t1 "\n\t"		\
+	"pand    %%" b ", %%" t1 "\n\t"		\
+	"pmuludq %%" b ", %%" a "\n\t"		\
+	"psrlq   $32, %%" a "\n\t"		\
+	"pand    %[hi], %%" t0 "\n\t"		\
+	"por     %%" t0 ", %%" a "\n\t"		\
+	"psubd   %%" t1 ", %%" a "\n\t"		\
+	"pslld   $1, %%" a "\n\t"
+
+/* d[i]=MULT31(d[i],w[i]) */
+static inline void vect_mult31_fw(ogg_int32_t *d, LOOKUP_T *w, int n) {
+  for(;n>=4;n-=4,d+=4,w+=4)
+    __asm__ volatile("movdqu  (%0), %%xmm0\n\t"
+		     "movdqu  (%1), %%xmm1\n\t"
+		     SSE2_MULT31("xmm0","xmm1","xmm2","xmm3")
+		     "movdqu  %%xmm0, (%0)\n\t"
+		     :
+		     : "r"(d), "r"(w), [hi]"m"(*sse2_hi_mask)
+		     : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+  for(;n>0;n--,d++,w++)
+    *d=MULT31(*d,*w);
+}
+
+/* d[i]=MULT31(d[i],w[-i]) */
+static inline void vect_mult31_bw(ogg_int32_t *d, LOOKUP_T *w, int n) {
+  for(;n>=4;n-=4,d+=4,w-=4)
+    __asm__ volatile("movdqu  (%0), %%xmm0\n\t"
+		     "movdqu  -12(%1), %%xmm1\n\t"
+		     "pshufd  $0x1b, %%xmm1, %%xmm1\n\t"
+		     SSE2_MULT31("xmm0","xmm1","xmm2","xmm3")
+		     "movdqu  %%xmm0, (%0)\n\t"
+		     :
+		     : "r"(d), "r"(w), [hi]"m"(*sse2_hi_mask)
+		     : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+  for(;n>0;n--,d++,w--)
+    *d=MULT31(*d,*w);
+}
+
+/* d[i]=MULT31_SHIFT15(d[i],y[i]) */
+static inline void vect_mult31_shift15(ogg_int32_t *d, const ogg_int32_t *y,
+				       int n) {
+  for(;n>=4;n-=4,d+=4,y+=4)
+    __asm__ volatile("movdqu  (%0), %%xmm0\n\t"
+		     "movdqu  (%1), %%xmm1\n\t"
+		     "pshufd  $0xf5, %%xmm0, %%xmm2\n\t"
+		     "pshufd  $0xf5, %%xmm1, %%xmm3\n\t"
+		     "pmuludq %%xmm3, %%xmm2\n\t"
+		     "movdqa  %%xmm0, %%xmm3\n\t"
+		     "psrad   $31, %%xmm3\n\t"
+		     "pand    %%xmm1, %%xmm3\n\t"
+		     "pslld   $17, %%xmm3\n\t"
+		     "pmuludq %%xmm1, %%xmm0\n\t"
+		     "psrlq   $15, %%xmm0\n\t"
+		     "psrlq   $15, %%xmm2\n\t"
+		     "pshufd  $0x08, %%xmm0, %%xmm0\n\t"
+		     "pshufd  $0x08, %%xmm2, %%xmm2\n\t"
+		     "punpckldq %%xmm2, %%xmm0\n\t"
+		     "psubd   %%xmm3, %%xmm0\n\t"
+		     "movdqu  %%xmm0, (%0)\n\t"
+		     :
+		     : "r"(d), "r"(y)
+		     : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+  for(;n>0;n--,d++,y++)
+    *d=MULT31_SHIFT15(*d,*y);
+}
+
+#endif
+#endif
@@ -282,6 +282,13 @@ static const ogg_int32_t FLOOR_fromdB_LOOKUP[256]={
   XdB(0x69f80e9a), XdB(0x70dafda8), XdB(0x78307d76), XdB(0x7fffffff),
 };
 
+#ifdef _V_SSE2_MATH
+/* only store the gains, floor1_inverse2() multiplies them in at once */
+#define FLOOR_APPLY(d,y) ((d)=FLOOR_fromdB_LOOKUP[y])
+#else
+#define FLOOR_APPLY(d,y) ((d)=MULT31_SHIFT15(d,FLOOR_fromdB_LOOKUP[y]))
+#endif
+
 static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d){
   int dy=y1-y0;
   int adx=x1-x0;
@@ -294,7 +301,7 @@ static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d){
 
   ady-=abs(base*adx);
 
-  d[x]= MULT31_SHIFT15(d[x],FLOOR_fromdB_LOOKUP[y]);
+  FLOOR_APPLY(d[x],y);
 
   while(++x<x1){
     err=err+ady;
@@ -304,7 +311,7 @@ static void render_line(int x0,int x1,int y0,int y1,ogg_int32_t *d){
     }else{
       y+=base;
     }
-    d[x]= MULT31_SHIFT15(d[x],FLOOR_fromdB_LOOKUP[y]);
+    FLOOR_APPLY(d[x],y);
   }
 }
 
@@ -410,6 +417,11 @@ static int floor1_inverse2(vorbis_block *vb,vorbis_look_floor *in,void *memo,
     int hx=0;
     int lx=0;
     int ly=fit_value[0]*info->mult;
+#ifdef _V_SSE2_MATH
+    ogg_int32_t *gain=(ogg_int32_t *)_vorbis_block_alloc(vb,look->n*sizeof(*gain));
+#else
+    ogg_int32_t *gain=out;
+#endif
     for(j=1;j<look->posts;j++){
       int current=look->forward_index[j];
       int hy=fit_value[current]&0x7fff;
@@ -418,12 +430,15 @@ static int floor1_inverse2(vorbis_block *vb,vorbis_look_floor *in,void *memo,
 	hy*=info->mult;
 	hx=info->postlist[current];
 
-	render_line(lx,hx,ly,hy,out);
+	render_line(lx,hx,ly,hy,gain);
 
 	lx=hx;
 	ly=hy;
       }
     }
+#ifdef _V_SSE2_MATH
+    vect_mult31_shift15(out,gain,hx);
+#endif
     for(j=hx;j<n;j++)out[j]*=ly; /* be certain */
     return(1);
   }
@@ -144,6 +144,84 @@ STIN void mdct_butterfly_32(DATA_TYPE *x){
 	   mdct_butterfly_16(x+16);
 }
 
+#ifdef _V_SSE2_MATH
+
+static const ogg_int32_t __attribute__((aligned(16)))
+  sse2_lo_mask[4]={-1,0,-1,0};
+
+/* r=x1-x2 / x1-x2 with odd lanes negated / x2-x1, into xmm4 */
+#define BF_X1_X2 "movdqa  %%xmm0, %%xmm4\n\t" \
+		 "psubd   %%xmm1, %%xmm4\n\t"
+#define BF_X1_X2_NEG BF_X1_X2 \
+		 "pxor    %[hi], %%xmm4\n\t" \
+		 "psubd   %[hi], %%xmm4\n\t"
+#define BF_X2_X1 "movdqa  %%xmm1, %%xmm4\n\t" \
+		 "psubd   %%xmm0, %%xmm4\n\t"
+
+/*
+ * Two of the XPROD31/XNPROD31 steps of mdct_butterfly_generic() at once,
+ * on X1[0..3] and X2[0..3].  The sin/cos pair for x[0..1] is at TL, the
+ * one for x[2..3] at TH.  P and Q select which of r (xmm4) and r with
+ * the lanes of each pair swapped (xmm5) is multiplied by the cosines and
+ * sines, NEG selects the lanes where the sine products are subtracted.
+ */
+#define BUTTERFLY_SSE2(X1,X2,TL,TH,DIFF,P,Q,NEG)		\
+  __asm__ volatile("movdqu  (%[x1]), %%xmm0\n\t"		\
+		   "movdqu  (%[x2]), %%xmm1\n\t"		\
+		   "movq    (%[tl]), %%xmm2\n\t"		\
+		   "movq    (%[th]), %%xmm3\n\t"		\
+		   "punpcklqdq %%xmm3, %%xmm2\n\t"		\
+		   DIFF						\
+		   "paddd   %%xmm1, %%xmm0\n\t"		\
+		   "movdqu  %%xmm0, (%[x1])\n\t"		\
+		   "pshufd  $0xb1, %%xmm4, %%xmm5\n\t"	\
+		   "pshufd  $0xa0, %%xmm2, %%xmm6\n\t"	\
+		   "pshufd  $0xf5, %%xmm2, %%xmm7\n\t"	\
+		   "movdqa  %%" P ", %%xmm0\n\t"		\
+		   SSE2_MULT31("xmm0","xmm6","xmm1","xmm3")	\
+		   "movdqa  %%" Q ", %%xmm2\n\t"		\
+		   SSE2_MULT31("xmm2","xmm7","xmm1","xmm3")	\
+		   "pxor    %[neg], %%xmm2\n\t"		\
+		   "psubd   %[neg], %%xmm2\n\t"		\
+		   "paddd   %%xmm2, %%xmm0\n\t"		\
+		   "movdqu  %%xmm0, (%[x2])\n\t"		\
+		   :						\
+		   : [x1]"r"(X1), [x2]"r"(X2), [tl]"r"(TL), [th]"r"(TH), \
+		     [hi]"m"(*sse2_hi_mask), [neg]"m"(*NEG)	\
+		   : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", \
+		     "xmm6", "xmm7", "memory")
+
+/* same as the C version below, the table is walked with step */
+STIN void mdct_butterfly_generic(DATA_TYPE *x,int points,int step){
+
+  LOOKUP_T *T   = sincos_lookup0;
+  DATA_TYPE *x1        = x + points      - 8;
+  DATA_TYPE *x2        = x + (points>>1) - 8;
+
+  do{
+    BUTTERFLY_SSE2(x1+4,x2+4,T+step,T,BF_X1_X2_NEG,"xmm5","xmm4",sse2_hi_mask);
+    BUTTERFLY_SSE2(x1,x2,T+3*step,T+2*step,BF_X1_X2_NEG,"xmm5","xmm4",sse2_hi_mask);
+    T+=4*step; x1-=8; x2-=8;
+  }while(T<sincos_lookup0+1024);
+  do{
+    BUTTERFLY_SSE2(x1+4,x2+4,T-step,T,BF_X1_X2,"xmm4","xmm5",sse2_lo_mask);
+    BUTTERFLY_SSE2(x1,x2,T-3*step,T-2*step,BF_X1_X2,"xmm4","xmm5",sse2_lo_mask);
+    T-=4*step; x1-=8; x2-=8;
+  }while(T>sincos_lookup0);
+  do{
+    BUTTERFLY_SSE2(x1+4,x2+4,T+step,T,BF_X2_X1,"xmm4","xmm5",sse2_hi_mask);
+    BUTTERFLY_SSE2(x1,x2,T+3*step,T+2*step,BF_X2_X1,"xmm4","xmm5",sse2_hi_mask);
+    T+=4*step; x1-=8; x2-=8;
+  }while(T<sincos_lookup0+1024);
+  do{
+    BUTTERFLY_SSE2(x1+4,x2+4,T-step,T,BF_X1_X2_NEG,"xmm5","xmm4",sse2_lo_mask);
+    BUTTERFLY_SSE2(x1,x2,T-3*step,T-2*step,BF_X1_X2_NEG,"xmm5","xmm4",sse2_lo_mask);
+    T-=4*step; x1-=8; x2-=8;
+  }while(T>sincos_lookup0);
+}
+
+#else
+
 /* N/stage point generic N stage butterfly (in place, 2 register) */
 STIN void mdct_butterfly_generic(DATA_TYPE *x,int points,int step){
 
@@ -231,6 +309,8 @@ STIN void mdct_butterfly_generic(DATA_TYPE *x,int points,int step){
   }while(T>sincos_lookup0);
 }
 
+#endif
+
 STIN void mdct_butterflies(DATA_TYPE *x,int points,int shift){
 
   int stages=8-shift;
@@ -156,6 +156,8 @@ static inline void XNPROD31(ogg_int32_t  a, ogg_int32_t  b,
 
 #endif
 
+#include "asm_x86.h"
+
 #ifndef _V_CLIP_MATH
 #define _V_CLIP_MATH
 